@@ -0,0 +1,179 @@
+// Packs the resource directories of the output directory into the asset pack the app maps at startup.
+//
+//   asset-packer [--lz4] <pack file> <root directory> <folder>...
+//
+// Every file below each folder is stored under its path relative to the root, see AssetPackFormat.h.
+// With --lz4 a file is stored compressed when that saves at least an eighth of it, so the app does
+// not pay a decompression for files such as block compressed textures that barely shrink. The
+// pack is written next to its final name and renamed over it, a failed run leaves the old one.
+
+#include "AssetPackFormat.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+struct PackedFile {
+    fs::path mPath;
+    std::string mName;
+};
+} // namespace
+
+static auto ReadFile(const fs::path &path, std::vector<uint8_t> *pBytes) -> bool {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    pBytes->resize((size_t)file.tellg());
+    file.seekg(0);
+    return (bool)file.read((char *)pBytes->data(), (std::streamsize)pBytes->size());
+}
+
+static auto PackName(const fs::path &relative) -> std::string {
+    std::string name = relative.generic_string();
+    for (char &c : name) {
+        c = (char)tolower((unsigned char)c);
+    }
+    return name;
+}
+
+static void Pad(std::ofstream &out, uint64_t *pOffset) {
+    static const char zeros[AssetPackAlignment] = {};
+    const uint64_t padding = (AssetPackAlignment - *pOffset % AssetPackAlignment) % AssetPackAlignment;
+    out.write(zeros, (std::streamsize)padding);
+    *pOffset += padding;
+}
+
+int main(int argc, char **argv) {
+    bool lz4 = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--lz4") == 0) {
+            lz4 = true;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() < 3) {
+        fprintf(stderr, "usage: asset-packer [--lz4] <pack file> <root directory> <folder>...\n");
+        return 2;
+    }
+
+    const fs::path packPath = paths[0];
+    const fs::path rootDir = paths[1];
+
+    std::vector<PackedFile> files;
+    for (size_t i = 2; i < paths.size(); ++i) {
+        const fs::path folder = rootDir / paths[i];
+        if (!fs::is_directory(folder)) {
+            printf("%s: skipped, not a directory\n", folder.string().c_str());
+            continue;
+        }
+        for (const auto &entry : fs::recursive_directory_iterator(folder)) {
+            if (entry.is_regular_file()) {
+                files.push_back({entry.path(), PackName(fs::relative(entry.path(), rootDir))});
+            }
+        }
+    }
+    // The index is searched by name.
+    std::sort(files.begin(), files.end(),
+              [](const PackedFile &a, const PackedFile &b) { return strcmp(a.mName.c_str(), b.mName.c_str()) < 0; });
+    for (size_t i = 1; i < files.size(); ++i) {
+        if (files[i].mName == files[i - 1].mName) {
+            fprintf(stderr, "%s and %s have the same name in the pack\n", files[i - 1].mPath.string().c_str(),
+                    files[i].mPath.string().c_str());
+            return 1;
+        }
+    }
+
+    fs::path tempPath = packPath;
+    tempPath += ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        fprintf(stderr, "%s: could not write\n", tempPath.string().c_str());
+        return 1;
+    }
+
+    AssetPackHeader header = {};
+    header.mMagic = AssetPackMagic;
+    header.mVersion = AssetPackVersion;
+    header.mEntryCount = (uint32_t)files.size();
+    out.write((const char *)&header, sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    std::vector<AssetPackEntry> entries;
+    std::string names;
+    uint64_t totalBytes = 0;
+    uint64_t storedBytes = 0;
+    uint32_t compressedCount = 0;
+
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> compressed;
+    for (const PackedFile &file : files) {
+        if (!ReadFile(file.mPath, &bytes)) {
+            fprintf(stderr, "%s: could not read\n", file.mPath.string().c_str());
+            return 1;
+        }
+
+        Pad(out, &offset);
+        AssetPackEntry entry = {};
+        entry.mOffset = offset;
+        entry.mSize = bytes.size();
+        entry.mNameOffset = (uint32_t)names.size();
+        names.append(file.mName).push_back('\0');
+
+        size_t compressedSize = 0;
+        if (lz4 && !bytes.empty()) {
+            compressed.resize(Lz4CompressBound(bytes.size()));
+            compressedSize = Lz4Compress(bytes.data(), bytes.size(), compressed.data(), compressed.size());
+        }
+
+        if (compressedSize > 0 && compressedSize <= bytes.size() - bytes.size() / 8) {
+            entry.mFlags |= AssetPackLz4;
+            entry.mStoredSize = compressedSize;
+            out.write((const char *)compressed.data(), (std::streamsize)compressedSize);
+            compressedCount++;
+        } else {
+            entry.mStoredSize = bytes.size();
+            out.write((const char *)bytes.data(), (std::streamsize)bytes.size());
+        }
+        offset += entry.mStoredSize;
+        totalBytes += entry.mSize;
+        storedBytes += entry.mStoredSize;
+        entries.push_back(entry);
+    }
+
+    Pad(out, &offset);
+    header.mIndexOffset = offset;
+    header.mNamesSize = (uint32_t)names.size() + 1;
+    out.write((const char *)entries.data(), (std::streamsize)(entries.size() * sizeof(AssetPackEntry)));
+    // The trailing zero also terminates an empty names blob.
+    out.write(names.c_str(), (std::streamsize)header.mNamesSize);
+    out.seekp(0);
+    out.write((const char *)&header, sizeof(header));
+    out.close();
+    if (!out) {
+        fprintf(stderr, "%s: could not write\n", tempPath.string().c_str());
+        return 1;
+    }
+
+    std::error_code error;
+    fs::rename(tempPath, packPath, error);
+    if (error) {
+        fprintf(stderr, "%s: could not replace, %s\n", packPath.string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    printf("%s: %zu files, %u compressed, %.2f MB stored of %.2f MB\n", packPath.string().c_str(), files.size(),
+           compressedCount, storedBytes / (1024.0f * 1024.0f), totalBytes / (1024.0f * 1024.0f));
+    return 0;
+}
@@ -2,18 +2,23 @@
 #include <array>
 
 #include <Common_3/OS/Interfaces/ICameraController.h>
-#include <Common_3/OS/Interfaces/IInput.h>
 #include <Common_3/OS/Interfaces/IUI.h>
 #include <Common_3/Renderer/IResourceLoader.h>
 
-// Based on https://learnopengl.com/Lighting/Colors
+#include "DescriptorCache.h"
+#include "IdleFrames.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "ResourceCache.h"
 
-using namespace Ch2Lighings::Scene01Colors;
+// Based on https://learnopengl.com/Lighting/Colors
 
 namespace {
 #pragma pack(push, 1)
+// Objects are drawn from one per-frame array of transforms, indexed with a push constant.
+enum Object : uint32_t { CubeObject, LightObject, ObjectCount };
+
 struct UniformBlock {
-    mat4 model;
     mat4 view;
     mat4 projection;
 
@@ -21,64 +26,9 @@ struct UniformBlock {
     float3 lightColor;
 };
 #pragma pack(pop)
-
-Shader *lightingShader = nullptr;
-Shader *lightCubeShader = nullptr;
-
-RootSignature *pRootSignature = nullptr;
-Pipeline *pCubePipeline = nullptr;
-Pipeline *pLightPipeline = nullptr;
-
-std::array<Buffer *, ImageCount> pCubeUniformBuffers = {nullptr};
-DescriptorSet *pCubeUniformsDS = {nullptr};
-
-std::array<Buffer *, ImageCount> pLightUniformBuffers = {nullptr};
-DescriptorSet *pLightUniformsDS = {nullptr};
-
-ICameraController *pCameraController = nullptr;
-float3 lightPos{1.2f, 1.0f, 2.0f};
-float3 objectColor{1.0f, 0.5f, 0.31f};
-float3 lightColor{1.0f, 1.0f, 1.0f};
-
-Buffer *pVerticesBuffer;
 } // namespace
 
 
-Scene Ch2Lighings::Scene01Colors::Create() {
-    Scene out;
-
-    out.Draw = Draw;
-    out.Load = Load;
-    out.DrawUI = DrawUI;
-    out.Unload = Unload;
-    out.Update = Update;
-    out.Init = Init;
-    out.Exit = Exit;
-
-    return out;
-}
-
-static bool onCameraInput(InputActionContext *ctx, InputBindings::Binding binding) {
-    if (uiIsFocused() || !(*ctx->pCaptured)) {
-        return true;
-    }
-
-    switch (binding) {
-    case InputBindings::FLOAT_LEFTSTICK:
-        pCameraController->onMove(ctx->mFloat2);
-        break;
-
-    case InputBindings::FLOAT_RIGHTSTICK:
-        pCameraController->onRotate(ctx->mFloat2);
-        break;
-
-    case InputBindings::BUTTON_NORTH:
-        pCameraController->resetView();
-    }
-
-    return true;
-};
-
 void Ch2Lighings::Scene01Colors::Init(Renderer *pRenderer) {
 
     {
@@ -86,7 +36,7 @@ void Ch2Lighings::Scene01Colors::Init(Renderer *pRenderer) {
         desc.mStages[0] = {"2.1.colors.vert", nullptr, 0};
         desc.mStages[1] = {"2.1.colors.frag", nullptr, 0};
 
-        addShader(pRenderer, &desc, &lightingShader);
+        pLightingShader = AcquireShader(desc);
     }
 
     {
@@ -94,10 +44,10 @@ void Ch2Lighings::Scene01Colors::Init(Renderer *pRenderer) {
         desc.mStages[0] = {"2.1.light_cube.vert", nullptr, 0};
         desc.mStages[1] = {"2.1.light_cube.frag", nullptr, 0};
 
-        addShader(pRenderer, &desc, &lightCubeShader);
+        pLightCubeShader = AcquireShader(desc);
     }
 
-    {
+    pVerticesBuffer = AcquireBuffer("generateCuboidPoints", [](Buffer **ppBuffer, SyncToken *pToken) {
         float *pVertices;
         int vertexCount;
 
@@ -109,18 +59,16 @@ void Ch2Lighings::Scene01Colors::Init(Renderer *pRenderer) {
         desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
         desc.mDesc.mSize = cubeDataSize;
         desc.pData = pVertices;
-        desc.ppBuffer = &pVerticesBuffer;
+        desc.ppBuffer = ppBuffer;
 
-        addResource(&desc, NULL);
+        addResource(&desc, pToken);
         tf_free(pVertices);
-    }
+    });
 
     {
-        RootSignatureDesc rootDesc = {};
-        rootDesc.mStaticSamplerCount = 0;
-        rootDesc.mShaderCount = 1;
-        rootDesc.ppShaders = &lightingShader;
-        addRootSignature(pRenderer, &rootDesc, &pRootSignature);
+        Shader *shaders[] = {pLightingShader, pLightCubeShader};
+        pRootSignature = AcquireRootSignature(shaders, 2);
+        mObjectConstantsIndex = getDescriptorIndexFromName(pRootSignature, "objectConstants");
     }
 
     CameraMotionParameters cmp{16.0f, 10.0f, 20.0f};
@@ -130,45 +78,15 @@ void Ch2Lighings::Scene01Colors::Init(Renderer *pRenderer) {
     pCameraController = initFpsCameraController(camPos, lookAt);
     pCameraController->setMotionParameters(cmp);
 
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::FLOAT_RIGHTSTICK,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::FLOAT_RIGHTSTICK); },
-            NULL,
-            2.0f,
-            20.0f,
-            0.05f};
-        addInputAction(&actionDesc);
-    }
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::FLOAT_LEFTSTICK,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::FLOAT_LEFTSTICK); },
-            NULL,
-            2.0f,
-            20.0f,
-            0.1f};
-        addInputAction(&actionDesc);
-    }
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::BUTTON_NORTH,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::BUTTON_NORTH); },
-        };
-        addInputAction(&actionDesc);
-    }
-    {
-        DescriptorSetDesc desc = {pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount};
-        addDescriptorSet(pRenderer, &desc, &pCubeUniformsDS);
-    }
-
-    {
-        DescriptorSetDesc desc = {pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount};
-        addDescriptorSet(pRenderer, &desc, &pLightUniformsDS);
-    }
+    mUniformsDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount);
 }
 
-void Ch2Lighings::Scene01Colors::Update(float deltaTime) { pCameraController->update(deltaTime); }
+auto Ch2Lighings::Scene01Colors::Camera() -> ICameraController * { return pCameraController; }
+
+auto Ch2Lighings::Scene01Colors::Update(float deltaTime) -> bool {
+    pCameraController->update(deltaTime);
+    return CameraMoved(pCameraController, &mLastView);
+}
 
 void Ch2Lighings::Scene01Colors::Draw(Cmd *cmd, int imageIndex) {
     mat4 viewMat = pCameraController->getViewMatrix();
@@ -178,50 +96,43 @@ void Ch2Lighings::Scene01Colors::Draw(Cmd *cmd, int imageIndex) {
 
     {
         UniformBlock uniform;
-        uniform.model = mat4::identity();
         uniform.projection = projMat;
         uniform.view = viewMat;
-        uniform.lightColor = lightColor;
-        uniform.objectColor = objectColor;
+        uniform.lightColor = mLightColor;
+        uniform.objectColor = mObjectColor;
 
-        BufferUpdateDesc cubeUniformUpdate = {pCubeUniformBuffers[imageIndex]};
-        beginUpdateResource(&cubeUniformUpdate);
-        *(UniformBlock *)cubeUniformUpdate.pMappedData = uniform;
-        endUpdateResource(&cubeUniformUpdate, NULL);
+        BufferUpdateDesc uniformUpdate = {pUniformBuffers[imageIndex]};
+        BeginTrackedUpdate(&uniformUpdate);
+        *(UniformBlock *)uniformUpdate.pMappedData = uniform;
+        endUpdateResource(&uniformUpdate, NULL);
     }
     {
-        UniformBlock uniform;
-
-        uniform.model = mat4::translation(f3Tov3(lightPos)) * mat4::scale(vec3{0.2f});
-        uniform.projection = projMat;
-        uniform.view = viewMat;
-        uniform.lightColor = lightColor;
-        uniform.objectColor = objectColor;
-
-        BufferUpdateDesc lightUniformUpdate = {pLightUniformBuffers[imageIndex]};
-        beginUpdateResource(&lightUniformUpdate);
-        *(UniformBlock *)lightUniformUpdate.pMappedData = uniform;
-        endUpdateResource(&lightUniformUpdate, NULL);
+        BufferUpdateDesc objectUpdate = {pObjectBuffers[imageIndex]};
+        BeginTrackedUpdate(&objectUpdate);
+        mat4 *pTransforms = (mat4 *)objectUpdate.pMappedData;
+        pTransforms[CubeObject] = mat4::identity();
+        pTransforms[LightObject] = mat4::translation(f3Tov3(mLightPos)) * mat4::scale(vec3{0.2f});
+        endUpdateResource(&objectUpdate, NULL);
     }
 
     // cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
     const uint32_t stride = sizeof(float) * 6;
+    const uint32_t cubeObject = CubeObject;
     cmdBindPipeline(cmd, pCubePipeline);
-    cmdBindDescriptorSet(cmd, imageIndex, pCubeUniformsDS);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex);
     cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    cmdBindPushConstants(cmd, pRootSignature, mObjectConstantsIndex, &cubeObject);
     cmdDraw(cmd, 36, 0);
     // cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 
     // cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
+    const uint32_t lightObject = LightObject;
     cmdBindPipeline(cmd, pLightPipeline);
-    cmdBindDescriptorSet(cmd, imageIndex, pLightUniformsDS);
-    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    cmdBindPushConstants(cmd, pRootSignature, mObjectConstantsIndex, &lightObject);
     cmdDraw(cmd, 36, 0);
     // cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 }
 
-void Ch2Lighings::Scene01Colors::DrawUI() {}
-
 bool Ch2Lighings::Scene01Colors::Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) {
     {
         BufferLoadDesc ubDesc = {};
@@ -231,37 +142,38 @@ bool Ch2Lighings::Scene01Colors::Load(Renderer *pRenderer, SwapChain *pSwapChain
         ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
         ubDesc.pData = NULL;
 
-        for (auto &buffer : pCubeUniformBuffers) {
+        for (auto &buffer : pUniformBuffers) {
             ubDesc.ppBuffer = &buffer;
-            addResource(&ubDesc, NULL);
+            AddTrackedResource(&ubDesc, NULL);
         }
     }
 
     {
-        BufferLoadDesc ubDesc = {};
-        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
-        ubDesc.mDesc.mSize = sizeof(UniformBlock);
-        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
-        ubDesc.pData = NULL;
-
-        for (auto &buffer : pLightUniformBuffers) {
-            ubDesc.ppBuffer = &buffer;
-            addResource(&ubDesc, NULL);
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        desc.mDesc.mSize = ObjectCount * sizeof(mat4);
+        desc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = ObjectCount;
+        desc.mDesc.mStructStride = sizeof(mat4);
+        desc.pData = NULL;
+
+        for (auto &buffer : pObjectBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
         }
     }
 
     waitForAllResourceLoads();
 
     for (uint32_t i = 0; i < ImageCount; ++i) {
-        DescriptorData params{};
-        auto size = sizeof(UniformBlock);
-        params.pName = "uniformBlock";
-        params.ppBuffers = &pCubeUniformBuffers[i];
-        updateDescriptorSet(pRenderer, i, pCubeUniformsDS, 1, &params);
-
-        params.ppBuffers = &pLightUniformBuffers[i];
-        updateDescriptorSet(pRenderer, i, pLightUniformsDS, 1, &params);
+        DescriptorData params[2] = {};
+        params[0].pName = "uniformBlock";
+        params[0].ppBuffers = &pUniformBuffers[i];
+        params[1].pName = "objectTransforms";
+        params[1].ppBuffers = &pObjectBuffers[i];
+        UpdateDescriptors(mUniformsDescriptors, i, 2, params);
     }
 
     {
@@ -313,40 +225,39 @@ bool Ch2Lighings::Scene01Colors::Load(Renderer *pRenderer, SwapChain *pSwapChain
         pipelineSettings.pRootSignature = pRootSignature;
         pipelineSettings.pVertexLayout = &vertexLayout;
         pipelineSettings.pRasterizerState = &rasterizerStateDesc;
-        pipelineSettings.pShaderProgram = lightCubeShader;
+        pipelineSettings.pShaderProgram = pLightCubeShader;
 
-        addPipeline(pRenderer, &desc, &pLightPipeline);
+        pLightPipeline = AcquirePipeline(desc);
 
-        pipelineSettings.pShaderProgram = lightingShader;
+        pipelineSettings.pShaderProgram = pLightingShader;
 
-        addPipeline(pRenderer, &desc, &pCubePipeline);
+        pCubePipeline = AcquirePipeline(desc);
     }
     return true;
 }
 
 void Ch2Lighings::Scene01Colors::Unload(Renderer *pRenderer) {
 
-    for (auto &buffer : pCubeUniformBuffers) {
-        removeResource(buffer);
+    for (auto &buffer : pUniformBuffers) {
+        RemoveTrackedResource(buffer);
     }
 
-    for (auto &buffer : pLightUniformBuffers) {
-        removeResource(buffer);
+    for (auto &buffer : pObjectBuffers) {
+        RemoveTrackedResource(buffer);
     }
 
-    removePipeline(pRenderer, pCubePipeline);
-    removePipeline(pRenderer, pLightPipeline);
+    ReleasePipeline(pCubePipeline);
+    ReleasePipeline(pLightPipeline);
 }
 
 void Ch2Lighings::Scene01Colors::Exit(Renderer *pRenderer) {
     exitCameraController(pCameraController);
-    removeRootSignature(pRenderer, pRootSignature);
 
-    removeResource(pVerticesBuffer);
+    FreeDescriptors(mUniformsDescriptors);
+    ReleaseRootSignature(pRootSignature);
 
-    removeShader(pRenderer, lightingShader);
-    removeShader(pRenderer, lightCubeShader);
+    ReleaseBuffer(pVerticesBuffer);
 
-    removeDescriptorSet(pRenderer, pCubeUniformsDS);
-    removeDescriptorSet(pRenderer, pLightUniformsDS);
+    ReleaseShader(pLightingShader);
+    ReleaseShader(pLightCubeShader);
 }
@@ -2,18 +2,43 @@
 
 #include "Scene.h"
 
+#include "DescriptorCache.h"
 #include "MainApp.h"
 
+#include <array>
+
 namespace Ch2Lighings {
-namespace Scene01Colors {
-Scene Create();
-
-void Update(float deltaTime);
-void Draw(Cmd *cmd, int imageIndex);
-auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
-void Unload(Renderer *pRenderer);
-void DrawUI();
-void Init(Renderer *pRenderer);
-void Exit(Renderer *pRenderer);
-}; // namespace Scene01Colors
-} // namespace Ch2Lighings
+class Scene01Colors : public Scene {
+  public:
+    static constexpr const char *Name = "2.1 Colors";
+
+    auto Update(float deltaTime) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Camera() -> ICameraController *;
+
+  private:
+    Shader *pLightingShader = nullptr;
+    Shader *pLightCubeShader = nullptr;
+
+    RootSignature *pRootSignature = nullptr;
+    uint32_t mObjectConstantsIndex = 0;
+    Pipeline *pCubePipeline = nullptr;
+    Pipeline *pLightPipeline = nullptr;
+
+    std::array<Buffer *, ImageCount> pUniformBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pObjectBuffers = {nullptr};
+    DescriptorRange mUniformsDescriptors = {};
+
+    ICameraController *pCameraController = nullptr;
+    mat4 mLastView = mat4::identity();
+    float3 mLightPos{1.2f, 1.0f, 2.0f};
+    float3 mObjectColor{1.0f, 0.5f, 0.31f};
+    float3 mLightColor{1.0f, 1.0f, 1.0f};
+
+    Buffer *pVerticesBuffer = nullptr;
+};
+}; // namespace Ch2Lighings
@@ -1,20 +1,50 @@
 #include "Scene02BasicLighting.h"
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
 
 #include <Common_3/OS/Interfaces/ICameraController.h>
-#include <Common_3/OS/Interfaces/IInput.h>
 #include <Common_3/OS/Interfaces/IUI.h>
 #include <Common_3/Renderer/IResourceLoader.h>
 
+#include "Bvh.h"
+#include "CommandStream.h"
+#include "DescriptorCache.h"
+#include "IdleFrames.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "QualityPresets.h"
+#include "RenderQueue.h"
+#include "ResourceCache.h"
+#include "ShadowCache.h"
+#include "UploadBatcher.h"
+
 #include <Common_3/OS/Interfaces/ILog.h>
 
 // Based on https://learnopengl.com/Lighting/Colors
 
-using namespace Ch2Lighings::Scene02BasicLighting;
-
 namespace {
+// Objects are drawn from one per-frame array of transforms, indexed with a push constant. Extra
+// cubes can be added to measure the cost of recording many draws.
+constexpr uint32_t MaxCubes = 4096;
+constexpr uint32_t CubeGridSize = 16;
+enum Object : uint32_t { LightObject, MovingCubeObject, FirstCubeObject, ObjectCount = FirstCubeObject + MaxCubes };
+// Leaves of the culling BVH, every cube the main pass may draw.
+enum BvhObject : uint32_t { BvhMovingCube, BvhFirstCube };
+
+// The moving cube circles the first one, between it and the light, and is the only dynamic shadow
+// caster. The grid cubes are the static casters.
+constexpr float MovingCubeOrbit = 1.1f;
+constexpr float MovingCubeHeight = 0.6f;
+constexpr float MovingCubeScale = 0.3f;
+// Radians per second.
+constexpr float MovingCubeSpeed = 1.0f;
+constexpr float LightSpeed = 0.5f;
+
 struct UniformBlock {
-    mat4 model;
     mat4 view;
     mat4 projection;
 
@@ -23,71 +53,20 @@ struct UniformBlock {
 
     alignas(16) float3 lightPos;
     alignas(16) float3 viewPos;
-};
-
-Shader *lightingShader = nullptr;
-Shader *lightCubeShader = nullptr;
-
-RootSignature *pRootSignature = nullptr;
-Pipeline *pCubePipeline = nullptr;
-Pipeline *pLightPipeline = nullptr;
-
-std::array<Buffer *, ImageCount> pCubeUniformBuffers = {nullptr};
-DescriptorSet *pCubeUniformsDS = {nullptr};
-
-std::array<Buffer *, ImageCount> pLightUniformBuffers = {nullptr};
-DescriptorSet *pLightUniformsDS = {nullptr};
-
-ICameraController *pCameraController = nullptr;
-float3 lightPos{1.2f, 1.0f, 2.0f};
-float3 objectColor{1.0f, 0.5f, 0.31f};
-float3 lightColor{1.0f, 1.0f, 1.0f};
-
-Buffer *pVerticesBuffer;
-} // namespace
-
-Scene Ch2Lighings::Scene02BasicLighting::Create() {
-    Scene out;
-
-    out.Draw = Draw;
-    out.Load = Load;
-    out.DrawUI = DrawUI;
-    out.Unload = Unload;
-    out.Update = Update;
-    out.Init = Init;
-    out.Exit = Exit;
-
-    return out;
-}
-
-static bool onCameraInput(InputActionContext *ctx, InputBindings::Binding binding) {
-    if (uiIsFocused() || !(*ctx->pCaptured)) {
-        return true;
-    }
-
-    switch (binding) {
-    case InputBindings::FLOAT_LEFTSTICK:
-        pCameraController->onMove(ctx->mFloat2);
-        break;
-
-    case InputBindings::FLOAT_RIGHTSTICK:
-        pCameraController->onRotate(ctx->mFloat2);
-        break;
 
-    case InputBindings::BUTTON_NORTH:
-        pCameraController->resetView();
-    }
-
-    return true;
+    mat4 lightViewProjection;
 };
+} // namespace
 
 void Ch2Lighings::Scene02BasicLighting::Init(Renderer *pRenderer) {
+    mCubeCount = ActiveQualityPreset().mCubeCount;
+
     {
         ShaderLoadDesc desc{};
         desc.mStages[0] = {"2.2.basic_lighting.vert", nullptr, 0};
         desc.mStages[1] = {"2.2.basic_lighting.frag", nullptr, 0};
 
-        addShader(pRenderer, &desc, &lightingShader);
+        pLightingShader = AcquireShader(desc);
     }
 
     {
@@ -95,10 +74,17 @@ void Ch2Lighings::Scene02BasicLighting::Init(Renderer *pRenderer) {
         desc.mStages[0] = {"2.2.light_cube.vert", nullptr, 0};
         desc.mStages[1] = {"2.2.light_cube.frag", nullptr, 0};
 
-        addShader(pRenderer, &desc, &lightCubeShader);
+        pLightCubeShader = AcquireShader(desc);
     }
 
     {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"2.2.shadow_caster.vert", nullptr, 0};
+
+        pShadowCasterShader = AcquireShader(desc);
+    }
+
+    pVerticesBuffer = AcquireBuffer("generateCuboidPoints", [](Buffer **ppBuffer, SyncToken *pToken) {
         float *pVertices;
         int vertexCount;
 
@@ -110,20 +96,23 @@ void Ch2Lighings::Scene02BasicLighting::Init(Renderer *pRenderer) {
         desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
         desc.mDesc.mSize = cubeDataSize;
         desc.pData = pVertices;
-        desc.ppBuffer = &pVerticesBuffer;
+        desc.ppBuffer = ppBuffer;
 
-        addResource(&desc, NULL);
+        addResource(&desc, pToken);
         tf_free(pVertices);
-    }
+    });
 
     {
-        RootSignatureDesc rootDesc = {};
-        rootDesc.mStaticSamplerCount = 0;
-        rootDesc.mShaderCount = 1;
-        rootDesc.ppShaders = &lightingShader;
-        addRootSignature(pRenderer, &rootDesc, &pRootSignature);
+        Shader *shaders[] = {pLightingShader, pLightCubeShader};
+        pRootSignature = AcquireRootSignature(shaders, 2);
+        mObjectConstantsIndex = getDescriptorIndexFromName(pRootSignature, "objectConstants");
+
+        pShadowRootSignature = AcquireRootSignature(&pShadowCasterShader, 1);
+        mShadowConstantsIndex = getDescriptorIndexFromName(pShadowRootSignature, "objectConstants");
     }
 
+    InitShadowCache(mShadowCache, pRenderer);
+
     CameraMotionParameters cmp{16.0f, 10.0f, 20.0f};
     vec3 camPos{0.0f, 0.0f, 3.0f};
     vec3 lookAt{vec3(0)};
@@ -131,145 +120,419 @@ void Ch2Lighings::Scene02BasicLighting::Init(Renderer *pRenderer) {
     pCameraController = initFpsCameraController(camPos, lookAt);
     pCameraController->setMotionParameters(cmp);
 
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::FLOAT_RIGHTSTICK,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::FLOAT_RIGHTSTICK); },
-            NULL,
-            2.0f,
-            20.0f,
-            0.05f};
-        addInputAction(&actionDesc);
+    mUniformsDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount);
+    mShadowCasterDescriptors = AllocateDescriptors(pShadowRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount);
+
+    LOGF(LogLevel::eDEBUG, "sizeof UniformBlock %d", sizeof(UniformBlock));
+    LOGF(LogLevel::eDEBUG, "alignof UniformBlock %d", alignof(UniformBlock));
+}
+
+// The window is only created while the scene is shown, Init may run while another scene is on screen.
+void Ch2Lighings::Scene02BasicLighting::Activate() {
+    auto &&mSettings = AppInstance()->mSettings;
+
+    UIComponentDesc guiDesc{};
+    guiDesc.mStartPosition = vec2(mSettings.mWidth * 0.75f, mSettings.mHeight * 0.2f);
+    uiCreateComponent("Basic Lighting", &guiDesc, &pWindow);
+
+    SliderUintWidget cubeCount;
+    cubeCount.pData = &mCubeCount;
+    cubeCount.mMin = 1;
+    cubeCount.mMax = MaxCubes;
+    cubeCount.mStep = 1;
+    uiCreateComponentWidget(pWindow, "Cubes", &cubeCount, WIDGET_TYPE_SLIDER_UINT);
+
+    CheckboxWidget cached;
+    cached.pData = &bCachedCommands;
+    uiCreateComponentWidget(pWindow, "Cached Commands", &cached, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget sorted;
+    sorted.pData = &bSortedQueue;
+    uiCreateComponentWidget(pWindow, "Sorted Queue", &sorted, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget moveLight;
+    moveLight.pData = &bMoveLight;
+    uiCreateComponentWidget(pWindow, "Move Light", &moveLight, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget movingCube;
+    movingCube.pData = &bMovingCube;
+    uiCreateComponentWidget(pWindow, "Moving Cube", &movingCube, WIDGET_TYPE_CHECKBOX);
+
+    CheckboxWidget cacheShadows;
+    cacheShadows.pData = &bCacheShadows;
+    uiCreateComponentWidget(pWindow, "Cache Shadows", &cacheShadows, WIDGET_TYPE_CHECKBOX);
+
+    DynamicTextWidget stats;
+    stats.pText = mRecordStatsText;
+    stats.mLength = sizeof(mRecordStatsText);
+    stats.pColor = &mRecordStatsColor;
+    uiCreateComponentWidget(pWindow, "Record Time", &stats, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget queueStats;
+    queueStats.pText = mQueueStatsText;
+    queueStats.mLength = sizeof(mQueueStatsText);
+    queueStats.pColor = &mRecordStatsColor;
+    uiCreateComponentWidget(pWindow, "Sorted Queue Binds", &queueStats, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget shadowStats;
+    shadowStats.pText = mShadowStatsText;
+    shadowStats.mLength = sizeof(mShadowStatsText);
+    shadowStats.pColor = &mRecordStatsColor;
+    uiCreateComponentWidget(pWindow, "Shadow Cache", &shadowStats, WIDGET_TYPE_DYNAMIC_TEXT);
+}
+
+void Ch2Lighings::Scene02BasicLighting::Deactivate() {
+    uiDestroyComponent(pWindow);
+    pWindow = nullptr;
+}
+
+auto Ch2Lighings::Scene02BasicLighting::Camera() -> ICameraController * { return pCameraController; }
+
+static auto CubePosition(uint32_t cube) -> vec3 {
+    vec3 position{(float)(cube % CubeGridSize), (float)(cube / CubeGridSize % CubeGridSize),
+                  -(float)(cube / (CubeGridSize * CubeGridSize))};
+    return position * 2.0f;
+}
+
+auto Ch2Lighings::Scene02BasicLighting::MovingCubeTransform() const -> mat4 {
+    const vec3 position{MovingCubeOrbit * cosf(mMovingCubeAngle), MovingCubeHeight,
+                        MovingCubeOrbit * sinf(mMovingCubeAngle)};
+    return mat4::translation(position) * mat4::scale(vec3{MovingCubeScale});
+}
+
+// Center of a cube object, the moving one included.
+auto Ch2Lighings::Scene02BasicLighting::ObjectPosition(uint32_t object) const -> vec3 {
+    return object == MovingCubeObject ? MovingCubeTransform().getTranslation() : CubePosition(object - FirstCubeObject);
+}
+
+auto Ch2Lighings::Scene02BasicLighting::Update(float deltaTime) -> bool {
+    pCameraController->update(deltaTime);
+    bool changed = CameraMoved(pCameraController, &mLastView);
+
+    if (bMoveLight) {
+        // Around the y axis, keeping the light's distance and height.
+        const float radius = sqrtf(mLightPos.x * mLightPos.x + mLightPos.z * mLightPos.z);
+        const float angle = atan2f(mLightPos.x, mLightPos.z) + LightSpeed * deltaTime;
+        mLightPos = {radius * sinf(angle), mLightPos.y, radius * cosf(angle)};
+        changed = true;
     }
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::FLOAT_LEFTSTICK,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::FLOAT_LEFTSTICK); },
-            NULL,
-            2.0f,
-            20.0f,
-            0.1f};
-        addInputAction(&actionDesc);
+    if (bMovingCube) {
+        mMovingCubeAngle = fmodf(mMovingCubeAngle + MovingCubeSpeed * deltaTime, 2.0f * PI);
+        changed = true;
     }
-    {
-        InputActionDesc actionDesc = {
-            InputBindings::BUTTON_NORTH,
-            [](InputActionContext *ctx) { return onCameraInput(ctx, InputBindings::BUTTON_NORTH); },
+
+    // Unit cubes, see generateCuboidPoints, the moving one scaled down.
+    const float3 movingCenter = v3ToF3(ObjectPosition(MovingCubeObject));
+    const BvhBounds movingBounds = {movingCenter - float3(0.5f * MovingCubeScale),
+                                    movingCenter + float3(0.5f * MovingCubeScale)};
+
+    if (mBvhCubeCount != mCubeCount) {
+        std::vector<BvhBounds> bounds(BvhFirstCube + mCubeCount);
+        bounds[BvhMovingCube] = movingBounds;
+        float3 casterMin = float3(-MovingCubeOrbit - MovingCubeScale);
+        float3 casterMax = float3(MovingCubeOrbit + MovingCubeScale);
+        for (uint32_t i = 0; i < mCubeCount; ++i) {
+            const float3 center = v3ToF3(CubePosition(i));
+            bounds[BvhFirstCube + i] = {center - float3(0.5f), center + float3(0.5f)};
+            casterMin = min(casterMin, bounds[BvhFirstCube + i].mMin);
+            casterMax = max(casterMax, bounds[BvhFirstCube + i].mMax);
+        }
+        BuildBvh(bounds.data(), (uint32_t)bounds.size(), &mCubeBvh);
+        mBvhCubeCount = mCubeCount;
+        mCasterCenter = f3Tov3((casterMin + casterMax) * 0.5f);
+        mCasterRadius = length(f3Tov3(casterMax - casterMin)) * 0.5f;
+        changed = true;
+    } else {
+        // Only the moving cube's leaf and its ancestors are touched, the grid stays as built.
+        MoveBvhObject(mCubeBvh, BvhMovingCube, movingBounds);
+        RefitBvh(mCubeBvh);
+    }
+
+    // From the last frame drawn, refreshed once per second.
+    mStatsTime += deltaTime;
+    if (mStatsTime >= 1.0f) {
+        mStatsTime = 0.0f;
+
+        const ShadowCacheStats shadowStats = GetShadowCacheStats(mShadowCache);
+        snprintf(mShadowStatsText, sizeof(mShadowStatsText),
+                 "%u reused, %u rendered, %.2f ms saved per frame, %.0f ms total", shadowStats.mReusedFrames,
+                 shadowStats.mRenderedFrames, shadowStats.mSavedMsPerFrame, shadowStats.mSavedMs);
+
+        // Against the immediate path, which binds like the original tutorial. Zero until both were measured.
+        auto saved = [this](float recordUs) {
+            return recordUs > 0.0f && mImmediateRecordUs > 0.0f ? mImmediateRecordUs - recordUs : 0.0f;
         };
-        addInputAction(&actionDesc);
+        snprintf(mRecordStatsText, sizeof(mRecordStatsText),
+                 "%u draws, %.1f us immediate, cached saves %.1f us, sorted saves %.1f us",
+                 (uint32_t)mVisibleObjects.size() + 1, mImmediateRecordUs, saved(mCachedRecordUs),
+                 saved(mQueuedRecordUs));
+
+        const RenderQueueStats &queueStats = mDrawQueue.mStats;
+        snprintf(mQueueStatsText, sizeof(mQueueStatsText), "%u packets, %u binds, %u skipped", queueStats.mPackets,
+                 queueStats.mBinds, queueStats.mBindsSkipped);
     }
-    {
-        DescriptorSetDesc desc = {pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount};
-        addDescriptorSet(pRenderer, &desc, &pCubeUniformsDS);
+    return changed;
+}
+
+// Every draw of the cubes in view spelled out, as a scene without a cached stream records it each
+// frame. Binds once per pipeline like the original tutorial, only the object index changes per draw.
+void Ch2Lighings::Scene02BasicLighting::CmdDrawImmediate(Cmd *cmd, int imageIndex) {
+    const uint32_t stride = sizeof(float) * 6;
+    cmdBindPipeline(cmd, pCubePipeline);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex);
+    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    for (uint32_t object : mVisibleObjects) {
+        cmdBindPushConstants(cmd, pRootSignature, mObjectConstantsIndex, &object);
+        cmdDraw(cmd, 36, 0);
     }
 
-    {
-        DescriptorSetDesc desc = {pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount};
-        addDescriptorSet(pRenderer, &desc, &pLightUniformsDS);
+    const uint32_t lightObject = LightObject;
+    cmdBindPipeline(cmd, pLightPipeline);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex);
+    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    cmdBindPushConstants(cmd, pRootSignature, mObjectConstantsIndex, &lightObject);
+    cmdDraw(cmd, 36, 0);
+}
+
+// Same draws as CmdDrawImmediate, submitted as packets and issued sorted, nearest cubes first.
+void Ch2Lighings::Scene02BasicLighting::CmdDrawQueued(Cmd *cmd, int imageIndex) {
+    enum QueuePipeline : uint32_t { CubeQueuePipeline, LightQueuePipeline };
+
+    ResetRenderQueue(mDrawQueue);
+    const vec3 viewPos = pCameraController->getViewPosition();
+
+    auto submit = [this, imageIndex](uint64_t key, Pipeline *pPipeline, uint32_t object) {
+        DrawPacket &packet = SubmitDraw(mDrawQueue, key);
+        packet.pPipeline = pPipeline;
+        packet.pRootSignature = pRootSignature;
+        packet.mDescriptors = mUniformsDescriptors;
+        packet.mDescriptorIndex = imageIndex;
+        packet.pVertexBuffer = pVerticesBuffer;
+        packet.mVertexStride = sizeof(float) * 6;
+        packet.mConstantsIndex = mObjectConstantsIndex;
+        packet.mConstantWords = 1;
+        packet.mConstants[0] = object;
+        packet.mCount = 36;
+    };
+
+    for (uint32_t object : mVisibleObjects) {
+        const float depth = length(ObjectPosition(object) - viewPos);
+        submit(RenderQueueKey(0, CubeQueuePipeline, 0, depth), pCubePipeline, object);
     }
+    submit(RenderQueueKey(0, LightQueuePipeline, 0, length(f3Tov3(mLightPos) - viewPos)), pLightPipeline,
+           LightObject);
 
-    LOGF(LogLevel::eDEBUG, "sizeof UniformBlock %d", sizeof(UniformBlock));
-    LOGF(LogLevel::eDEBUG, "alignof UniformBlock %d", alignof(UniformBlock));
+    CmdSubmitRenderQueue(cmd, mDrawQueue);
 }
 
-void Ch2Lighings::Scene02BasicLighting::Update(float deltaTime) { pCameraController->update(deltaTime); }
+// Same draws and binds as CmdDrawImmediate, recorded once and replayed until they change.
+void Ch2Lighings::Scene02BasicLighting::RecordDrawStream() {
+    ResetCommandStream(mDrawStream);
 
-void Ch2Lighings::Scene02BasicLighting::Draw(Cmd *cmd, int imageIndex) {
+    const uint32_t stride = sizeof(float) * 6;
+    StreamBindPipeline(mDrawStream, pCubePipeline);
+    StreamBindDescriptors(mDrawStream, mUniformsDescriptors, StreamFrameDescriptor);
+    StreamBindVertexBuffer(mDrawStream, pVerticesBuffer, stride);
+    for (uint32_t object : mVisibleObjects) {
+        StreamPushConstants(mDrawStream, pRootSignature, mObjectConstantsIndex, &object, sizeof(object));
+        StreamDraw(mDrawStream, 36, 0);
+    }
+
+    const uint32_t lightObject = LightObject;
+    StreamBindPipeline(mDrawStream, pLightPipeline);
+    StreamBindDescriptors(mDrawStream, mUniformsDescriptors, StreamFrameDescriptor);
+    StreamBindVertexBuffer(mDrawStream, pVerticesBuffer, stride);
+    StreamPushConstants(mDrawStream, pRootSignature, mObjectConstantsIndex, &lightObject, sizeof(lightObject));
+    StreamDraw(mDrawStream, 36, 0);
+
+    EndCommandStream(mDrawStream);
+    mStreamObjects = mVisibleObjects;
+}
+
+// Perspective from the light fitted to the bounding sphere of the casters, reverse-Z like the view.
+auto Ch2Lighings::Scene02BasicLighting::LightViewProjection() const -> mat4 {
+    const vec3 eye = f3Tov3(mLightPos);
+    const float distance = length(mCasterCenter - eye);
+    // From inside the sphere the frustum opens as wide as the shadow map resolution allows.
+    const float halfFov = distance > mCasterRadius ? fminf(asinf(mCasterRadius / distance), PI / 3.0f) : PI / 3.0f;
+
+    const mat4 view = mat4::lookAt(Point3(eye), Point3(mCasterCenter), vec3{0.0f, 1.0f, 0.0f});
+    const mat4 projection = mat4::perspective(2.0f * halfFov, 1.0f, distance + mCasterRadius, 0.1f);
+    return projection * view;
+}
+
+void Ch2Lighings::Scene02BasicLighting::CmdDrawShadowCasters(Cmd *cmd, int imageIndex, uint32_t firstObject,
+                                                             uint32_t objectCount) {
+    const uint32_t stride = sizeof(float) * 6;
+    cmdBindPipeline(cmd, pShadowCasterPipeline);
+    CmdBindDescriptors(cmd, mShadowCasterDescriptors, imageIndex);
+    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    for (uint32_t object = firstObject; object < firstObject + objectCount; ++object) {
+        cmdBindPushConstants(cmd, pShadowRootSignature, mShadowConstantsIndex, &object);
+        cmdDraw(cmd, 36, 0);
+    }
+}
+
+// Culls the cubes, writes the frame's uniforms in place in the upload batcher, whose copies run
+// before any pass, and adds the shadow passes that are due, see ShadowCache.h.
+auto Ch2Lighings::Scene02BasicLighting::AddPasses(int imageIndex, RGResource depthBuffer) -> bool {
     mat4 viewMat = pCameraController->getViewMatrix();
     const float aspectInverse = (float)AppInstance()->mSettings.mHeight / (float)AppInstance()->mSettings.mWidth;
     const float horizontal_fov = PI / 2.0f;
     mat4 projMat = mat4::perspective(horizontal_fov, aspectInverse, 1000.0f, 0.1f);
+    mViewProjection = projMat * viewMat;
+
+    vec4 planes[6];
+    FrustumPlanes(mViewProjection, planes);
+    // Leaves are numbered from the moving cube on, in the order of the objects.
+    static_assert(FirstCubeObject - MovingCubeObject == BvhFirstCube, "Leaves follow the objects");
+    mVisibleObjects.clear();
+    QueryBvhFrustum(mCubeBvh, planes, mVisibleObjects);
+    for (uint32_t &object : mVisibleObjects) {
+        object += MovingCubeObject;
+    }
+    if (!bMovingCube) {
+        mVisibleObjects.erase(std::remove(mVisibleObjects.begin(), mVisibleObjects.end(), (uint32_t)MovingCubeObject),
+                              mVisibleObjects.end());
+    }
 
-    {
-        UniformBlock uniform;
-        uniform.model = mat4::identity();
-        uniform.projection = projMat;
-        uniform.view = viewMat;
-        uniform.lightColor = lightColor;
-        uniform.objectColor = objectColor;
-        uniform.lightPos = lightPos;
-        uniform.viewPos = v3ToF3(pCameraController->getViewPosition());
-
-        BufferUpdateDesc cubeUniformUpdate = {pCubeUniformBuffers[imageIndex]};
-        beginUpdateResource(&cubeUniformUpdate);
-        *(UniformBlock *)cubeUniformUpdate.pMappedData = uniform;
-        endUpdateResource(&cubeUniformUpdate, NULL);
+    const mat4 lightViewProjection = LightViewProjection();
+
+    auto *pUniform = (UniformBlock *)AllocateUpload(pUniformBuffers[imageIndex], 0, sizeof(UniformBlock),
+                                                    RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    if (pUniform != nullptr) {
+        pUniform->projection = projMat;
+        pUniform->view = viewMat;
+        pUniform->lightColor = mLightColor;
+        pUniform->objectColor = mObjectColor;
+        pUniform->lightPos = mLightPos;
+        pUniform->viewPos = v3ToF3(pCameraController->getViewPosition());
+        pUniform->lightViewProjection = lightViewProjection;
     }
 
-    {
-        UniformBlock uniform;
-
-        uniform.model = mat4::translation(f3Tov3(lightPos)) * mat4::scale(vec3{0.2f});
-        uniform.projection = projMat;
-        uniform.view = viewMat;
-        uniform.lightColor = lightColor;
-        uniform.objectColor = objectColor;
-        uniform.lightPos = lightPos;
-
-        BufferUpdateDesc lightUniformUpdate = {pLightUniformBuffers[imageIndex]};
-        beginUpdateResource(&lightUniformUpdate);
-        *(UniformBlock *)lightUniformUpdate.pMappedData = uniform;
-        endUpdateResource(&lightUniformUpdate, NULL);
+    static_assert(MovingCubeObject == LightObject + 1, "One write covers both moving objects");
+    auto *pMoving = (mat4 *)AllocateUpload(pObjectBuffers[imageIndex], LightObject * sizeof(mat4), 2 * sizeof(mat4),
+                                           RESOURCE_STATE_SHADER_RESOURCE);
+    if (pMoving != nullptr) {
+        pMoving[0] = mat4::translation(f3Tov3(mLightPos)) * mat4::scale(vec3{0.2f});
+        pMoving[1] = MovingCubeTransform();
     }
 
-    // cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
-    const uint32_t stride = sizeof(float) * 6;
-    cmdBindPipeline(cmd, pCubePipeline);
-    cmdBindDescriptorSet(cmd, imageIndex, pCubeUniformsDS);
-    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
-    cmdDraw(cmd, 36, 0);
-    // cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    if (mTransformsCubeCount != mCubeCount) {
+        mTransformsCubeCount = mCubeCount;
+        mObjectSetVersion++;
+    }
+    if (mTransformsVersions[imageIndex] != mObjectSetVersion) {
+        mTransformsVersions[imageIndex] = mObjectSetVersion;
+
+        // One write per object, consecutive objects end up in the same copy.
+        Buffer *pObjects = pObjectBuffers[imageIndex];
+        for (uint32_t i = 0; i < mCubeCount; ++i) {
+            auto *pTransform = (mat4 *)AllocateUpload(pObjects, (FirstCubeObject + i) * sizeof(mat4), sizeof(mat4),
+                                                      RESOURCE_STATE_SHADER_RESOURCE);
+            if (pTransform == nullptr) {
+                // Written again on a later frame.
+                mTransformsVersions[imageIndex] = 0;
+                break;
+            }
+            *pTransform = mat4::translation(CubePosition(i));
+        }
+    }
 
-    // cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Skybox");
-    cmdBindPipeline(cmd, pLightPipeline);
-    cmdBindDescriptorSet(cmd, imageIndex, pLightUniformsDS);
-    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
-    cmdDraw(cmd, 36, 0);
-    // cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
+    ShadowCacheParams shadowParams = {};
+    shadowParams.mLightViewProjection = lightViewProjection;
+    shadowParams.mStaticVersion = mObjectSetVersion;
+    shadowParams.mStaticReady = mTransformsVersions[imageIndex] == mObjectSetVersion;
+    shadowParams.mHasDynamicCasters = bMovingCube;
+    shadowParams.mCacheEnabled = bCacheShadows;
+
+    const uint32_t cubeCount = mCubeCount;
+    AddShadowCachePasses(
+        mShadowCache, shadowParams,
+        [this, imageIndex, cubeCount](Cmd *cmd) { CmdDrawShadowCasters(cmd, imageIndex, FirstCubeObject, cubeCount); },
+        [this, imageIndex](Cmd *cmd) { CmdDrawShadowCasters(cmd, imageIndex, MovingCubeObject, 1); });
+
+    return false;
 }
 
-void Ch2Lighings::Scene02BasicLighting::DrawUI() {}
+void Ch2Lighings::Scene02BasicLighting::Draw(Cmd *cmd, int imageIndex) {
+    const auto start = std::chrono::steady_clock::now();
+
+    if (bCachedCommands) {
+        if (!mDrawStream.bRecorded || mStreamObjects != mVisibleObjects) {
+            RecordDrawStream();
+        }
+        CmdReplayCommandStream(cmd, mDrawStream, imageIndex);
+    } else if (bSortedQueue) {
+        CmdDrawQueued(cmd, imageIndex);
+    } else {
+        CmdDrawImmediate(cmd, imageIndex);
+    }
+
+    const float elapsedUs =
+        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+    float &average = bCachedCommands ? mCachedRecordUs : bSortedQueue ? mQueuedRecordUs : mImmediateRecordUs;
+    average = average == 0.0f ? elapsedUs : average * 0.95f + elapsedUs * 0.05f;
+}
 
 bool Ch2Lighings::Scene02BasicLighting::Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) {
     {
         BufferLoadDesc ubDesc = {};
         ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
         ubDesc.mDesc.mSize = sizeof(UniformBlock);
-        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        ubDesc.mDesc.mStartState = RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
         ubDesc.pData = NULL;
 
-        for (auto &buffer : pCubeUniformBuffers) {
+        for (auto &buffer : pUniformBuffers) {
             ubDesc.ppBuffer = &buffer;
-            addResource(&ubDesc, NULL);
+            AddTrackedResource(&ubDesc, NULL);
         }
     }
 
     {
-        BufferLoadDesc ubDesc = {};
-        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
-        ubDesc.mDesc.mSize = sizeof(UniformBlock);
-        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
-        ubDesc.pData = NULL;
-
-        for (auto &buffer : pLightUniformBuffers) {
-            ubDesc.ppBuffer = &buffer;
-            addResource(&ubDesc, NULL);
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = ObjectCount * sizeof(mat4);
+        desc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = ObjectCount;
+        desc.mDesc.mStructStride = sizeof(mat4);
+        desc.pData = NULL;
+
+        for (auto &buffer : pObjectBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
         }
     }
 
     waitForAllResourceLoads();
 
+    if (!LoadShadowCache(mShadowCache, pRenderer)) {
+        return false;
+    }
+
+    // The buffers are new, their transforms have to be written again.
+    mTransformsVersions = {};
+
+    Texture *pShadowMap = ShadowMapTexture(mShadowCache);
     for (uint32_t i = 0; i < ImageCount; ++i) {
-        DescriptorData params{};
-        auto size = sizeof(UniformBlock);
-        params.pName = "uniformBlock";
-        params.ppBuffers = &pCubeUniformBuffers[i];
-        updateDescriptorSet(pRenderer, i, pCubeUniformsDS, 1, &params);
-
-        params.ppBuffers = &pLightUniformBuffers[i];
-        updateDescriptorSet(pRenderer, i, pLightUniformsDS, 1, &params);
+        DescriptorData params[3] = {};
+        params[0].pName = "uniformBlock";
+        params[0].ppBuffers = &pUniformBuffers[i];
+        params[1].pName = "objectTransforms";
+        params[1].ppBuffers = &pObjectBuffers[i];
+        params[2].pName = "shadowMap";
+        params[2].ppTextures = &pShadowMap;
+        UpdateDescriptors(mUniformsDescriptors, i, 3, params);
+
+        DescriptorData casterParams[2] = {};
+        casterParams[0].pName = "uniformBlock";
+        casterParams[0].ppBuffers = &pUniformBuffers[i];
+        casterParams[1].pName = "objectTransforms";
+        casterParams[1].ppBuffers = &pObjectBuffers[i];
+        UpdateDescriptors(mShadowCasterDescriptors, i, 2, casterParams);
     }
 
     {
@@ -321,40 +584,88 @@ bool Ch2Lighings::Scene02BasicLighting::Load(Renderer *pRenderer, SwapChain *pSw
         pipelineSettings.pRootSignature = pRootSignature;
         pipelineSettings.pVertexLayout = &vertexLayout;
         pipelineSettings.pRasterizerState = &rasterizerStateDesc;
-        pipelineSettings.pShaderProgram = lightCubeShader;
+        pipelineSettings.pShaderProgram = pLightCubeShader;
 
-        addPipeline(pRenderer, &desc, &pLightPipeline);
+        pLightPipeline = AcquirePipeline(desc);
 
-        pipelineSettings.pShaderProgram = lightingShader;
+        pipelineSettings.pShaderProgram = pLightingShader;
 
-        addPipeline(pRenderer, &desc, &pCubePipeline);
+        pCubePipeline = AcquirePipeline(desc);
+    }
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = true;
+        depthStateDesc.mDepthWrite = true;
+        depthStateDesc.mDepthFunc = CMP_GEQUAL;
+
+        VertexLayout vertexLayout = {};
+        vertexLayout.mAttribCount = 1;
+        vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+        vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+        vertexLayout.mAttribs[0].mBinding = 0;
+        vertexLayout.mAttribs[0].mLocation = 0;
+        vertexLayout.mAttribs[0].mOffset = 0;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 0;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.mSampleCount = SAMPLE_COUNT_1;
+        pipelineSettings.mSampleQuality = 0;
+        pipelineSettings.mDepthStencilFormat = ShadowMapFormat();
+        pipelineSettings.pRootSignature = pShadowRootSignature;
+        pipelineSettings.pVertexLayout = &vertexLayout;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = pShadowCasterShader;
+
+        pShadowCasterPipeline = AcquirePipeline(desc);
     }
     return true;
 }
 
 void Ch2Lighings::Scene02BasicLighting::Unload(Renderer *pRenderer) {
 
-    for (auto &buffer : pCubeUniformBuffers) {
-        removeResource(buffer);
+    for (auto &buffer : pUniformBuffers) {
+        RemoveTrackedResource(buffer);
     }
 
-    for (auto &buffer : pLightUniformBuffers) {
-        removeResource(buffer);
+    for (auto &buffer : pObjectBuffers) {
+        RemoveTrackedResource(buffer);
     }
 
-    removePipeline(pRenderer, pCubePipeline);
-    removePipeline(pRenderer, pLightPipeline);
+    ReleasePipeline(pCubePipeline);
+    ReleasePipeline(pLightPipeline);
+    ReleasePipeline(pShadowCasterPipeline);
+
+    UnloadShadowCache(mShadowCache, pRenderer);
+
+    // Holds the pipelines just released.
+    ResetCommandStream(mDrawStream);
 }
 
 void Ch2Lighings::Scene02BasicLighting::Exit(Renderer *pRenderer) {
     exitCameraController(pCameraController);
-    removeRootSignature(pRenderer, pRootSignature);
 
-    removeResource(pVerticesBuffer);
+    mCubeBvh = {};
+    mBvhCubeCount = 0;
+
+    FreeDescriptors(mUniformsDescriptors);
+    FreeDescriptors(mShadowCasterDescriptors);
+    ReleaseRootSignature(pRootSignature);
+    ReleaseRootSignature(pShadowRootSignature);
+
+    ExitShadowCache(mShadowCache, pRenderer);
 
-    removeShader(pRenderer, lightingShader);
-    removeShader(pRenderer, lightCubeShader);
+    ReleaseBuffer(pVerticesBuffer);
 
-    removeDescriptorSet(pRenderer, pCubeUniformsDS);
-    removeDescriptorSet(pRenderer, pLightUniformsDS);
+    ReleaseShader(pLightingShader);
+    ReleaseShader(pLightCubeShader);
+    ReleaseShader(pShadowCasterShader);
 }
@@ -2,18 +2,113 @@
 
 #include "Scene.h"
 
+#include "Bvh.h"
+#include "CommandStream.h"
+#include "DescriptorCache.h"
 #include "MainApp.h"
+#include "RenderQueue.h"
+#include "ShadowCache.h"
+
+#include <Common_3/OS/Interfaces/IUI.h>
+
+#include <array>
+#include <vector>
 
 namespace Ch2Lighings {
-namespace Scene02BasicLighting {
-Scene Create();
-
-void Update(float deltaTime);
-void Draw(Cmd *cmd, int imageIndex);
-auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
-void Unload(Renderer *pRenderer);
-void DrawUI();
-void Init(Renderer *pRenderer);
-void Exit(Renderer *pRenderer);
-}; // namespace Scene02BasicLighting
-} // namespace Ch2Lighings
+class Scene02BasicLighting : public Scene {
+  public:
+    static constexpr const char *Name = "2.2 Basic Lighting";
+
+    auto Update(float deltaTime) -> bool;
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Camera() -> ICameraController *;
+    void Activate();
+    void Deactivate();
+
+  private:
+    auto MovingCubeTransform() const -> mat4;
+    auto ObjectPosition(uint32_t object) const -> vec3;
+    auto LightViewProjection() const -> mat4;
+    void CmdDrawImmediate(Cmd *cmd, int imageIndex);
+    void CmdDrawQueued(Cmd *cmd, int imageIndex);
+    void RecordDrawStream();
+    void CmdDrawShadowCasters(Cmd *cmd, int imageIndex, uint32_t firstObject, uint32_t objectCount);
+
+    Shader *pLightingShader = nullptr;
+    Shader *pLightCubeShader = nullptr;
+    Shader *pShadowCasterShader = nullptr;
+
+    RootSignature *pRootSignature = nullptr;
+    uint32_t mObjectConstantsIndex = 0;
+    Pipeline *pCubePipeline = nullptr;
+    Pipeline *pLightPipeline = nullptr;
+
+    // The casters have their own root signature, so the shadow map bound for the main pass is not
+    // bound while they draw into it.
+    RootSignature *pShadowRootSignature = nullptr;
+    uint32_t mShadowConstantsIndex = 0;
+    Pipeline *pShadowCasterPipeline = nullptr;
+    DescriptorRange mShadowCasterDescriptors = {};
+    ShadowCache mShadowCache;
+
+    std::array<Buffer *, ImageCount> pUniformBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pObjectBuffers = {nullptr};
+    DescriptorRange mUniformsDescriptors = {};
+
+    ICameraController *pCameraController = nullptr;
+    mat4 mLastView = mat4::identity();
+    float3 mLightPos{1.2f, 1.0f, 2.0f};
+    float3 mObjectColor{1.0f, 0.5f, 0.31f};
+    float3 mLightColor{1.0f, 1.0f, 1.0f};
+    float mMovingCubeAngle = 0.0f;
+
+    // Bounding sphere of the static casters, the light's frustum is fitted to it.
+    vec3 mCasterCenter{0.0f};
+    float mCasterRadius = 1.0f;
+
+    Buffer *pVerticesBuffer = nullptr;
+
+    UIComponent *pWindow = nullptr;
+    uint32_t mCubeCount = 1;
+    bool bCachedCommands = true;
+    bool bSortedQueue = true;
+    bool bMoveLight = false;
+    bool bMovingCube = false;
+    bool bCacheShadows = true;
+    char mShadowStatsText[128] = {};
+
+    // Rebuilt every frame when the draws are not cached.
+    RenderQueue mDrawQueue;
+    // The grid cubes and the moving cube, which is refit every frame.
+    Bvh mCubeBvh;
+    uint32_t mBvhCubeCount = 0;
+    // Found in AddPasses, the objects of the cubes every mode draws.
+    std::vector<uint32_t> mVisibleObjects;
+    mat4 mViewProjection = mat4::identity();
+    char mQueueStatsText[64] = {};
+
+    // The draw stream is recorded again when the pipelines or the objects drawn change, which
+    // includes the cubes in view.
+    CommandStream mDrawStream;
+    std::vector<uint32_t> mStreamObjects;
+
+    // The cubes' transforms only change with the number of cubes, each frame's buffer is rewritten
+    // once after that. The light and the moving cube are written every frame.
+    uint32_t mObjectSetVersion = 1;
+    std::array<uint32_t, ImageCount> mTransformsVersions = {};
+    uint32_t mTransformsCubeCount = 0;
+
+    // Moving averages of the CPU time spent recording the draws, per mode.
+    float mCachedRecordUs = 0.0f;
+    float mQueuedRecordUs = 0.0f;
+    float mImmediateRecordUs = 0.0f;
+    char mRecordStatsText[128] = {};
+    float4 mRecordStatsColor{1.0f, 1.0f, 1.0f, 1.0f};
+    float mStatsTime = 0.0f;
+};
+}; // namespace Ch2Lighings
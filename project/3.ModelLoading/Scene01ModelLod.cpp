@@ -0,0 +1,541 @@
+#include "Scene01ModelLod.h"
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/ICameraController.h>
+#include <Common_3/OS/Interfaces/IUI.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+#include "AssetPack.h"
+#include "DescriptorCache.h"
+#include "DynamicResolution.h"
+#include "HiZOcclusion.h"
+#include "IdleFrames.h"
+#include "MemoryBudget.h"
+#include "MeshLod.h"
+#include "PipelineStateCache.h"
+#include "QualityPresets.h"
+#include "ResourceCache.h"
+
+// Based on https://learnopengl.com/Model-Loading/Model
+// A grid of Meshes/model.glb instances, each drawn with the level of detail picked from its screen space error.
+// With occlusion culling on, culling and level selection move to the GPU, see HiZOcclusion.h.
+
+namespace {
+constexpr float GridSpacing = 4.0f;
+
+// Instance index lists a frame can draw from: the CPU sorted list, then every visible set of the Hi-Z pass.
+constexpr uint32_t CpuInstanceList = 0;
+constexpr uint32_t InstanceListCount = 1 + HiZVisibleSetCount;
+
+struct UniformBlock {
+    mat4 view;
+    mat4 projection;
+
+    alignas(16) float3 objectColor;
+    alignas(16) float3 lightColor;
+
+    alignas(16) float3 lightPos;
+    alignas(16) float3 viewPos;
+};
+} // namespace
+
+static auto CreateModelVertexLayout() -> VertexLayout {
+    VertexLayout vertexLayout = {};
+    vertexLayout.mAttribCount = 2;
+    vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+    vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+    vertexLayout.mAttribs[0].mBinding = 0;
+    vertexLayout.mAttribs[0].mLocation = 0;
+    vertexLayout.mAttribs[0].mOffset = 0;
+    vertexLayout.mAttribs[1].mSemantic = SEMANTIC_NORMAL;
+    vertexLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+    vertexLayout.mAttribs[1].mBinding = 0;
+    vertexLayout.mAttribs[1].mLocation = 1;
+    vertexLayout.mAttribs[1].mOffset = 3 * sizeof(float);
+
+    return vertexLayout;
+}
+
+void Ch3ModelLoading::Scene01ModelLod::BuildLodChain() {
+    const Geometry::ShadowData *pShadow = pModelGeometry->pShadow;
+    const float3 *pPositions = (const float3 *)pShadow->pAttributes[SEMANTIC_POSITION];
+
+    std::vector<uint32_t> indices(pModelGeometry->mIndexCount);
+    for (uint32_t i = 0; i < pModelGeometry->mIndexCount; ++i) {
+        indices[i] = pModelGeometry->mIndexType == INDEX_TYPE_UINT16 ? ((const uint16_t *)pShadow->pIndices)[i]
+                                                                       : ((const uint32_t *)pShadow->pIndices)[i];
+    }
+
+    GenerateMeshLodChain(pPositions, pModelGeometry->mVertexCount, indices.data(), (uint32_t)indices.size(),
+                         MaxMeshLodLevels, &mLodChain);
+
+    for (uint32_t i = 0; i < (uint32_t)mLodChain.mLevels.size(); ++i) {
+        const MeshLodLevel &level = mLodChain.mLevels[i];
+        LOGF(LogLevel::eINFO, "model.glb LOD %u: %u triangles, error %f", i, level.mIndexCount / 3, level.mError);
+    }
+}
+
+// The mesh is the largest file of the scene, Init then loads it from memory.
+void Ch3ModelLoading::Scene01ModelLod::Prepare() { PrefetchResourceFile(RD_MESHES, "model.glb"); }
+
+void Ch3ModelLoading::Scene01ModelLod::Init(Renderer *pRenderer) {
+    auto &&mSettings = AppInstance()->mSettings;
+
+    const QualityPreset &preset = ActiveQualityPreset();
+    mGridSize = preset.mModelGridSize;
+    mInstanceCount = mGridSize * mGridSize;
+    mMaxLodErrorPx = preset.mMaxLodErrorPx;
+
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"3.1.model_lod.vert", nullptr, 0};
+        desc.mStages[1] = {"3.1.model_lod.frag", nullptr, 0};
+
+        pModelShader = AcquireShader(desc);
+
+        desc.mStages[1] = {};
+        pDepthOnlyShader = AcquireShader(desc);
+    }
+
+    {
+        VertexLayout vertexLayout = CreateModelVertexLayout();
+
+        // Keep a CPU copy of the mesh, the LOD chain is built from it.
+        GeometryLoadDesc desc = {};
+        desc.pFileName = "model.glb";
+        desc.pVertexLayout = &vertexLayout;
+        desc.mFlags = GEOMETRY_LOAD_FLAG_SHADOWED;
+        desc.ppGeometry = &pModelGeometry;
+
+        SyncToken token = {};
+        addResource(&desc, &token);
+        waitForToken(&token);
+        TrackGpuAllocation(pModelGeometry, GeometryBytes(pModelGeometry));
+    }
+
+    BuildLodChain();
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_INDEX_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = mLodChain.mIndices.size() * sizeof(uint32_t);
+        desc.pData = mLodChain.mIndices.data();
+        desc.ppBuffer = &pLodIndexBuffer;
+
+        AddTrackedResource(&desc, NULL);
+    }
+
+    mInstanceTransforms.resize(mInstanceCount);
+    mInstanceCenters.resize(mInstanceCount);
+    mInstanceLods.resize(mInstanceCount);
+    for (uint32_t z = 0; z < mGridSize; ++z) {
+        for (uint32_t x = 0; x < mGridSize; ++x) {
+            vec3 position{((float)x - mGridSize * 0.5f) * GridSpacing, 0.0f, -(float)z * GridSpacing};
+
+            mInstanceTransforms[z * mGridSize + x] = mat4::translation(position);
+            mInstanceCenters[z * mGridSize + x] = position + f3Tov3(mLodChain.mBoundsCenter);
+        }
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = mInstanceCount * sizeof(mat4);
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = mInstanceCount;
+        desc.mDesc.mStructStride = sizeof(mat4);
+        desc.pData = mInstanceTransforms.data();
+        desc.ppBuffer = &pInstanceTransformBuffer;
+
+        AddTrackedResource(&desc, NULL);
+    }
+
+    {
+        std::vector<float4> bounds(mInstanceCount);
+        for (uint32_t i = 0; i < mInstanceCount; ++i) {
+            bounds[i] = float4(v3ToF3(mInstanceCenters[i]), mLodChain.mBoundsRadius);
+        }
+        InitHiZOcclusion(mHiZ, pRenderer, bounds.data(), mInstanceCount, mLodChain);
+    }
+
+    {
+        Shader *shaders[] = {pModelShader, pDepthOnlyShader};
+        pRootSignature = AcquireRootSignature(shaders, 2);
+
+        mDrawConstantsIndex = getDescriptorIndexFromName(pRootSignature, "drawConstants");
+    }
+
+    CameraMotionParameters cmp{16.0f, 10.0f, 20.0f};
+    vec3 camPos{0.0f, 4.0f, 8.0f};
+    vec3 lookAt{0.0f, 0.0f, -8.0f};
+
+    pCameraController = initFpsCameraController(camPos, lookAt);
+    pCameraController->setMotionParameters(cmp);
+
+    mInstancesDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1);
+    mUniformsDescriptors =
+        AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount * InstanceListCount);
+}
+
+// The window is only created while the scene is shown, Init may run while another scene is on screen.
+void Ch3ModelLoading::Scene01ModelLod::Activate() {
+    auto &&mSettings = AppInstance()->mSettings;
+
+    UIComponentDesc guiDesc{};
+    guiDesc.mStartPosition = vec2(mSettings.mWidth * 0.75f, mSettings.mHeight * 0.2f);
+    uiCreateComponent("Model LOD", &guiDesc, &pLodWindow);
+
+    CheckboxWidget lodToggle;
+    lodToggle.pData = &bLodEnabled;
+    uiCreateComponentWidget(pLodWindow, "Enable LOD", &lodToggle, WIDGET_TYPE_CHECKBOX);
+
+    SliderFloatWidget maxError;
+    maxError.pData = &mMaxLodErrorPx;
+    maxError.mMin = 0.1f;
+    maxError.mMax = 16.0f;
+    maxError.mStep = 0.1f;
+    uiCreateComponentWidget(pLodWindow, "Max Error (px)", &maxError, WIDGET_TYPE_SLIDER_FLOAT);
+
+    DynamicTextWidget stats;
+    stats.pText = mLodStatsText;
+    stats.mLength = sizeof(mLodStatsText);
+    stats.pColor = &mLodStatsColor;
+    uiCreateComponentWidget(pLodWindow, "Triangles", &stats, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    CheckboxWidget occlusionToggle;
+    occlusionToggle.pData = &bOcclusionEnabled;
+    uiCreateComponentWidget(pLodWindow, "Occlusion Culling", &occlusionToggle, WIDGET_TYPE_CHECKBOX);
+
+    DynamicTextWidget occlusionStats;
+    occlusionStats.pText = mOcclusionStatsText;
+    occlusionStats.mLength = sizeof(mOcclusionStatsText);
+    occlusionStats.pColor = &mLodStatsColor;
+    uiCreateComponentWidget(pLodWindow, "Instances", &occlusionStats, WIDGET_TYPE_DYNAMIC_TEXT);
+}
+
+void Ch3ModelLoading::Scene01ModelLod::Deactivate() {
+    uiDestroyComponent(pLodWindow);
+    pLodWindow = nullptr;
+}
+
+auto Ch3ModelLoading::Scene01ModelLod::Camera() -> ICameraController * { return pCameraController; }
+
+auto Ch3ModelLoading::Scene01ModelLod::Update(float deltaTime) -> bool {
+    pCameraController->update(deltaTime);
+
+    // From the counts of the last frame drawn, refreshed once per second.
+    mStatsTime += deltaTime;
+    if (mStatsTime >= 1.0f) {
+        mStatsTime = 0.0f;
+
+        if (bOcclusionEnabled) {
+            const HiZCullStats stats = HiZStats(mHiZ);
+            snprintf(mLodStatsText, sizeof(mLodStatsText), "selected on GPU");
+            snprintf(mOcclusionStatsText, sizeof(mOcclusionStatsText),
+                     "%u drawn / %u culled, %.2f ms (%.2f ms without)", stats.mDrawnInstances,
+                     stats.mCulledInstances, mCulledFrameMs, mBaselineFrameMs);
+        } else {
+            snprintf(mLodStatsText, sizeof(mLodStatsText), "%llu submitted / %llu without LOD",
+                     (unsigned long long)mTrianglesSubmitted, (unsigned long long)mTrianglesWithoutLod);
+            snprintf(mOcclusionStatsText, sizeof(mOcclusionStatsText), "%u drawn, %.2f ms (%.2f ms with culling)",
+                     mInstanceCount, mBaselineFrameMs, mCulledFrameMs);
+        }
+    }
+
+    return CameraMoved(pCameraController, &mLastView);
+}
+
+static auto ProjectionMatrix() -> mat4 {
+    auto &&mSettings = AppInstance()->mSettings;
+
+    const float aspectInverse = (float)mSettings.mHeight / (float)mSettings.mWidth;
+    const float horizontal_fov = PI / 2.0f;
+    return mat4::perspective(horizontal_fov, aspectInverse, 1000.0f, 0.1f);
+}
+
+static auto PixelsPerUnit() -> float {
+    auto &&mSettings = AppInstance()->mSettings;
+    return LodPixelsPerUnit(PI / 2.0f, (float)mSettings.mWidth * DynamicResolutionScale());
+}
+
+void Ch3ModelLoading::Scene01ModelLod::CmdDrawInstanceList(Cmd *cmd, Pipeline *pPipeline, int imageIndex,
+                                                           uint32_t list) {
+    cmdBindPipeline(cmd, pPipeline);
+    CmdBindDescriptors(cmd, mInstancesDescriptors, 0);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex * InstanceListCount + list);
+    cmdBindVertexBuffer(cmd, 1, &pModelGeometry->pVertexBuffers[0], &pModelGeometry->mVertexStrides[0], NULL);
+    cmdBindIndexBuffer(cmd, pLodIndexBuffer, INDEX_TYPE_UINT32, 0);
+
+    const uint32_t levelCount = (uint32_t)mLodChain.mLevels.size();
+    for (uint32_t lod = 0; lod < levelCount; ++lod) {
+        if (list == CpuInstanceList) {
+            const LodBatch &batch = mLodBatches[lod];
+            if (batch.mInstanceCount == 0) {
+                continue;
+            }
+
+            const MeshLodLevel &level = mLodChain.mLevels[lod];
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &batch.mInstanceOffset);
+            cmdDrawIndexedInstanced(cmd, level.mIndexCount, level.mIndexOffset, batch.mInstanceCount, 0, 0);
+        } else {
+            const uint32_t instanceOffset = lod * mInstanceCount;
+            cmdBindPushConstants(cmd, pRootSignature, mDrawConstantsIndex, &instanceOffset);
+            CmdDrawHiZVisibleLod(cmd, mHiZ, list - 1, lod);
+        }
+    }
+}
+
+auto Ch3ModelLoading::Scene01ModelLod::AddPasses(int imageIndex, RGResource depthBuffer) -> bool {
+    mat4 viewMat = pCameraController->getViewMatrix();
+    vec3 viewPos = pCameraController->getViewPosition();
+    mat4 projMat = ProjectionMatrix();
+
+    {
+        UniformBlock uniform;
+        uniform.projection = projMat;
+        uniform.view = viewMat;
+        uniform.lightColor = mLightColor;
+        uniform.objectColor = mObjectColor;
+        uniform.lightPos = mLightPos;
+        uniform.viewPos = v3ToF3(viewPos);
+
+        BufferUpdateDesc uniformUpdate = {pUniformBuffers[imageIndex]};
+        BeginTrackedUpdate(&uniformUpdate);
+        *(UniformBlock *)uniformUpdate.pMappedData = uniform;
+        endUpdateResource(&uniformUpdate, NULL);
+    }
+
+    (bOcclusionEnabled ? mCulledFrameMs : mBaselineFrameMs) = getGpuProfileAvgTime(GpuProfileToken());
+
+    if (!bOcclusionEnabled) {
+        return false;
+    }
+
+    // Lay down the depth of what was visible last frame, seen from this frame's camera, and
+    // cull every instance against the pyramid built from it.
+    RGPass prepass = AddRenderGraphPass("Depth Prepass", [this, imageIndex, depthBuffer](Cmd *cmd) {
+        CmdSetDynamicResolutionViewport(cmd, RenderGraphTarget(depthBuffer));
+        CmdDrawInstanceList(cmd, pDepthOnlyPipeline, imageIndex, 1 + HiZCurrentSet(mHiZ));
+    });
+    PassDepthAttachment(prepass, depthBuffer, LOAD_ACTION_CLEAR);
+
+    RGPass pyramid = AddRenderGraphPass("Build HiZ", [this](Cmd *cmd) { BuildHiZPyramid(cmd, mHiZ); });
+    PassRead(pyramid, depthBuffer, RESOURCE_STATE_SHADER_RESOURCE);
+    PassSideEffect(pyramid);
+
+    HiZCullParams params = {};
+    params.mViewProjection = projMat * viewMat;
+    params.mViewPosition = viewPos;
+    params.mPixelsPerUnit = PixelsPerUnit();
+    // Zero tolerance keeps every instance on the finest level.
+    params.mMaxLodErrorPx = bLodEnabled ? mMaxLodErrorPx : 0.0f;
+    params.mOcclusionEnabled = true;
+    params.mViewportScale = DynamicResolutionScale();
+
+    // Writes the visible sets and indirect arguments the main pass draws from.
+    RGPass cull = AddRenderGraphPass("Cull Instances", [this, imageIndex, params](Cmd *cmd) {
+        CullInstances(cmd, mHiZ, imageIndex, params);
+    });
+    PassSideEffect(cull);
+
+    return true;
+}
+
+void Ch3ModelLoading::Scene01ModelLod::Draw(Cmd *cmd, int imageIndex) {
+    if (bOcclusionEnabled) {
+        CmdDrawInstanceList(cmd, pModelPipeline, imageIndex, 1 + HiZCurrentSet(mHiZ));
+        return;
+    }
+
+    // Pick a level per instance, then counting-sort the instances by level so that every
+    // level is one contiguous range of the instance list and one instanced draw.
+    vec3 viewPos = pCameraController->getViewPosition();
+    const float pixelsPerUnit = PixelsPerUnit();
+    const uint32_t levelCount = (uint32_t)mLodChain.mLevels.size();
+
+    std::array<uint32_t, MaxMeshLodLevels> levelCounts = {};
+    for (uint32_t i = 0; i < mInstanceCount; ++i) {
+        uint32_t lod = 0;
+        if (bLodEnabled) {
+            float distance = length(mInstanceCenters[i] - viewPos) - mLodChain.mBoundsRadius;
+            lod = SelectMeshLod(mLodChain, distance, pixelsPerUnit, mMaxLodErrorPx);
+        }
+        mInstanceLods[i] = lod;
+        levelCounts[lod]++;
+    }
+
+    mTrianglesSubmitted = 0;
+    mTrianglesWithoutLod = (uint64_t)mInstanceCount * (mLodChain.mLevels[0].mIndexCount / 3);
+
+    uint32_t offset = 0;
+    for (uint32_t lod = 0; lod < levelCount; ++lod) {
+        mLodBatches[lod] = {offset, levelCounts[lod]};
+        offset += levelCounts[lod];
+        mTrianglesSubmitted += (uint64_t)levelCounts[lod] * (mLodChain.mLevels[lod].mIndexCount / 3);
+    }
+
+    {
+        BufferUpdateDesc instanceUpdate = {pInstanceIndexBuffers[imageIndex]};
+        BeginTrackedUpdate(&instanceUpdate);
+        uint32_t *pIndices = (uint32_t *)instanceUpdate.pMappedData;
+
+        std::array<uint32_t, MaxMeshLodLevels> cursors = {};
+        for (uint32_t i = 0; i < mInstanceCount; ++i) {
+            const uint32_t lod = mInstanceLods[i];
+            pIndices[mLodBatches[lod].mInstanceOffset + cursors[lod]++] = i;
+        }
+        endUpdateResource(&instanceUpdate, NULL);
+    }
+
+    CmdDrawInstanceList(cmd, pModelPipeline, imageIndex, CpuInstanceList);
+}
+
+bool Ch3ModelLoading::Scene01ModelLod::Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) {
+    {
+        BufferLoadDesc ubDesc = {};
+        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        ubDesc.mDesc.mSize = sizeof(UniformBlock);
+        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        ubDesc.pData = NULL;
+
+        for (auto &buffer : pUniformBuffers) {
+            ubDesc.ppBuffer = &buffer;
+            AddTrackedResource(&ubDesc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        desc.mDesc.mSize = mInstanceCount * sizeof(uint32_t);
+        desc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = mInstanceCount;
+        desc.mDesc.mStructStride = sizeof(uint32_t);
+        desc.pData = NULL;
+
+        for (auto &buffer : pInstanceIndexBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+    }
+
+    waitForAllResourceLoads();
+
+    if (!LoadHiZOcclusion(mHiZ, pRenderer, pDepthBuffer)) {
+        return false;
+    }
+
+    {
+        DescriptorData params[1] = {};
+        params[0].pName = "instanceTransforms";
+        params[0].ppBuffers = &pInstanceTransformBuffer;
+        UpdateDescriptors(mInstancesDescriptors, 0, 1, params);
+    }
+
+    for (uint32_t i = 0; i < ImageCount; ++i) {
+        for (uint32_t list = 0; list < InstanceListCount; ++list) {
+            Buffer *pIndices =
+                list == CpuInstanceList ? pInstanceIndexBuffers[i] : HiZVisibleInstanceBuffer(mHiZ, list - 1);
+
+            DescriptorData params[2] = {};
+            params[0].pName = "uniformBlock";
+            params[0].ppBuffers = &pUniformBuffers[i];
+            params[1].pName = "instanceIndices";
+            params[1].ppBuffers = &pIndices;
+            UpdateDescriptors(mUniformsDescriptors, i * InstanceListCount + list, 2, params);
+        }
+    }
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = true;
+        depthStateDesc.mDepthWrite = true;
+        depthStateDesc.mDepthFunc = CMP_GEQUAL;
+
+        BlendStateDesc blendStateAlphaDesc = {};
+        blendStateAlphaDesc.mSrcFactors[0] = BC_SRC_ALPHA;
+        blendStateAlphaDesc.mDstFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+        blendStateAlphaDesc.mBlendModes[0] = BM_ADD;
+        blendStateAlphaDesc.mSrcAlphaFactors[0] = BC_ONE;
+        blendStateAlphaDesc.mDstAlphaFactors[0] = BC_ZERO;
+        blendStateAlphaDesc.mBlendAlphaModes[0] = BM_ADD;
+        blendStateAlphaDesc.mMasks[0] = ALL;
+        blendStateAlphaDesc.mRenderTargetMask = BLEND_STATE_TARGET_0;
+        blendStateAlphaDesc.mIndependentBlend = false;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        VertexLayout vertexLayout = CreateModelVertexLayout();
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 1;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.pBlendState = &blendStateAlphaDesc;
+        pipelineSettings.pColorFormats = &pSwapChain->ppRenderTargets[0]->mFormat;
+        pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
+        pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
+        pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
+        pipelineSettings.pRootSignature = pRootSignature;
+        pipelineSettings.pVertexLayout = &vertexLayout;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = pModelShader;
+
+        pModelPipeline = AcquirePipeline(desc);
+
+        pipelineSettings.mRenderTargetCount = 0;
+        pipelineSettings.pBlendState = NULL;
+        pipelineSettings.pColorFormats = NULL;
+        pipelineSettings.mSampleCount = pDepthBuffer->mSampleCount;
+        pipelineSettings.mSampleQuality = pDepthBuffer->mSampleQuality;
+        pipelineSettings.pShaderProgram = pDepthOnlyShader;
+
+        pDepthOnlyPipeline = AcquirePipeline(desc);
+    }
+    return true;
+}
+
+void Ch3ModelLoading::Scene01ModelLod::Unload(Renderer *pRenderer) {
+    for (auto &buffer : pUniformBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+
+    for (auto &buffer : pInstanceIndexBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+
+    UnloadHiZOcclusion(mHiZ, pRenderer);
+
+    ReleasePipeline(pModelPipeline);
+    ReleasePipeline(pDepthOnlyPipeline);
+}
+
+void Ch3ModelLoading::Scene01ModelLod::Exit(Renderer *pRenderer) {
+    exitCameraController(pCameraController);
+    FreeDescriptors(mInstancesDescriptors);
+    FreeDescriptors(mUniformsDescriptors);
+    ReleaseRootSignature(pRootSignature);
+
+    ExitHiZOcclusion(mHiZ, pRenderer);
+
+    RemoveTrackedResource(pInstanceTransformBuffer);
+    RemoveTrackedResource(pLodIndexBuffer);
+    UntrackAllocation(pModelGeometry);
+    removeResource(pModelGeometry);
+
+    ReleaseShader(pModelShader);
+    ReleaseShader(pDepthOnlyShader);
+}
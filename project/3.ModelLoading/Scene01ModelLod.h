@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Scene.h"
+
+#include "DescriptorCache.h"
+#include "HiZOcclusion.h"
+#include "MainApp.h"
+#include "MeshLod.h"
+
+#include <Common_3/OS/Interfaces/IUI.h>
+
+#include <array>
+#include <vector>
+
+namespace Ch3ModelLoading {
+class Scene01ModelLod : public Scene {
+  public:
+    static constexpr const char *Name = "3.1 Model LOD";
+
+    auto Update(float deltaTime) -> bool;
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    void Prepare();
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Camera() -> ICameraController *;
+    void Activate();
+    void Deactivate();
+
+  private:
+    struct LodBatch {
+        uint32_t mInstanceOffset;
+        uint32_t mInstanceCount;
+    };
+
+    void BuildLodChain();
+    void CmdDrawInstanceList(Cmd *cmd, Pipeline *pPipeline, int imageIndex, uint32_t list);
+
+    Shader *pModelShader = nullptr;
+    Shader *pDepthOnlyShader = nullptr;
+
+    RootSignature *pRootSignature = nullptr;
+    uint32_t mDrawConstantsIndex = 0;
+    Pipeline *pModelPipeline = nullptr;
+    Pipeline *pDepthOnlyPipeline = nullptr;
+
+    Geometry *pModelGeometry = nullptr;
+    Buffer *pLodIndexBuffer = nullptr;
+    MeshLodChain mLodChain;
+
+    std::array<Buffer *, ImageCount> pUniformBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pInstanceIndexBuffers = {nullptr};
+    Buffer *pInstanceTransformBuffer = nullptr;
+    DescriptorRange mInstancesDescriptors = {};
+    DescriptorRange mUniformsDescriptors = {};
+    HiZOcclusion mHiZ;
+
+    std::vector<mat4> mInstanceTransforms;
+    std::vector<vec3> mInstanceCenters;
+    std::vector<uint32_t> mInstanceLods;
+    std::array<LodBatch, MaxMeshLodLevels> mLodBatches = {};
+
+    ICameraController *pCameraController = nullptr;
+    mat4 mLastView = mat4::identity();
+    float3 mLightPos{0.0f, 20.0f, -20.0f};
+    float3 mObjectColor{1.0f, 0.5f, 0.31f};
+    float3 mLightColor{1.0f, 1.0f, 1.0f};
+
+    UIComponent *pLodWindow = nullptr;
+    bool bLodEnabled = true;
+    float mMaxLodErrorPx = 1.0f;
+
+    // From the quality preset, fixed from Init to Exit.
+    uint32_t mGridSize = 32;
+    uint32_t mInstanceCount = 32 * 32;
+    bool bOcclusionEnabled = true;
+
+    uint64_t mTrianglesSubmitted = 0;
+    uint64_t mTrianglesWithoutLod = 0;
+    char mLodStatsText[128] = {};
+    float4 mLodStatsColor{1.0f, 1.0f, 1.0f, 1.0f};
+
+    // Frame time is sampled separately with culling on and off, the latter being the baseline.
+    float mCulledFrameMs = 0.0f;
+    float mBaselineFrameMs = 0.0f;
+    char mOcclusionStatsText[128] = {};
+    float mStatsTime = 0.0f;
+};
+}; // namespace Ch3ModelLoading
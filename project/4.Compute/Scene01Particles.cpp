@@ -0,0 +1,486 @@
+#include "Scene01Particles.h"
+#include <array>
+#include <cstdio>
+
+#include <Common_3/OS/Interfaces/ICameraController.h>
+#include <Common_3/OS/Interfaces/IUI.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+#include "DescriptorCache.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "QualityPresets.h"
+#include "ResourceCache.h"
+#include "UploadBatcher.h"
+
+// A fountain of particles simulated entirely on the GPU, to measure compute throughput.
+//
+// Each attribute has its own array, positions and velocities, and there are two sets of them. A
+// simulation step reads the set of the previous step and appends the particles still alive to the
+// other set, then appends the particles emitted during the step. The append counter is the
+// instance count of the indirect draw of that set, so the CPU never learns how many particles are
+// alive except from a readback for the UI. The simulation runs at its own rate, several steps or
+// none per frame. Its pass and the draw each have a GPU timestamp, "Simulate Particles" and
+// "Draw Particles" in the GPU profile.
+
+namespace {
+// Matches the emit shader, the emission rate keeps this many particles alive on average.
+constexpr float AverageLifetime = 3.0f;
+// A slow frame runs at most this many steps, the simulation slows down rather than falling behind.
+constexpr uint32_t MaxStepsPerFrame = 4;
+
+struct UniformBlock {
+    mat4 view;
+    mat4 projection;
+
+    alignas(16) float3 youngColor;
+    alignas(16) float3 oldColor;
+    alignas(16) float3 lightColor;
+    alignas(16) float3 lightPos;
+    float particleRadius;
+};
+} // namespace
+
+static auto DispatchSize(uint32_t size, uint32_t groupSize) -> uint32_t { return (size + groupSize - 1) / groupSize; }
+
+void Ch4Compute::Scene01Particles::Init(Renderer *pRenderer) {
+    mParticleCount = ActiveQualityPreset().mParticleCount;
+
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"4.1.particles_simulate.comp", nullptr, 0};
+        pSimulateShader = AcquireShader(desc);
+
+        desc.mStages[0] = {"4.1.particles_emit.comp", nullptr, 0};
+        pEmitShader = AcquireShader(desc);
+    }
+
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"4.1.particles.vert", nullptr, 0};
+        desc.mStages[1] = {"4.1.particles.frag", nullptr, 0};
+        pParticleShader = AcquireShader(desc);
+    }
+
+    {
+        Shader *shaders[] = {pSimulateShader, pEmitShader};
+        pComputeRootSignature = AcquireRootSignature(shaders, 2);
+        mParticleConstantsIndex = getDescriptorIndexFromName(pComputeRootSignature, "particleConstants");
+
+        pRootSignature = AcquireRootSignature(&pParticleShader, 1);
+    }
+
+    {
+        IndirectArgumentDescriptor argDesc = {};
+        argDesc.mType = INDIRECT_DRAW;
+
+        CommandSignatureDesc desc = {};
+        desc.mIndirectArgCount = 1;
+        desc.pArgDescs = &argDesc;
+        desc.mPacked = true;
+        addIndirectCommandSignature(pRenderer, &desc, &pDrawCommandSignature);
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mDesc.mSize = (uint64_t)MaxParticles * sizeof(float4);
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = MaxParticles;
+        desc.mDesc.mStructStride = sizeof(float4);
+        desc.pData = NULL;
+
+        for (uint32_t set = 0; set < ParticleSetCount; ++set) {
+            desc.ppBuffer = &pPositionBuffers[set];
+            AddTrackedResource(&desc, NULL);
+            desc.ppBuffer = &pVelocityBuffers[set];
+            AddTrackedResource(&desc, NULL);
+        }
+    }
+
+    {
+        // No particles yet, every set starts out with an empty draw.
+        static const IndirectDrawArguments drawArgsTemplate = {6, 0, 0, 0};
+
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER_RAW;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+        desc.mDesc.mSize = sizeof(IndirectDrawArguments);
+        desc.mDesc.mElementCount = sizeof(IndirectDrawArguments) / sizeof(uint32_t);
+        desc.mDesc.mStructStride = sizeof(uint32_t);
+        desc.pData = &drawArgsTemplate;
+        desc.ppBuffer = &pDrawArgsTemplateBuffer;
+        AddTrackedResource(&desc, NULL);
+
+        desc.mDesc.mDescriptors =
+            DESCRIPTOR_TYPE_BUFFER_RAW | DESCRIPTOR_TYPE_RW_BUFFER_RAW | DESCRIPTOR_TYPE_INDIRECT_ARGUMENT;
+        desc.mDesc.mStartState = RESOURCE_STATE_INDIRECT_ARGUMENT;
+        for (auto &buffer : pDrawArgsBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc ubDesc = {};
+        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        ubDesc.mDesc.mSize = sizeof(UniformBlock);
+        ubDesc.mDesc.mStartState = RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+        ubDesc.pData = NULL;
+
+        for (auto &buffer : pUniformBuffers) {
+            ubDesc.ppBuffer = &buffer;
+            AddTrackedResource(&ubDesc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNDEFINED;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_TO_CPU;
+        desc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        desc.mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+        desc.mDesc.mSize = sizeof(IndirectDrawArguments);
+        desc.pData = NULL;
+        for (auto &buffer : pReadbackBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+        mReadbackValid = {};
+    }
+
+    mStepDescriptors = AllocateDescriptors(pComputeRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_DRAW, ParticleSetCount);
+    mDrawDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_DRAW, ParticleSetCount);
+    mUniformsDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount);
+
+    waitForAllResourceLoads();
+
+    for (uint32_t set = 0; set < ParticleSetCount; ++set) {
+        const uint32_t dst = (set + 1) % ParticleSetCount;
+
+        DescriptorData params[6] = {};
+        params[0].pName = "srcPositions";
+        params[0].ppBuffers = &pPositionBuffers[set];
+        params[1].pName = "srcVelocities";
+        params[1].ppBuffers = &pVelocityBuffers[set];
+        params[2].pName = "srcDrawArgs";
+        params[2].ppBuffers = &pDrawArgsBuffers[set];
+        params[3].pName = "dstPositions";
+        params[3].ppBuffers = &pPositionBuffers[dst];
+        params[4].pName = "dstVelocities";
+        params[4].ppBuffers = &pVelocityBuffers[dst];
+        params[5].pName = "dstDrawArgs";
+        params[5].ppBuffers = &pDrawArgsBuffers[dst];
+        UpdateDescriptors(mStepDescriptors, set, 6, params);
+
+        DescriptorData drawParam = {};
+        drawParam.pName = "particlePositions";
+        drawParam.ppBuffers = &pPositionBuffers[set];
+        UpdateDescriptors(mDrawDescriptors, set, 1, &drawParam);
+    }
+
+    for (uint32_t i = 0; i < ImageCount; ++i) {
+        DescriptorData param = {};
+        param.pName = "uniformBlock";
+        param.ppBuffers = &pUniformBuffers[i];
+        UpdateDescriptors(mUniformsDescriptors, i, 1, &param);
+    }
+
+    {
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_COMPUTE;
+        ComputePipelineDesc &pipelineSettings = desc.mComputeDesc;
+        pipelineSettings.pRootSignature = pComputeRootSignature;
+
+        pipelineSettings.pShaderProgram = pSimulateShader;
+        pSimulatePipeline = AcquirePipeline(desc);
+
+        pipelineSettings.pShaderProgram = pEmitShader;
+        pEmitPipeline = AcquirePipeline(desc);
+    }
+
+    mCurrentSet = 0;
+    mStepTime = 0.0f;
+    mEmitCarry = 0.0f;
+
+    CameraMotionParameters cmp{16.0f, 10.0f, 20.0f};
+    vec3 camPos{0.0f, 0.5f, 4.0f};
+    vec3 lookAt{0.0f, 0.0f, 0.0f};
+
+    pCameraController = initFpsCameraController(camPos, lookAt);
+    pCameraController->setMotionParameters(cmp);
+}
+
+// The window is only created while the scene is shown, Init may run while another scene is on screen.
+void Ch4Compute::Scene01Particles::Activate() {
+    auto &&mSettings = AppInstance()->mSettings;
+
+    UIComponentDesc guiDesc{};
+    guiDesc.mStartPosition = vec2(mSettings.mWidth * 0.75f, mSettings.mHeight * 0.2f);
+    uiCreateComponent("Compute Particles", &guiDesc, &pWindow);
+
+    SliderUintWidget particleCount;
+    particleCount.pData = &mParticleCount;
+    particleCount.mMin = 1024;
+    particleCount.mMax = MaxParticles;
+    particleCount.mStep = 1024;
+    uiCreateComponentWidget(pWindow, "Particles", &particleCount, WIDGET_TYPE_SLIDER_UINT);
+
+    SliderFloatWidget updateRate;
+    updateRate.pData = &mUpdateRateHz;
+    updateRate.mMin = 10.0f;
+    updateRate.mMax = 240.0f;
+    updateRate.mStep = 1.0f;
+    uiCreateComponentWidget(pWindow, "Update Rate (Hz)", &updateRate, WIDGET_TYPE_SLIDER_FLOAT);
+
+    DynamicTextWidget stats;
+    stats.pText = mParticleStatsText;
+    stats.mLength = sizeof(mParticleStatsText);
+    stats.pColor = &mParticleStatsColor;
+    uiCreateComponentWidget(pWindow, "Simulation", &stats, WIDGET_TYPE_DYNAMIC_TEXT);
+}
+
+void Ch4Compute::Scene01Particles::Deactivate() {
+    uiDestroyComponent(pWindow);
+    pWindow = nullptr;
+}
+
+auto Ch4Compute::Scene01Particles::Camera() -> ICameraController * { return pCameraController; }
+
+// Works out how many steps are due this frame. The particles never rest, every frame is drawn.
+auto Ch4Compute::Scene01Particles::Update(float deltaTime) -> bool {
+    pCameraController->update(deltaTime);
+
+    const float stepSeconds = 1.0f / mUpdateRateHz;
+    mStepTime += deltaTime;
+    mFrameSteps = (uint32_t)(mStepTime / stepSeconds);
+    if (mFrameSteps > MaxStepsPerFrame) {
+        mFrameSteps = MaxStepsPerFrame;
+        mStepTime = 0.0f;
+    } else {
+        mStepTime -= mFrameSteps * stepSeconds;
+    }
+
+    mStatsSteps += mFrameSteps;
+    mStatsTime += deltaTime;
+    if (mStatsTime >= 1.0f) {
+        mStepsPerSecond = mStatsSteps / mStatsTime;
+        mStatsSteps = 0;
+        mStatsTime = 0.0f;
+
+        // Refreshed with the rate, the alive count is the one last read back.
+        snprintf(mParticleStatsText, sizeof(mParticleStatsText), "%u alive, %.0f steps/s, %.1f M particle updates/s",
+                 mAliveParticles, mStepsPerSecond, mAliveParticles * mStepsPerSecond * 1e-6f);
+    }
+
+    return true;
+}
+
+// One step from set src into the other set, which is left ready to draw.
+void Ch4Compute::Scene01Particles::CmdStepParticles(Cmd *cmd, uint32_t src, const ParticleConstants &constants) {
+    const uint32_t dst = (src + 1) % ParticleSetCount;
+
+    {
+        BufferBarrier barrier = {pDrawArgsBuffers[dst], RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_DEST};
+        cmdResourceBarrier(cmd, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    cmdUpdateBuffer(cmd, pDrawArgsBuffers[dst], 0, pDrawArgsTemplateBuffer, 0, sizeof(IndirectDrawArguments));
+
+    {
+        BufferBarrier barriers[] = {
+            {pDrawArgsBuffers[src], RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_SHADER_RESOURCE},
+            {pDrawArgsBuffers[dst], RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_UNORDERED_ACCESS},
+            {pPositionBuffers[dst], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS},
+            {pVelocityBuffers[dst], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS},
+        };
+        cmdResourceBarrier(cmd, 4, barriers, 0, nullptr, 0, nullptr);
+    }
+
+    cmdBindPipeline(cmd, pSimulatePipeline);
+    CmdBindDescriptors(cmd, mStepDescriptors, src);
+    cmdBindPushConstants(cmd, pComputeRootSignature, mParticleConstantsIndex, &constants);
+    // Sized for the capacity, threads past the particles alive in src return at once.
+    cmdDispatch(cmd, DispatchSize(constants.capacity, 64), 1, 1);
+
+    if (constants.emitCount > 0) {
+        BufferBarrier barriers[] = {
+            {pDrawArgsBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS},
+            {pPositionBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS},
+            {pVelocityBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS},
+        };
+        cmdResourceBarrier(cmd, 3, barriers, 0, nullptr, 0, nullptr);
+
+        cmdBindPipeline(cmd, pEmitPipeline);
+        CmdBindDescriptors(cmd, mStepDescriptors, src);
+        cmdBindPushConstants(cmd, pComputeRootSignature, mParticleConstantsIndex, &constants);
+        cmdDispatch(cmd, DispatchSize(constants.emitCount, 64), 1, 1);
+    }
+
+    {
+        BufferBarrier barriers[] = {
+            {pDrawArgsBuffers[src], RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_INDIRECT_ARGUMENT},
+            {pDrawArgsBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_INDIRECT_ARGUMENT},
+            {pPositionBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE},
+            {pVelocityBuffers[dst], RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE},
+        };
+        cmdResourceBarrier(cmd, 4, barriers, 0, nullptr, 0, nullptr);
+    }
+}
+
+// Reads back the instance count of the set last written, which is the number of particles alive.
+void Ch4Compute::Scene01Particles::CmdReadbackAliveCount(Cmd *cmd, int imageIndex, uint32_t set) {
+    {
+        BufferBarrier barrier = {pDrawArgsBuffers[set], RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_SOURCE};
+        cmdResourceBarrier(cmd, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    cmdUpdateBuffer(cmd, pReadbackBuffers[imageIndex], 0, pDrawArgsBuffers[set], 0, sizeof(IndirectDrawArguments));
+
+    {
+        BufferBarrier barrier = {pDrawArgsBuffers[set], RESOURCE_STATE_COPY_SOURCE, RESOURCE_STATE_INDIRECT_ARGUMENT};
+        cmdResourceBarrier(cmd, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+// Adds the simulation pass when a step is due this frame and writes the frame's uniforms through the
+// upload batcher. The sets are assigned here, Draw draws the set the last step writes.
+auto Ch4Compute::Scene01Particles::AddPasses(int imageIndex, RGResource depthBuffer) -> bool {
+    // The fence of imageIndex has been waited on, its readback holds the count of that frame.
+    if (mReadbackValid[imageIndex]) {
+        const auto *pArgs = (const IndirectDrawArguments *)pReadbackBuffers[imageIndex]->pCpuMappedAddress;
+        mAliveParticles = pArgs->mInstanceCount;
+    }
+
+    mat4 viewMat = pCameraController->getViewMatrix();
+    const float aspectInverse = (float)AppInstance()->mSettings.mHeight / (float)AppInstance()->mSettings.mWidth;
+    mat4 projMat = mat4::perspective(PI / 2.0f, aspectInverse, 1000.0f, 0.1f);
+
+    auto *pUniform = (UniformBlock *)AllocateUpload(pUniformBuffers[imageIndex], 0, sizeof(UniformBlock),
+                                                    RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    if (pUniform != nullptr) {
+        pUniform->view = viewMat;
+        pUniform->projection = projMat;
+        pUniform->youngColor = mYoungColor;
+        pUniform->oldColor = mOldColor;
+        pUniform->lightColor = mLightColor;
+        pUniform->lightPos = mLightPos;
+        pUniform->particleRadius = mParticleRadius;
+    }
+
+    if (mFrameSteps == 0) {
+        return false;
+    }
+
+    const float stepSeconds = 1.0f / mUpdateRateHz;
+    const uint32_t firstSet = mCurrentSet;
+    const uint32_t steps = mFrameSteps;
+    std::array<uint32_t, MaxStepsPerFrame> emitCounts = {};
+    for (uint32_t step = 0; step < steps; ++step) {
+        mEmitCarry += mParticleCount / AverageLifetime * stepSeconds;
+        emitCounts[step] = (uint32_t)mEmitCarry;
+        mEmitCarry -= emitCounts[step];
+    }
+    const uint32_t seed = mStepSeed;
+    mStepSeed += steps;
+    mCurrentSet = (firstSet + steps) % ParticleSetCount;
+
+    ParticleConstants constants = {};
+    constants.emitter = mEmitter;
+    constants.deltaTime = stepSeconds;
+    constants.capacity = mParticleCount;
+
+    RGPass simulate = AddRenderGraphPass(
+        "Simulate Particles", [this, imageIndex, firstSet, steps, emitCounts, seed, constants](Cmd *cmd) mutable {
+            for (uint32_t step = 0; step < steps; ++step) {
+                constants.emitCount = emitCounts[step];
+                constants.seed = seed + step;
+                CmdStepParticles(cmd, (firstSet + step) % ParticleSetCount, constants);
+            }
+            CmdReadbackAliveCount(cmd, imageIndex, (firstSet + steps) % ParticleSetCount);
+        });
+    PassSideEffect(simulate);
+    mReadbackValid[imageIndex] = true;
+
+    return false;
+}
+
+void Ch4Compute::Scene01Particles::Draw(Cmd *cmd, int imageIndex) {
+    cmdBeginGpuTimestampQuery(cmd, GpuProfileToken(), "Draw Particles");
+
+    cmdBindPipeline(cmd, pParticlePipeline);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex);
+    CmdBindDescriptors(cmd, mDrawDescriptors, mCurrentSet);
+    cmdExecuteIndirect(cmd, pDrawCommandSignature, 1, pDrawArgsBuffers[mCurrentSet], 0, nullptr, 0);
+
+    cmdEndGpuTimestampQuery(cmd, GpuProfileToken());
+}
+
+bool Ch4Compute::Scene01Particles::Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) {
+    RasterizerStateDesc rasterizerStateDesc = {};
+    rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+    DepthStateDesc depthStateDesc = {};
+    depthStateDesc.mDepthTest = true;
+    depthStateDesc.mDepthWrite = true;
+    depthStateDesc.mDepthFunc = CMP_GEQUAL;
+
+    PipelineDesc desc = {};
+    desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+    GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+    pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+    pipelineSettings.mRenderTargetCount = 1;
+    pipelineSettings.pDepthState = &depthStateDesc;
+    pipelineSettings.pColorFormats = &pSwapChain->ppRenderTargets[0]->mFormat;
+    pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
+    pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
+    pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
+    pipelineSettings.pRootSignature = pRootSignature;
+    pipelineSettings.pVertexLayout = nullptr;
+    pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+    pipelineSettings.pShaderProgram = pParticleShader;
+
+    pParticlePipeline = AcquirePipeline(desc);
+    return true;
+}
+
+void Ch4Compute::Scene01Particles::Unload(Renderer *pRenderer) { ReleasePipeline(pParticlePipeline); }
+
+void Ch4Compute::Scene01Particles::Exit(Renderer *pRenderer) {
+    exitCameraController(pCameraController);
+
+    ReleasePipeline(pSimulatePipeline);
+    ReleasePipeline(pEmitPipeline);
+
+    FreeDescriptors(mStepDescriptors);
+    FreeDescriptors(mDrawDescriptors);
+    FreeDescriptors(mUniformsDescriptors);
+
+    for (auto &buffer : pReadbackBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    for (auto &buffer : pUniformBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    for (auto &buffer : pDrawArgsBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    RemoveTrackedResource(pDrawArgsTemplateBuffer);
+    for (uint32_t set = 0; set < ParticleSetCount; ++set) {
+        RemoveTrackedResource(pPositionBuffers[set]);
+        RemoveTrackedResource(pVelocityBuffers[set]);
+    }
+
+    removeIndirectCommandSignature(pRenderer, pDrawCommandSignature);
+    ReleaseRootSignature(pComputeRootSignature);
+    ReleaseRootSignature(pRootSignature);
+
+    ReleaseShader(pSimulateShader);
+    ReleaseShader(pEmitShader);
+    ReleaseShader(pParticleShader);
+}
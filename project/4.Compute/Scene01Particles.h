@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Scene.h"
+
+#include "DescriptorCache.h"
+#include "MainApp.h"
+
+#include <Common_3/OS/Interfaces/IUI.h>
+
+#include <array>
+
+namespace Ch4Compute {
+class Scene01Particles : public Scene {
+  public:
+    static constexpr const char *Name = "4.1 Compute Particles";
+
+    auto Update(float deltaTime) -> bool;
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Camera() -> ICameraController *;
+    void Activate();
+    void Deactivate();
+
+  private:
+    // What the slider goes up to, the buffers are created for this many.
+    static constexpr uint32_t MaxParticles = 1u << 21;
+    static constexpr uint32_t ParticleSetCount = 2;
+
+    struct ParticleConstants {
+        float4 emitter;
+        float deltaTime;
+        uint32_t capacity;
+        uint32_t emitCount;
+        uint32_t seed;
+    };
+
+    void CmdStepParticles(Cmd *cmd, uint32_t src, const ParticleConstants &constants);
+    void CmdReadbackAliveCount(Cmd *cmd, int imageIndex, uint32_t set);
+
+    Shader *pSimulateShader = nullptr;
+    Shader *pEmitShader = nullptr;
+    Shader *pParticleShader = nullptr;
+
+    RootSignature *pComputeRootSignature = nullptr;
+    uint32_t mParticleConstantsIndex = 0;
+    RootSignature *pRootSignature = nullptr;
+    CommandSignature *pDrawCommandSignature = nullptr;
+
+    Pipeline *pSimulatePipeline = nullptr;
+    Pipeline *pEmitPipeline = nullptr;
+    Pipeline *pParticlePipeline = nullptr;
+
+    std::array<Buffer *, ParticleSetCount> pPositionBuffers = {nullptr};
+    std::array<Buffer *, ParticleSetCount> pVelocityBuffers = {nullptr};
+    std::array<Buffer *, ParticleSetCount> pDrawArgsBuffers = {nullptr};
+    Buffer *pDrawArgsTemplateBuffer = nullptr;
+    std::array<Buffer *, ImageCount> pUniformBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pReadbackBuffers = {nullptr};
+    std::array<bool, ImageCount> mReadbackValid = {};
+
+    // Set i steps from set i to the other one, draws set i.
+    DescriptorRange mStepDescriptors = {};
+    DescriptorRange mDrawDescriptors = {};
+    DescriptorRange mUniformsDescriptors = {};
+
+    ICameraController *pCameraController = nullptr;
+    float4 mEmitter{0.0f, -1.0f, 0.0f, 0.25f};
+    float3 mYoungColor{1.0f, 0.9f, 0.6f};
+    float3 mOldColor{1.0f, 0.5f, 0.31f};
+    float mParticleRadius = 0.01f;
+    // Where the light of 2.2 Basic Lighting starts out.
+    float3 mLightPos{1.2f, 1.0f, 2.0f};
+    float3 mLightColor{1.0f, 1.0f, 1.0f};
+
+    UIComponent *pWindow = nullptr;
+    uint32_t mParticleCount = MaxParticles / 2;
+    float mUpdateRateHz = 60.0f;
+    char mParticleStatsText[128] = {};
+    float4 mParticleStatsColor{1.0f, 1.0f, 1.0f, 1.0f};
+
+    // The set the last step wrote, the one drawn.
+    uint32_t mCurrentSet = 0;
+    float mStepTime = 0.0f;
+    float mEmitCarry = 0.0f;
+    uint32_t mStepSeed = 0;
+    uint32_t mFrameSteps = 0;
+
+    uint32_t mAliveParticles = 0;
+    float mStatsTime = 0.0f;
+    uint32_t mStatsSteps = 0;
+    float mStepsPerSecond = 0.0f;
+};
+}; // namespace Ch4Compute
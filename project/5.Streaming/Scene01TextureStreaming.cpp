@@ -0,0 +1,270 @@
+#include "Scene01TextureStreaming.h"
+#include <array>
+#include <cmath>
+
+#include <Common_3/OS/Interfaces/ICameraController.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+#include "DescriptorCache.h"
+#include "DynamicResolution.h"
+#include "IdleFrames.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "ResourceCache.h"
+#include "UploadBatcher.h"
+
+// A row of textured cubes leading away from the camera. The cube texture is streamed in as the
+// nearest cube gets closer, see TextureStreamer.h, the budget and stats are in the main window.
+
+namespace {
+constexpr uint32_t CubeCount = 16;
+// Along -z, alternating left and right of the camera's start.
+constexpr float CubeSpacing = 3.0f;
+
+struct UniformBlock {
+    mat4 view;
+    mat4 projection;
+
+    alignas(16) float3 lightColor;
+    alignas(16) float3 lightPos;
+};
+} // namespace
+
+static auto CubePosition(uint32_t cube) -> vec3 {
+    return vec3{cube % 2 == 0 ? -1.0f : 1.0f, 0.0f, -CubeSpacing * cube};
+}
+
+void Ch5Streaming::Scene01TextureStreaming::Init(Renderer *pRenderer) {
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"5.1.texture_streaming.vert", nullptr, 0};
+        desc.mStages[1] = {"5.1.texture_streaming.frag", nullptr, 0};
+
+        pCubeShader = AcquireShader(desc);
+    }
+
+    mCubeTexture = AcquireStreamedTexture("texture.dds");
+
+    SamplerDesc samplerDesc = {FILTER_LINEAR,
+                               FILTER_LINEAR,
+                               MIPMAP_MODE_LINEAR,
+                               ADDRESS_MODE_REPEAT,
+                               ADDRESS_MODE_REPEAT,
+                               ADDRESS_MODE_REPEAT};
+    addSampler(pRenderer, &samplerDesc, &pCubeSampler);
+
+    pVerticesBuffer = AcquireBuffer("generateCuboidPoints", [](Buffer **ppBuffer, SyncToken *pToken) {
+        float *pVertices;
+        int vertexCount;
+
+        generateCuboidPoints(&pVertices, &vertexCount);
+        uint64_t cubeDataSize = vertexCount * sizeof(float);
+
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_VERTEX_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = cubeDataSize;
+        desc.pData = pVertices;
+        desc.ppBuffer = ppBuffer;
+
+        addResource(&desc, pToken);
+        tf_free(pVertices);
+    });
+
+    pRootSignature = AcquireRootSignature(&pCubeShader, 1);
+    mObjectConstantsIndex = getDescriptorIndexFromName(pRootSignature, "objectConstants");
+
+    CameraMotionParameters cmp{16.0f, 10.0f, 20.0f};
+    vec3 camPos{0.0f, 0.0f, 3.0f};
+    vec3 lookAt{0.0f, 0.0f, -CubeSpacing};
+
+    pCameraController = initFpsCameraController(camPos, lookAt);
+    pCameraController->setMotionParameters(cmp);
+
+    mUniformsDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount);
+}
+
+auto Ch5Streaming::Scene01TextureStreaming::Camera() -> ICameraController * { return pCameraController; }
+
+// Mips streaming in are a change of MainApp's, see its Update.
+auto Ch5Streaming::Scene01TextureStreaming::Update(float deltaTime) -> bool {
+    pCameraController->update(deltaTime);
+    return CameraMoved(pCameraController, &mLastView);
+}
+
+// Reports the texture's size on screen, keeps the texture descriptor of the frame current and
+// writes the frame's uniforms in place in the upload batcher.
+auto Ch5Streaming::Scene01TextureStreaming::AddPasses(int imageIndex, RGResource depthBuffer) -> bool {
+    mat4 viewMat = pCameraController->getViewMatrix();
+    const float aspectInverse = (float)AppInstance()->mSettings.mHeight / (float)AppInstance()->mSettings.mWidth;
+    const float horizontal_fov = PI / 2.0f;
+    mat4 projMat = mat4::perspective(horizontal_fov, aspectInverse, 1000.0f, 0.1f);
+    const mat4 viewProjection = projMat * viewMat;
+
+    // Each face is mapped to the whole texture, the nearest cube in front of the camera decides its
+    // size. Not culled against the sides of the view, which at worst streams in a mip too many.
+    const vec3 viewPos = pCameraController->getViewPosition();
+    float nearestDistance = INFINITY;
+    for (uint32_t i = 0; i < CubeCount; ++i) {
+        const vec3 position = CubePosition(i);
+        if ((viewProjection * vec4(position, 1.0f)).getW() > 0.0f) {
+            nearestDistance = fmin(nearestDistance, length(position - viewPos) - 0.5f);
+        }
+    }
+    if (nearestDistance < INFINITY) {
+        const float viewportWidth = AppInstance()->mSettings.mWidth * DynamicResolutionScale();
+        const float pixelsPerUnit = viewportWidth * 0.5f / tanf(horizontal_fov * 0.5f);
+        RequestStreamedTextureSize(mCubeTexture, pixelsPerUnit / fmax(nearestDistance, 0.1f));
+    }
+
+    Texture *pCubeTexture = StreamedTextureResource(mCubeTexture);
+    if (pBoundCubeTextures[imageIndex] != pCubeTexture) {
+        pBoundCubeTextures[imageIndex] = pCubeTexture;
+
+        DescriptorData param = {};
+        param.pName = "diffuseTexture";
+        param.ppTextures = &pCubeTexture;
+        UpdateDescriptors(mUniformsDescriptors, imageIndex, 1, &param);
+    }
+
+    auto *pUniform = (UniformBlock *)AllocateUpload(pUniformBuffers[imageIndex], 0, sizeof(UniformBlock),
+                                                    RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    if (pUniform != nullptr) {
+        pUniform->projection = projMat;
+        pUniform->view = viewMat;
+        pUniform->lightColor = mLightColor;
+        pUniform->lightPos = mLightPos;
+    }
+    return false;
+}
+
+void Ch5Streaming::Scene01TextureStreaming::Draw(Cmd *cmd, int imageIndex) {
+    const uint32_t stride = sizeof(float) * 6;
+    cmdBindPipeline(cmd, pCubePipeline);
+    CmdBindDescriptors(cmd, mUniformsDescriptors, imageIndex);
+    cmdBindVertexBuffer(cmd, 1, &pVerticesBuffer, &stride, NULL);
+    for (uint32_t cube = 0; cube < CubeCount; ++cube) {
+        cmdBindPushConstants(cmd, pRootSignature, mObjectConstantsIndex, &cube);
+        cmdDraw(cmd, 36, 0);
+    }
+}
+
+bool Ch5Streaming::Scene01TextureStreaming::Load(Renderer *pRenderer, SwapChain *pSwapChain,
+                                                 RenderTarget *pDepthBuffer) {
+    {
+        BufferLoadDesc ubDesc = {};
+        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        ubDesc.mDesc.mSize = sizeof(UniformBlock);
+        ubDesc.mDesc.mStartState = RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
+        ubDesc.pData = NULL;
+
+        for (auto &buffer : pUniformBuffers) {
+            ubDesc.ppBuffer = &buffer;
+            AddTrackedResource(&ubDesc, NULL);
+        }
+    }
+
+    {
+        std::array<mat4, CubeCount> transforms;
+        for (uint32_t i = 0; i < CubeCount; ++i) {
+            transforms[i] = mat4::translation(CubePosition(i));
+        }
+
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = sizeof(transforms);
+        desc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = CubeCount;
+        desc.mDesc.mStructStride = sizeof(mat4);
+        desc.pData = transforms.data();
+        desc.ppBuffer = &pObjectBuffer;
+        AddTrackedResource(&desc, NULL);
+
+        // transforms is read while the upload is queued.
+        waitForAllResourceLoads();
+    }
+
+    for (uint32_t i = 0; i < ImageCount; ++i) {
+        pBoundCubeTextures[i] = StreamedTextureResource(mCubeTexture);
+
+        DescriptorData params[4] = {};
+        params[0].pName = "uniformBlock";
+        params[0].ppBuffers = &pUniformBuffers[i];
+        params[1].pName = "objectTransforms";
+        params[1].ppBuffers = &pObjectBuffer;
+        params[2].pName = "diffuseTexture";
+        params[2].ppTextures = &pBoundCubeTextures[i];
+        params[3].pName = "diffuseSampler";
+        params[3].ppSamplers = &pCubeSampler;
+        UpdateDescriptors(mUniformsDescriptors, i, 4, params);
+    }
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_FRONT;
+
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = true;
+        depthStateDesc.mDepthWrite = true;
+        depthStateDesc.mDepthFunc = CMP_GEQUAL;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        VertexLayout vertexLayout = {};
+        vertexLayout.mAttribCount = 2;
+        vertexLayout.mAttribs[0].mSemantic = SEMANTIC_POSITION;
+        vertexLayout.mAttribs[0].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+        vertexLayout.mAttribs[0].mBinding = 0;
+        vertexLayout.mAttribs[0].mLocation = 0;
+        vertexLayout.mAttribs[0].mOffset = 0;
+        vertexLayout.mAttribs[1].mSemantic = SEMANTIC_NORMAL;
+        vertexLayout.mAttribs[1].mFormat = TinyImageFormat_R32G32B32_SFLOAT;
+        vertexLayout.mAttribs[1].mBinding = 0;
+        vertexLayout.mAttribs[1].mLocation = 1;
+        vertexLayout.mAttribs[1].mOffset = 3 * sizeof(float);
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 1;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.pColorFormats = &pSwapChain->ppRenderTargets[0]->mFormat;
+        pipelineSettings.mSampleCount = pSwapChain->ppRenderTargets[0]->mSampleCount;
+        pipelineSettings.mSampleQuality = pSwapChain->ppRenderTargets[0]->mSampleQuality;
+        pipelineSettings.mDepthStencilFormat = pDepthBuffer->mFormat;
+        pipelineSettings.pRootSignature = pRootSignature;
+        pipelineSettings.pVertexLayout = &vertexLayout;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = pCubeShader;
+
+        pCubePipeline = AcquirePipeline(desc);
+    }
+    return true;
+}
+
+void Ch5Streaming::Scene01TextureStreaming::Unload(Renderer *pRenderer) {
+    for (auto &buffer : pUniformBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    RemoveTrackedResource(pObjectBuffer);
+
+    ReleasePipeline(pCubePipeline);
+}
+
+void Ch5Streaming::Scene01TextureStreaming::Exit(Renderer *pRenderer) {
+    exitCameraController(pCameraController);
+
+    FreeDescriptors(mUniformsDescriptors);
+    ReleaseRootSignature(pRootSignature);
+
+    ReleaseBuffer(pVerticesBuffer);
+
+    removeSampler(pRenderer, pCubeSampler);
+    ReleaseStreamedTexture(mCubeTexture);
+    mCubeTexture = InvalidStreamedTexture;
+
+    ReleaseShader(pCubeShader);
+}
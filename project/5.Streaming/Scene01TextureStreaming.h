@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Scene.h"
+
+#include "DescriptorCache.h"
+#include "MainApp.h"
+#include "TextureStreamer.h"
+
+#include <array>
+
+namespace Ch5Streaming {
+class Scene01TextureStreaming : public Scene {
+  public:
+    static constexpr const char *Name = "5.1 Texture Streaming";
+
+    auto Update(float deltaTime) -> bool;
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Camera() -> ICameraController *;
+
+  private:
+    Shader *pCubeShader = nullptr;
+
+    RootSignature *pRootSignature = nullptr;
+    uint32_t mObjectConstantsIndex = 0;
+    Pipeline *pCubePipeline = nullptr;
+
+    std::array<Buffer *, ImageCount> pUniformBuffers = {nullptr};
+    // The cubes never move, written once when loading.
+    Buffer *pObjectBuffer = nullptr;
+    DescriptorRange mUniformsDescriptors = {};
+
+    // Each frame's descriptors follow the resident texture.
+    StreamedTexture mCubeTexture = InvalidStreamedTexture;
+    Sampler *pCubeSampler = nullptr;
+    std::array<Texture *, ImageCount> pBoundCubeTextures = {nullptr};
+
+    ICameraController *pCameraController = nullptr;
+    mat4 mLastView = mat4::identity();
+    float3 mLightPos{2.0f, 3.0f, 4.0f};
+    float3 mLightColor{1.0f, 1.0f, 1.0f};
+
+    Buffer *pVerticesBuffer = nullptr;
+};
+}; // namespace Ch5Streaming
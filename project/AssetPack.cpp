@@ -0,0 +1,241 @@
+#include "AssetPack.h"
+
+#include "AssetPackFormat.h"
+#include "Lz4.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <Common_3/OS/Interfaces/IMemory.h>
+
+namespace {
+const uint8_t *pPackData = nullptr;
+uint64_t gPackSize = 0;
+#if defined(_WIN32)
+HANDLE gPackFile = INVALID_HANDLE_VALUE;
+HANDLE gPackMapping = nullptr;
+#endif
+
+const AssetPackEntry *pEntries = nullptr;
+uint32_t gEntryCount = 0;
+const char *pNames = nullptr;
+
+// Folder inside the pack of each resource directory served from it, empty for the others.
+std::string gPackedFolders[RD_COUNT];
+
+std::atomic<uint32_t> gPackedOpens{0};
+std::atomic<uint32_t> gDiskOpens{0};
+std::atomic<uint64_t> gDecompressedBytes{0};
+
+IFileSystem gPackFileIO = {};
+} // namespace
+
+static auto PackName(const std::string &folder, const char *pFileName) -> std::string {
+    std::string name = folder + "/" + pFileName;
+    for (char &c : name) {
+        c = c == '\\' ? '/' : (char)tolower((unsigned char)c);
+    }
+    return name;
+}
+
+// First entry whose name is not less than name.
+static auto LowerBound(const std::string &name) -> const AssetPackEntry * {
+    return std::lower_bound(pEntries, pEntries + gEntryCount, name, [](const AssetPackEntry &entry, const std::string &key) {
+        return strcmp(pNames + entry.mNameOffset, key.c_str()) < 0;
+    });
+}
+
+static auto FindEntry(ResourceDirectory resourceDir, const char *pFileName) -> const AssetPackEntry * {
+    if (gPackedFolders[resourceDir].empty()) {
+        return nullptr;
+    }
+    const std::string name = PackName(gPackedFolders[resourceDir], pFileName);
+    const AssetPackEntry *pEntry = LowerBound(name);
+    return pEntry != pEntries + gEntryCount && name == pNames + pEntry->mNameOffset ? pEntry : nullptr;
+}
+
+static auto PackOpen(IFileSystem *pIO, const ResourceDirectory resourceDir, const char *pFileName, FileMode mode,
+                     const char *pFilePassword, FileStream *pOut) -> bool {
+    const AssetPackEntry *pEntry = (mode & (FM_WRITE | FM_APPEND)) ? nullptr : FindEntry(resourceDir, pFileName);
+    if (pEntry == nullptr) {
+        gDiskOpens++;
+        return pSystemFileIO->Open(pSystemFileIO, resourceDir, pFileName, mode, pFilePassword, pOut);
+    }
+    gPackedOpens++;
+
+    const uint8_t *pStored = pPackData + pEntry->mOffset;
+    if (!(pEntry->mFlags & AssetPackLz4)) {
+        return fsOpenStreamFromMemory(pStored, pEntry->mSize, mode, false, pOut);
+    }
+
+    void *pBuffer = tf_malloc(std::max<uint64_t>(pEntry->mSize, 1));
+    if (!Lz4Decompress(pStored, pEntry->mStoredSize, (uint8_t *)pBuffer, pEntry->mSize)) {
+        LOGF(LogLevel::eERROR, "%s in the asset pack is corrupt", pNames + pEntry->mNameOffset);
+        tf_free(pBuffer);
+        return false;
+    }
+    gDecompressedBytes += pEntry->mSize;
+    return fsOpenStreamFromMemory(pBuffer, pEntry->mSize, mode, true, pOut);
+}
+
+// Same paths as the system file IO, so files missing from the pack are found where they used to be.
+static auto PackGetResourceMount(ResourceMount mount) -> const char * { return pSystemFileIO->GetResourceMount(mount); }
+
+static void UnmapPack() {
+#if defined(_WIN32)
+    if (pPackData != nullptr) {
+        UnmapViewOfFile(pPackData);
+    }
+    if (gPackMapping != nullptr) {
+        CloseHandle(gPackMapping);
+    }
+    if (gPackFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(gPackFile);
+    }
+    gPackMapping = nullptr;
+    gPackFile = INVALID_HANDLE_VALUE;
+#else
+    if (pPackData != nullptr) {
+        munmap((void *)pPackData, gPackSize);
+    }
+#endif
+    pPackData = nullptr;
+    gPackSize = 0;
+}
+
+static auto MapPack(const char *pPath) -> bool {
+#if defined(_WIN32)
+    gPackFile = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size = {};
+    if (gPackFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(gPackFile, &size) || size.QuadPart == 0) {
+        UnmapPack();
+        return false;
+    }
+    gPackMapping = CreateFileMappingA(gPackFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    pPackData = gPackMapping != nullptr ? (const uint8_t *)MapViewOfFile(gPackMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    gPackSize = (uint64_t)size.QuadPart;
+#else
+    const int file = open(pPath, O_RDONLY);
+    struct stat info = {};
+    if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0) {
+        if (file >= 0) {
+            close(file);
+        }
+        return false;
+    }
+    void *pMapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    pPackData = pMapped != MAP_FAILED ? (const uint8_t *)pMapped : nullptr;
+    gPackSize = (uint64_t)info.st_size;
+#endif
+    if (pPackData == nullptr) {
+        UnmapPack();
+        return false;
+    }
+    return true;
+}
+
+auto MountAssetPack(const char *pFileName) -> bool {
+    char path[FS_MAX_PATH] = {};
+    fsAppendPathComponent(pSystemFileIO->GetResourceMount(RM_CONTENT), pFileName, path);
+    if (!MapPack(path)) {
+        LOGF(LogLevel::eINFO, "No asset pack at %s, resources are read from their directories", path);
+        return false;
+    }
+
+    AssetPackHeader header = {};
+    if (gPackSize >= sizeof(header)) {
+        memcpy(&header, pPackData, sizeof(header));
+    }
+    const uint64_t indexBytes = (uint64_t)header.mEntryCount * sizeof(AssetPackEntry) + header.mNamesSize;
+    const bool valid = header.mMagic == AssetPackMagic && header.mVersion == AssetPackVersion &&
+                       header.mIndexOffset % alignof(AssetPackEntry) == 0 && header.mNamesSize > 0 &&
+                       header.mIndexOffset <= gPackSize && indexBytes <= gPackSize - header.mIndexOffset &&
+                       pPackData[gPackSize - 1] == 0;
+    if (!valid) {
+        LOGF(LogLevel::eWARNING, "%s is not an asset pack of version %u, it is ignored", path, AssetPackVersion);
+        UnmapPack();
+        return false;
+    }
+
+    pEntries = (const AssetPackEntry *)(pPackData + header.mIndexOffset);
+    gEntryCount = header.mEntryCount;
+    pNames = (const char *)(pEntries + gEntryCount);
+    for (uint32_t i = 0; i < gEntryCount; ++i) {
+        const AssetPackEntry &entry = pEntries[i];
+        // Uncompressed entries are handed out mSize bytes in place.
+        const bool stored = (entry.mFlags & AssetPackLz4) || entry.mStoredSize == entry.mSize;
+        if (entry.mOffset > header.mIndexOffset || entry.mStoredSize > header.mIndexOffset - entry.mOffset ||
+            entry.mNameOffset >= header.mNamesSize || !stored) {
+            LOGF(LogLevel::eWARNING, "%s has an entry out of bounds, it is ignored", path);
+            UnmountAssetPack();
+            return false;
+        }
+    }
+
+    gPackFileIO.Open = PackOpen;
+    gPackFileIO.GetResourceMount = PackGetResourceMount;
+
+    LOGF(LogLevel::eINFO, "Mounted %s, %u files in %.2f MB", path, gEntryCount, gPackSize / (1024.0f * 1024.0f));
+    return true;
+}
+
+void UnmountAssetPack() {
+    UnmapPack();
+    pEntries = nullptr;
+    gEntryCount = 0;
+    pNames = nullptr;
+    for (std::string &folder : gPackedFolders) {
+        folder.clear();
+    }
+}
+
+void SetPackedResourceDir(ResourceMount mount, ResourceDirectory resourceDir, const char *pFolder) {
+    const std::string prefix = PackName(pFolder, "");
+    const AssetPackEntry *pEntry = pEntries != nullptr ? LowerBound(prefix) : nullptr;
+    const bool packed = pEntry != nullptr && pEntry != pEntries + gEntryCount &&
+                        strncmp(pNames + pEntry->mNameOffset, prefix.c_str(), prefix.size()) == 0;
+
+    gPackedFolders[resourceDir] = packed ? prefix.substr(0, prefix.size() - 1) : std::string();
+    fsSetPathForResourceDir(packed ? &gPackFileIO : pSystemFileIO, mount, resourceDir, pFolder);
+}
+
+void PrefetchResourceFile(ResourceDirectory resourceDir, const char *pFileName) {
+    FileStream stream = {};
+    if (!fsOpenStreamFromPath(resourceDir, pFileName, FM_READ_BINARY, nullptr, &stream)) {
+        LOGF(LogLevel::eWARNING, "Could not prefetch %s", pFileName);
+        return;
+    }
+
+    // Packed files are a stream over the mapping, reading them is what faults their pages in.
+    uint8_t chunk[64 * 1024];
+    while (fsReadFromStream(&stream, chunk, sizeof(chunk)) == sizeof(chunk)) {
+    }
+    fsCloseStream(&stream);
+}
+
+auto GetAssetPackStats() -> AssetPackStats {
+    AssetPackStats stats = {};
+    stats.mEntryCount = gEntryCount;
+    stats.mMappedBytes = gPackSize;
+    stats.mPackedOpens = gPackedOpens;
+    stats.mDiskOpens = gDiskOpens;
+    stats.mDecompressedBytes = gDecompressedBytes;
+    return stats;
+}
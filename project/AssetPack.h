@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+
+#include <cstdint>
+
+// Read-only resource directories served from one memory mapped archive, owned by MainApp.
+//
+// The pack is built by asset-packer from the output directory, see AssetPackFormat.h. Resource
+// directories set through SetPackedResourceDir read files straight from the mapping: a file stored
+// as is becomes a memory stream over the mapped bytes, an LZ4 compressed one is decompressed into a
+// buffer owned by its stream. Writes, and files the pack does not have, go to the directory on
+// disk as they would without the pack, so a missing or stale pack only costs the small reads.
+
+// pFileName is relative to the content mount, usually the directory of the executable.
+auto MountAssetPack(const char *pFileName) -> bool;
+// Every stream opened from the pack must be closed.
+void UnmountAssetPack();
+
+// fsSetPathForResourceDir, through the pack when it holds files below pFolder.
+void SetPackedResourceDir(ResourceMount mount, ResourceDirectory resourceDir, const char *pFolder);
+
+// Reads a file through its resource directory and drops the bytes, so that they are already in
+// memory when the file is loaded for real. Meant for worker threads, see Scene::Prepare.
+void PrefetchResourceFile(ResourceDirectory resourceDir, const char *pFileName);
+
+struct AssetPackStats {
+    uint32_t mEntryCount;
+    uint64_t mMappedBytes;
+    // Opens served from the pack, and by the directory on disk.
+    uint32_t mPackedOpens;
+    uint32_t mDiskOpens;
+    uint64_t mDecompressedBytes;
+};
+
+auto GetAssetPackStats() -> AssetPackStats;
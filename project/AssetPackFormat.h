@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of the asset pack, written by asset-packer and read by AssetPack.
+//
+//   AssetPackHeader
+//   file data, every entry starting on an AssetPackAlignment boundary
+//   AssetPackEntry[mEntryCount], sorted by name
+//   names, zero terminated, mNamesSize bytes
+//
+// Names are the path below the packed root in lower case with forward slashes, e.g.
+// "textures/texture.dds", so a file is found with a binary search over the mapped index.
+
+constexpr uint32_t AssetPackMagic = 0x4b504641; // "AFPK"
+// Bump whenever the layout changes, older packs are then ignored.
+constexpr uint32_t AssetPackVersion = 1;
+// A cache line, and enough for any element type a file may be read as in place.
+constexpr uint64_t AssetPackAlignment = 64;
+
+enum AssetPackFlags : uint32_t {
+    // Stored as one LZ4 block, mStoredSize bytes that decompress to mSize.
+    AssetPackLz4 = 1 << 0,
+};
+
+struct AssetPackHeader {
+    uint32_t mMagic;
+    uint32_t mVersion;
+    uint32_t mEntryCount;
+    uint32_t mNamesSize;
+    uint64_t mIndexOffset;
+};
+
+struct AssetPackEntry {
+    uint64_t mOffset;
+    uint64_t mStoredSize;
+    uint64_t mSize;
+    // Into the names that follow the entries.
+    uint32_t mNameOffset;
+    uint32_t mFlags;
+};
+
+static_assert(sizeof(AssetPackHeader) == 24, "The header is read straight from the file");
+static_assert(sizeof(AssetPackEntry) == 32, "Entries are read straight from the file");
@@ -0,0 +1,454 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+namespace {
+constexpr uint32_t SahBins = 12;
+constexpr uint32_t MaxLeafObjects = 4;
+// Cost of visiting an inner node relative to testing one object.
+constexpr float TraversalCost = 1.0f;
+constexpr uint32_t NoParent = UINT32_MAX;
+// Deeper subtrees become leaves, which bounds the traversal stacks of the queries.
+constexpr uint32_t MaxDepth = 64;
+constexpr uint32_t StackSize = MaxDepth + 1;
+
+struct BuildState {
+    const BvhBounds *pBounds;
+    std::vector<float3> mCentroids;
+    Bvh *pBvh;
+};
+
+struct Bin {
+    BvhBounds mBounds;
+    uint32_t mCount;
+};
+} // namespace
+
+static auto EmptyBounds() -> BvhBounds { return {float3(FLT_MAX), float3(-FLT_MAX)}; }
+
+static void Grow(BvhBounds &bounds, const BvhBounds &other) {
+    bounds.mMin = min(bounds.mMin, other.mMin);
+    bounds.mMax = max(bounds.mMax, other.mMax);
+}
+
+static auto HalfArea(const BvhBounds &bounds) -> float {
+    const float3 extent = bounds.mMax - bounds.mMin;
+    if (extent.x < 0.0f) {
+        return 0.0f;
+    }
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+static auto NodeBounds(const BvhNode &node) -> BvhBounds { return {node.mMin, node.mMax}; }
+
+static void SetNodeBounds(BvhNode &node, const BvhBounds &bounds) {
+    node.mMin = bounds.mMin;
+    node.mMax = bounds.mMax;
+}
+
+static auto LeafBounds(const Bvh &bvh, const BvhNode &node) -> BvhBounds {
+    BvhBounds bounds = EmptyBounds();
+    for (uint32_t i = node.mIndex; i < node.mIndex + node.mCount; ++i) {
+        Grow(bounds, bvh.mBounds[bvh.mObjects[i]]);
+    }
+    return bounds;
+}
+
+static void MakeLeaf(BuildState &state, uint32_t nodeIndex, uint32_t first, uint32_t count) {
+    Bvh &bvh = *state.pBvh;
+    BvhNode &node = bvh.mNodes[nodeIndex];
+    node.mIndex = first;
+    node.mCount = count;
+    for (uint32_t i = first; i < first + count; ++i) {
+        bvh.mObjectLeaves[bvh.mObjects[i]] = nodeIndex;
+    }
+}
+
+// Builds the subtree of mObjects[first, first + count) into the node at nodeIndex, whose bounds are
+// already set. Children are appended depth first.
+static void BuildNode(BuildState &state, uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth) {
+    Bvh &bvh = *state.pBvh;
+    if (count <= MaxLeafObjects || depth == MaxDepth) {
+        MakeLeaf(state, nodeIndex, first, count);
+        return;
+    }
+
+    BvhBounds centroidBounds = EmptyBounds();
+    for (uint32_t i = first; i < first + count; ++i) {
+        const float3 &centroid = state.mCentroids[bvh.mObjects[i]];
+        Grow(centroidBounds, {centroid, centroid});
+    }
+
+    // Cheapest split over the bins of every axis.
+    float bestCost = (float)count;
+    int bestAxis = -1;
+    uint32_t bestSplit = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float axisMin = centroidBounds.mMin[axis];
+        const float axisExtent = centroidBounds.mMax[axis] - axisMin;
+        if (axisExtent <= 0.0f) {
+            continue;
+        }
+
+        Bin bins[SahBins];
+        for (Bin &bin : bins) {
+            bin = {EmptyBounds(), 0};
+        }
+        const float binScale = SahBins / axisExtent;
+        for (uint32_t i = first; i < first + count; ++i) {
+            const uint32_t object = bvh.mObjects[i];
+            const uint32_t bin =
+                std::min(SahBins - 1, (uint32_t)((state.mCentroids[object][axis] - axisMin) * binScale));
+            Grow(bins[bin].mBounds, state.pBounds[object]);
+            bins[bin].mCount++;
+        }
+
+        // Sweep from the right for the area and count right of every split, then from the left.
+        float rightAreas[SahBins - 1];
+        uint32_t rightCounts[SahBins - 1];
+        BvhBounds right = EmptyBounds();
+        uint32_t rightCount = 0;
+        for (uint32_t split = SahBins - 1; split > 0; --split) {
+            Grow(right, bins[split].mBounds);
+            rightCount += bins[split].mCount;
+            rightAreas[split - 1] = HalfArea(right);
+            rightCounts[split - 1] = rightCount;
+        }
+
+        BvhBounds left = EmptyBounds();
+        uint32_t leftCount = 0;
+        const float parentArea = HalfArea(NodeBounds(bvh.mNodes[nodeIndex]));
+        for (uint32_t split = 0; split < SahBins - 1; ++split) {
+            Grow(left, bins[split].mBounds);
+            leftCount += bins[split].mCount;
+            if (leftCount == 0 || rightCounts[split] == 0) {
+                continue;
+            }
+            const float cost =
+                TraversalCost + (HalfArea(left) * leftCount + rightAreas[split] * rightCounts[split]) / parentArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    // Coincident centroids, or no split pays for the extra node.
+    if (bestAxis < 0) {
+        MakeLeaf(state, nodeIndex, first, count);
+        return;
+    }
+
+    const float axisMin = centroidBounds.mMin[bestAxis];
+    const float binScale = SahBins / (centroidBounds.mMax[bestAxis] - axisMin);
+    uint32_t *pMiddle = std::partition(&bvh.mObjects[first], &bvh.mObjects[first] + count, [&](uint32_t object) {
+        const uint32_t bin = std::min(SahBins - 1, (uint32_t)((state.mCentroids[object][bestAxis] - axisMin) * binScale));
+        return bin <= bestSplit;
+    });
+    const uint32_t leftCount = (uint32_t)(pMiddle - &bvh.mObjects[first]);
+
+    BvhBounds leftBounds = EmptyBounds();
+    for (uint32_t i = first; i < first + leftCount; ++i) {
+        Grow(leftBounds, state.pBounds[bvh.mObjects[i]]);
+    }
+    BvhBounds rightBounds = EmptyBounds();
+    for (uint32_t i = first + leftCount; i < first + count; ++i) {
+        Grow(rightBounds, state.pBounds[bvh.mObjects[i]]);
+    }
+
+    const uint32_t leftIndex = (uint32_t)bvh.mNodes.size();
+    bvh.mNodes.push_back({});
+    bvh.mParents.push_back(nodeIndex);
+    SetNodeBounds(bvh.mNodes[leftIndex], leftBounds);
+    BuildNode(state, leftIndex, first, leftCount, depth + 1);
+
+    const uint32_t rightIndex = (uint32_t)bvh.mNodes.size();
+    bvh.mNodes.push_back({});
+    bvh.mParents.push_back(nodeIndex);
+    SetNodeBounds(bvh.mNodes[rightIndex], rightBounds);
+    BuildNode(state, rightIndex, first + leftCount, count - leftCount, depth + 1);
+
+    bvh.mNodes[nodeIndex].mIndex = rightIndex;
+    bvh.mNodes[nodeIndex].mCount = 0;
+}
+
+void BuildBvh(const BvhBounds *pBounds, uint32_t objectCount, Bvh *pOut) {
+    Bvh &bvh = *pOut;
+    bvh.mNodes.clear();
+    bvh.mParents.clear();
+    bvh.mBounds.assign(pBounds, pBounds + objectCount);
+    bvh.mObjects.resize(objectCount);
+    bvh.mObjectLeaves.assign(objectCount, 0);
+    bvh.bDirty = false;
+
+    if (objectCount == 0) {
+        bvh.mDirty.clear();
+        return;
+    }
+
+    BuildState state = {pBounds, std::vector<float3>(objectCount), pOut};
+    BvhBounds rootBounds = EmptyBounds();
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        bvh.mObjects[i] = i;
+        state.mCentroids[i] = (pBounds[i].mMin + pBounds[i].mMax) * 0.5f;
+        Grow(rootBounds, pBounds[i]);
+    }
+
+    // A binary tree with leaves of at least one object has fewer than twice as many nodes.
+    bvh.mNodes.reserve(2 * objectCount);
+    bvh.mParents.reserve(2 * objectCount);
+    bvh.mNodes.push_back({});
+    bvh.mParents.push_back(NoParent);
+    SetNodeBounds(bvh.mNodes[0], rootBounds);
+    BuildNode(state, 0, 0, objectCount, 0);
+
+    bvh.mNodes.shrink_to_fit();
+    bvh.mParents.shrink_to_fit();
+    bvh.mDirty.assign(bvh.mNodes.size(), 0);
+}
+
+void MoveBvhObject(Bvh &bvh, uint32_t object, const BvhBounds &bounds) {
+    bvh.mBounds[object] = bounds;
+    bvh.bDirty = true;
+
+    // Stops at the first node already marked, its ancestors are marked too.
+    for (uint32_t node = bvh.mObjectLeaves[object]; node != NoParent && !bvh.mDirty[node];
+         node = bvh.mParents[node]) {
+        bvh.mDirty[node] = 1;
+    }
+}
+
+void RefitBvh(Bvh &bvh) {
+    if (!bvh.bDirty) {
+        return;
+    }
+
+    // Children come after their parent, walking backwards refits them first.
+    for (uint32_t i = (uint32_t)bvh.mNodes.size(); i-- > 0;) {
+        if (!bvh.mDirty[i]) {
+            continue;
+        }
+        bvh.mDirty[i] = 0;
+
+        BvhNode &node = bvh.mNodes[i];
+        if (node.mCount > 0) {
+            SetNodeBounds(node, LeafBounds(bvh, node));
+        } else {
+            BvhBounds bounds = NodeBounds(bvh.mNodes[i + 1]);
+            Grow(bounds, NodeBounds(bvh.mNodes[node.mIndex]));
+            SetNodeBounds(node, bounds);
+        }
+    }
+    bvh.bDirty = false;
+}
+
+void FrustumPlanes(const mat4 &viewProjection, vec4 planes[6]) {
+    const vec4 row0 = viewProjection.getRow(0);
+    const vec4 row1 = viewProjection.getRow(1);
+    const vec4 row2 = viewProjection.getRow(2);
+    const vec4 row3 = viewProjection.getRow(3);
+
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row2;
+    planes[5] = row3 - row2;
+}
+
+// The box corner furthest along each plane normal decides whether the box is fully outside.
+static auto OutsidePlanes(const BvhNode &node, const float4 *pPlanes) -> bool {
+    for (int i = 0; i < 6; ++i) {
+        const float4 &plane = pPlanes[i];
+        const float x = plane.x >= 0.0f ? node.mMax.x : node.mMin.x;
+        const float y = plane.y >= 0.0f ? node.mMax.y : node.mMin.y;
+        const float z = plane.z >= 0.0f ? node.mMax.z : node.mMin.z;
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void QueryBvhFrustum(const Bvh &bvh, const vec4 planes[6], std::vector<uint32_t> &out) {
+    if (bvh.mNodes.empty()) {
+        return;
+    }
+
+    float4 pPlanes[6];
+    for (int i = 0; i < 6; ++i) {
+        pPlanes[i] = v4ToF4(planes[i]);
+    }
+
+    uint32_t stack[StackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const uint32_t index = stack[--stackSize];
+        const BvhNode &node = bvh.mNodes[index];
+        if (OutsidePlanes(node, pPlanes)) {
+            continue;
+        }
+
+        if (node.mCount > 0) {
+            for (uint32_t i = node.mIndex; i < node.mIndex + node.mCount; ++i) {
+                // Leaf bounds are loose, the objects are tested on their own.
+                const BvhBounds &bounds = bvh.mBounds[bvh.mObjects[i]];
+                const BvhNode objectNode = {bounds.mMin, 0, bounds.mMax, 0};
+                if (!OutsidePlanes(objectNode, pPlanes)) {
+                    out.push_back(bvh.mObjects[i]);
+                }
+            }
+        } else {
+            stack[stackSize++] = node.mIndex;
+            stack[stackSize++] = index + 1;
+        }
+    }
+}
+
+// Distance along the ray to where it enters the box, FLT_MAX when it misses or enters past maxDistance.
+static auto RayBoxDistance(const float3 &min, const float3 &max, const float3 &origin, const float3 &inverseDirection,
+                           float maxDistance) -> float {
+    const float tx0 = (min.x - origin.x) * inverseDirection.x;
+    const float tx1 = (max.x - origin.x) * inverseDirection.x;
+    const float ty0 = (min.y - origin.y) * inverseDirection.y;
+    const float ty1 = (max.y - origin.y) * inverseDirection.y;
+    const float tz0 = (min.z - origin.z) * inverseDirection.z;
+    const float tz1 = (max.z - origin.z) * inverseDirection.z;
+
+    const float enter = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+    const float exit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::max(tz0, tz1));
+    return enter <= exit && enter < maxDistance ? enter : FLT_MAX;
+}
+
+auto QueryBvhRay(const Bvh &bvh, const vec3 &origin, const vec3 &direction, float *pDistance) -> uint32_t {
+    uint32_t hit = BvhNoHit;
+    float hitDistance = FLT_MAX;
+    if (bvh.mNodes.empty()) {
+        return hit;
+    }
+
+    const float3 rayOrigin = v3ToF3(origin);
+    // Division by zero gives infinities, which the slab test handles.
+    const float3 inverseDirection{1.0f / direction.getX(), 1.0f / direction.getY(), 1.0f / direction.getZ()};
+
+    uint32_t stack[StackSize];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const uint32_t index = stack[--stackSize];
+        const BvhNode &node = bvh.mNodes[index];
+
+        if (node.mCount > 0) {
+            for (uint32_t i = node.mIndex; i < node.mIndex + node.mCount; ++i) {
+                const BvhBounds &bounds = bvh.mBounds[bvh.mObjects[i]];
+                const float distance = RayBoxDistance(bounds.mMin, bounds.mMax, rayOrigin, inverseDirection, hitDistance);
+                if (distance < hitDistance) {
+                    hitDistance = distance;
+                    hit = bvh.mObjects[i];
+                }
+            }
+            continue;
+        }
+
+        // Nearer child on top of the stack, the further one is often skipped once a hit is found.
+        const BvhNode &left = bvh.mNodes[index + 1];
+        const BvhNode &right = bvh.mNodes[node.mIndex];
+        const float leftDistance = RayBoxDistance(left.mMin, left.mMax, rayOrigin, inverseDirection, hitDistance);
+        const float rightDistance = RayBoxDistance(right.mMin, right.mMax, rayOrigin, inverseDirection, hitDistance);
+        const bool leftFirst = leftDistance <= rightDistance;
+        const uint32_t nearIndex = leftFirst ? index + 1 : node.mIndex;
+        const uint32_t farIndex = leftFirst ? node.mIndex : index + 1;
+        const float farDistance = leftFirst ? rightDistance : leftDistance;
+        const float nearDistance = leftFirst ? leftDistance : rightDistance;
+
+        if (farDistance < FLT_MAX) {
+            stack[stackSize++] = farIndex;
+        }
+        if (nearDistance < FLT_MAX) {
+            stack[stackSize++] = nearIndex;
+        }
+    }
+
+    if (pDistance != nullptr) {
+        *pDistance = hitDistance;
+    }
+    return hit;
+}
+
+void RunBvhBenchmarks() {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    };
+
+    constexpr uint32_t QueryCount = 100;
+    const uint32_t objectCounts[] = {10000, 100000, 1000000};
+    for (uint32_t objectCount : objectCounts) {
+        // Unit sized boxes scattered through a volume that keeps the density constant.
+        std::mt19937 random(objectCount);
+        const float extent = std::cbrt((float)objectCount) * 4.0f;
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_real_distribution<float> size(0.25f, 1.0f);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        std::vector<BvhBounds> bounds(objectCount);
+        for (BvhBounds &box : bounds) {
+            const float3 center{position(random), position(random), position(random)};
+            const float3 halfSize{size(random), size(random), size(random)};
+            box = {center - halfSize, center + halfSize};
+        }
+
+        Bvh bvh;
+        Clock::time_point start = Clock::now();
+        BuildBvh(bounds.data(), objectCount, &bvh);
+        const float buildMs = elapsedMs(start);
+
+        // One object in ten nudged, like a frame of a scene with some moving objects.
+        start = Clock::now();
+        for (uint32_t i = 0; i < objectCount; i += 10) {
+            const float3 offset{unit(random), unit(random), unit(random)};
+            MoveBvhObject(bvh, i, {bounds[i].mMin + offset, bounds[i].mMax + offset});
+        }
+        RefitBvh(bvh);
+        const float refitMs = elapsedMs(start);
+
+        std::vector<uint32_t> visible;
+        uint64_t visibleCount = 0;
+        start = Clock::now();
+        for (uint32_t i = 0; i < QueryCount; ++i) {
+            const vec3 eye{position(random), position(random), position(random)};
+            const mat4 view = mat4::lookAt(eye, vec3(0.0f), vec3{0.0f, 1.0f, 0.0f});
+            const mat4 projection = mat4::perspective(PI / 2.0f, 9.0f / 16.0f, extent * 0.25f, 0.1f);
+            vec4 planes[6];
+            FrustumPlanes(projection * view, planes);
+
+            visible.clear();
+            QueryBvhFrustum(bvh, planes, visible);
+            visibleCount += visible.size();
+        }
+        const float frustumUs = elapsedMs(start) * 1000.0f / QueryCount;
+
+        uint32_t hits = 0;
+        start = Clock::now();
+        for (uint32_t i = 0; i < QueryCount; ++i) {
+            const vec3 origin{position(random), position(random), position(random)};
+            const vec3 direction{unit(random), unit(random), unit(random)};
+            hits += QueryBvhRay(bvh, origin, direction, nullptr) != BvhNoHit ? 1 : 0;
+        }
+        const float rayUs = elapsedMs(start) * 1000.0f / QueryCount;
+
+        LOGF(LogLevel::eINFO,
+             "BVH %u objects, %u nodes: build %.1f ms, refit of %u moved %.2f ms, frustum %.1f us (%llu visible "
+             "on average), ray %.2f us (%u of %u hit)",
+             objectCount, (uint32_t)bvh.mNodes.size(), buildMs, (objectCount + 9) / 10, refitMs, frustumUs,
+             (unsigned long long)(visibleCount / QueryCount), rayUs, hits, QueryCount);
+    }
+}
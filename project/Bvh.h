@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Common_3/OS/Math/MathTypes.h>
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over object bounds, for culling, picking and light assignment.
+//
+// Nodes are stored depth first in one array: the left child of an inner node is the node right
+// after it, only the right child is stored. The build splits along the surface area heuristic,
+// evaluated over a fixed number of bins per axis. Objects that move are refit rather than rebuilt:
+// their leaves and the ancestors of those are grown or shrunk to the new bounds, the tree
+// topology stays. Refitting degrades the tree as objects drift far from where they were built,
+// rebuild when queries slow down.
+
+struct BvhBounds {
+    float3 mMin;
+    float3 mMax;
+};
+
+struct BvhNode {
+    float3 mMin;
+    // First object of a leaf, right child of an inner node.
+    uint32_t mIndex;
+    float3 mMax;
+    // Objects in a leaf, zero for an inner node.
+    uint32_t mCount;
+};
+
+struct Bvh {
+    std::vector<BvhNode> mNodes;
+    // Objects in leaf order, a leaf covers mObjects[mIndex, mIndex + mCount).
+    std::vector<uint32_t> mObjects;
+    std::vector<BvhBounds> mBounds;
+
+    std::vector<uint32_t> mParents;
+    std::vector<uint32_t> mObjectLeaves;
+    std::vector<uint8_t> mDirty;
+    bool bDirty = false;
+};
+
+constexpr uint32_t BvhNoHit = UINT32_MAX;
+
+void BuildBvh(const BvhBounds *pBounds, uint32_t objectCount, Bvh *pOut);
+
+// Takes effect with the next RefitBvh.
+void MoveBvhObject(Bvh &bvh, uint32_t object, const BvhBounds &bounds);
+// Refits every node above a moved object, and only those.
+void RefitBvh(Bvh &bvh);
+
+// Planes of a view projection matrix with a [0, 1] depth range, normals pointing inwards.
+void FrustumPlanes(const mat4 &viewProjection, vec4 planes[6]);
+
+// Appends every object whose bounds are at least partly inside the planes.
+void QueryBvhFrustum(const Bvh &bvh, const vec4 planes[6], std::vector<uint32_t> &out);
+
+// The object whose bounds the ray enters first, BvhNoHit when there is none. direction does not
+// need to be normalised, pDistance is in multiples of it.
+auto QueryBvhRay(const Bvh &bvh, const vec3 &origin, const vec3 &direction, float *pDistance) -> uint32_t;
+
+// Builds, refits and queries random scenes of 10k to 1M objects and logs the timings.
+void RunBvhBenchmarks();
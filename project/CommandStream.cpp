@@ -0,0 +1,154 @@
+#include "CommandStream.h"
+
+#include <cstring>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+static auto LastOf(const CommandStream &stream, StreamOp op) -> const StreamCommand * {
+    const size_t last = stream.mLastBind[(size_t)op];
+    return last != CommandStream::NoCommand ? &stream.mCommands[last] : nullptr;
+}
+
+static auto Push(CommandStream &stream, StreamOp op) -> StreamCommand & {
+    if ((size_t)op <= (size_t)StreamOp::BindIndexBuffer) {
+        stream.mLastBind[(size_t)op] = stream.mCommands.size();
+    }
+
+    StreamCommand command = {};
+    command.mOp = op;
+    stream.mCommands.push_back(command);
+    return stream.mCommands.back();
+}
+
+void ResetCommandStream(CommandStream &stream) {
+    stream.mCommands.clear();
+    stream.mDrawCount = 0;
+    stream.bRecorded = false;
+    for (auto &last : stream.mLastBind) {
+        last = CommandStream::NoCommand;
+    }
+}
+
+void StreamBindPipeline(CommandStream &stream, Pipeline *pPipeline) {
+    const StreamCommand *pLast = LastOf(stream, StreamOp::BindPipeline);
+    if (pLast != nullptr && pLast->pPipeline == pPipeline) {
+        return;
+    }
+    Push(stream, StreamOp::BindPipeline).pPipeline = pPipeline;
+    // The pipeline may come with another root signature, which drops the bound sets.
+    stream.mLastBind[(size_t)StreamOp::BindDescriptors] = CommandStream::NoCommand;
+}
+
+void StreamBindDescriptors(CommandStream &stream, const DescriptorRange &range, uint32_t index) {
+    const StreamCommand *pLast = LastOf(stream, StreamOp::BindDescriptors);
+    if (pLast != nullptr && pLast->pSet == range.pSet && pLast->mArgs[0] == range.mFirst && pLast->mArgs[1] == index) {
+        return;
+    }
+
+    StreamCommand &command = Push(stream, StreamOp::BindDescriptors);
+    command.pSet = range.pSet;
+    command.mArgs[0] = range.mFirst;
+    command.mArgs[1] = index;
+}
+
+void StreamBindVertexBuffer(CommandStream &stream, Buffer *pBuffer, uint32_t stride) {
+    const StreamCommand *pLast = LastOf(stream, StreamOp::BindVertexBuffer);
+    if (pLast != nullptr && pLast->pBuffer == pBuffer && pLast->mArgs[0] == stride) {
+        return;
+    }
+
+    StreamCommand &command = Push(stream, StreamOp::BindVertexBuffer);
+    command.pBuffer = pBuffer;
+    command.mArgs[0] = stride;
+}
+
+void StreamBindIndexBuffer(CommandStream &stream, Buffer *pBuffer, uint32_t indexType) {
+    const StreamCommand *pLast = LastOf(stream, StreamOp::BindIndexBuffer);
+    if (pLast != nullptr && pLast->pBuffer == pBuffer && pLast->mArgs[0] == indexType) {
+        return;
+    }
+
+    StreamCommand &command = Push(stream, StreamOp::BindIndexBuffer);
+    command.pBuffer = pBuffer;
+    command.mArgs[0] = indexType;
+}
+
+void StreamPushConstants(CommandStream &stream, RootSignature *pRootSignature, uint32_t paramIndex,
+                         const void *pConstants, uint32_t size) {
+    if (size > StreamMaxPushConstantWords * sizeof(uint32_t)) {
+        LOGF(LogLevel::eERROR, "%u bytes of push constants do not fit in a command stream", size);
+        return;
+    }
+
+    StreamCommand &command = Push(stream, StreamOp::PushConstants);
+    command.pRootSignature = pRootSignature;
+    command.mArgs[0] = paramIndex;
+    memcpy(&command.mArgs[1], pConstants, size);
+}
+
+void StreamDraw(CommandStream &stream, uint32_t vertexCount, uint32_t firstVertex) {
+    StreamCommand &command = Push(stream, StreamOp::Draw);
+    command.mArgs[0] = vertexCount;
+    command.mArgs[1] = firstVertex;
+    stream.mDrawCount++;
+}
+
+void StreamDrawIndexed(CommandStream &stream, uint32_t indexCount, uint32_t firstIndex, uint32_t firstVertex) {
+    StreamCommand &command = Push(stream, StreamOp::DrawIndexed);
+    command.mArgs[0] = indexCount;
+    command.mArgs[1] = firstIndex;
+    command.mArgs[2] = firstVertex;
+    stream.mDrawCount++;
+}
+
+void StreamDrawIndexedInstanced(CommandStream &stream, uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount,
+                                uint32_t firstInstance, uint32_t firstVertex) {
+    StreamCommand &command = Push(stream, StreamOp::DrawIndexedInstanced);
+    command.mArgs[0] = indexCount;
+    command.mArgs[1] = firstIndex;
+    command.mArgs[2] = instanceCount;
+    command.mArgs[3] = firstInstance;
+    command.mArgs[4] = firstVertex;
+    stream.mDrawCount++;
+}
+
+void EndCommandStream(CommandStream &stream) {
+    stream.mCommands.shrink_to_fit();
+    stream.bRecorded = true;
+}
+
+void CmdReplayCommandStream(Cmd *cmd, const CommandStream &stream, uint32_t frameIndex) {
+    for (const StreamCommand &command : stream.mCommands) {
+        switch (command.mOp) {
+        case StreamOp::BindPipeline:
+            cmdBindPipeline(cmd, command.pPipeline);
+            break;
+        case StreamOp::BindDescriptors: {
+            const uint32_t index = command.mArgs[1] == StreamFrameDescriptor ? frameIndex : command.mArgs[1];
+            cmdBindDescriptorSet(cmd, command.mArgs[0] + index, command.pSet);
+            break;
+        }
+        case StreamOp::BindVertexBuffer: {
+            Buffer *pBuffer = command.pBuffer;
+            cmdBindVertexBuffer(cmd, 1, &pBuffer, &command.mArgs[0], NULL);
+            break;
+        }
+        case StreamOp::BindIndexBuffer:
+            cmdBindIndexBuffer(cmd, command.pBuffer, command.mArgs[0], 0);
+            break;
+        case StreamOp::PushConstants:
+            cmdBindPushConstants(cmd, command.pRootSignature, command.mArgs[0], &command.mArgs[1]);
+            break;
+        case StreamOp::Draw:
+            cmdDraw(cmd, command.mArgs[0], command.mArgs[1]);
+            break;
+        case StreamOp::DrawIndexed:
+            cmdDrawIndexed(cmd, command.mArgs[0], command.mArgs[1], command.mArgs[2]);
+            break;
+        case StreamOp::DrawIndexedInstanced:
+            cmdDrawIndexedInstanced(cmd, command.mArgs[0], command.mArgs[1], command.mArgs[2], command.mArgs[3],
+                                    command.mArgs[4]);
+            break;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "DescriptorCache.h"
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+#include <vector>
+
+// A draw stream recorded once and replayed into a command buffer every frame.
+//
+// Forge has no secondary command buffers on every backend, so the stream is a compact list of
+// the bind and draw calls instead. Binds that do not change any state are dropped while
+// recording. Replaying only walks the list, whatever the scene did to build it, culling, sorting
+// and working out push constants, is skipped. A stream holds raw pipeline and buffer pointers and
+// has to be recorded again whenever they, or the set of objects drawn, change.
+
+enum class StreamOp : uint8_t {
+    BindPipeline,
+    BindDescriptors,
+    BindVertexBuffer,
+    BindIndexBuffer,
+    PushConstants,
+    Draw,
+    DrawIndexed,
+    DrawIndexedInstanced,
+};
+
+// Indexes descriptors with the frame index at replay instead of a fixed index.
+constexpr uint32_t StreamFrameDescriptor = UINT32_MAX;
+constexpr uint32_t StreamMaxPushConstantWords = 4;
+
+struct StreamCommand {
+    StreamOp mOp;
+    union {
+        Pipeline *pPipeline;
+        RootSignature *pRootSignature;
+        Buffer *pBuffer;
+        DescriptorSet *pSet;
+    };
+    uint32_t mArgs[StreamMaxPushConstantWords + 1];
+};
+
+struct CommandStream {
+    std::vector<StreamCommand> mCommands;
+    uint32_t mDrawCount = 0;
+    bool bRecorded = false;
+
+    // Position of the latest command of each bind op while recording, to drop repeated binds.
+    static constexpr size_t NoCommand = SIZE_MAX;
+    size_t mLastBind[(size_t)StreamOp::BindIndexBuffer + 1] = {NoCommand, NoCommand, NoCommand, NoCommand};
+};
+
+void ResetCommandStream(CommandStream &stream);
+
+void StreamBindPipeline(CommandStream &stream, Pipeline *pPipeline);
+// index is a slot of range, or StreamFrameDescriptor to use the frame index passed to the replay.
+void StreamBindDescriptors(CommandStream &stream, const DescriptorRange &range, uint32_t index);
+void StreamBindVertexBuffer(CommandStream &stream, Buffer *pBuffer, uint32_t stride);
+void StreamBindIndexBuffer(CommandStream &stream, Buffer *pBuffer, uint32_t indexType);
+// At most StreamMaxPushConstantWords words, copied into the stream.
+void StreamPushConstants(CommandStream &stream, RootSignature *pRootSignature, uint32_t paramIndex,
+                         const void *pConstants, uint32_t size);
+void StreamDraw(CommandStream &stream, uint32_t vertexCount, uint32_t firstVertex);
+void StreamDrawIndexed(CommandStream &stream, uint32_t indexCount, uint32_t firstIndex, uint32_t firstVertex);
+void StreamDrawIndexedInstanced(CommandStream &stream, uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount,
+                                uint32_t firstInstance, uint32_t firstVertex);
+void EndCommandStream(CommandStream &stream);
+
+void CmdReplayCommandStream(Cmd *cmd, const CommandStream &stream, uint32_t frameIndex);
@@ -0,0 +1,165 @@
+#include "DebugOverlay.h"
+
+#include "DescriptorCache.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "ResourceCache.h"
+
+#include <Common_3/OS/Interfaces/IUI.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+// Same layout as upscaleConstants, the overlay reuses the upscale shader.
+struct CompositeConstants {
+    float uvScale[2];
+    float uvMax[2];
+};
+
+Shader *pCompositeShader = nullptr;
+RootSignature *pRootSignature = nullptr;
+uint32_t gCompositeConstantsIndex = 0;
+Sampler *pPointSampler = nullptr;
+Pipeline *pCompositePipeline = nullptr;
+
+RenderTarget *pOverlay = nullptr;
+DescriptorRange gCompositeDescriptors = {};
+
+bool bInvalidated = true;
+float gSinceRedraw = 0.0f;
+} // namespace
+
+void InitDebugOverlay(Renderer *pRenderer) {
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"upscale.vert", nullptr, 0};
+        desc.mStages[1] = {"upscale.frag", nullptr, 0};
+        pCompositeShader = AcquireShader(desc);
+    }
+
+    pRootSignature = AcquireRootSignature(&pCompositeShader, 1);
+    gCompositeConstantsIndex = getDescriptorIndexFromName(pRootSignature, "upscaleConstants");
+
+    // Overlay texels map one to one onto the back buffer.
+    SamplerDesc samplerDesc = {FILTER_NEAREST,
+                               FILTER_NEAREST,
+                               MIPMAP_MODE_NEAREST,
+                               ADDRESS_MODE_CLAMP_TO_EDGE,
+                               ADDRESS_MODE_CLAMP_TO_EDGE,
+                               ADDRESS_MODE_CLAMP_TO_EDGE};
+    addSampler(pRenderer, &samplerDesc, &pPointSampler);
+}
+
+void ExitDebugOverlay(Renderer *pRenderer) {
+    removeSampler(pRenderer, pPointSampler);
+    ReleaseRootSignature(pRootSignature);
+    ReleaseShader(pCompositeShader);
+}
+
+auto LoadDebugOverlay(Renderer *pRenderer, SwapChain *pSwapChain) -> bool {
+    RenderTarget *pSwapChainTarget = pSwapChain->ppRenderTargets[0];
+
+    {
+        // Same format as the swap chain. The font and UI pipelines are created for this target alone,
+        // the overlay pass has no depth. The zero clear value is transparent black.
+        RenderTargetDesc desc = {};
+        desc.mArraySize = 1;
+        desc.mDepth = 1;
+        desc.mFormat = pSwapChainTarget->mFormat;
+        desc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mWidth = pSwapChainTarget->mWidth;
+        desc.mHeight = pSwapChainTarget->mHeight;
+        desc.mSampleCount = SAMPLE_COUNT_1;
+        desc.mSampleQuality = 0;
+        desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+        desc.pName = "Debug Overlay";
+        AddTrackedRenderTarget(pRenderer, &desc, &pOverlay);
+    }
+
+    if (pOverlay == nullptr) {
+        return false;
+    }
+
+    {
+        gCompositeDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1);
+
+        DescriptorData params[2] = {};
+        params[0].pName = "sceneColor";
+        params[0].ppTextures = &pOverlay->pTexture;
+        params[1].pName = "linearSampler";
+        params[1].ppSamplers = &pPointSampler;
+        UpdateDescriptors(gCompositeDescriptors, 0, 2, params);
+    }
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = false;
+        depthStateDesc.mDepthWrite = false;
+
+        // The font and UI pipelines blend straight alpha into the overlay, it is blended the same way.
+        BlendStateDesc blendStateDesc = {};
+        blendStateDesc.mSrcFactors[0] = BC_SRC_ALPHA;
+        blendStateDesc.mDstFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+        blendStateDesc.mBlendModes[0] = BM_ADD;
+        blendStateDesc.mSrcAlphaFactors[0] = BC_ONE;
+        blendStateDesc.mDstAlphaFactors[0] = BC_ONE_MINUS_SRC_ALPHA;
+        blendStateDesc.mBlendAlphaModes[0] = BM_ADD;
+        blendStateDesc.mMasks[0] = ALL;
+        blendStateDesc.mRenderTargetMask = BLEND_STATE_TARGET_0;
+        blendStateDesc.mIndependentBlend = false;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 1;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.pBlendState = &blendStateDesc;
+        pipelineSettings.pColorFormats = &pSwapChainTarget->mFormat;
+        pipelineSettings.mSampleCount = pSwapChainTarget->mSampleCount;
+        pipelineSettings.mSampleQuality = pSwapChainTarget->mSampleQuality;
+        pipelineSettings.pRootSignature = pRootSignature;
+        pipelineSettings.pVertexLayout = NULL;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = pCompositeShader;
+        pCompositePipeline = AcquirePipeline(desc);
+    }
+
+    // The new target holds nothing yet.
+    bInvalidated = true;
+    return true;
+}
+
+void UnloadDebugOverlay(Renderer *pRenderer) {
+    ReleasePipeline(pCompositePipeline);
+    FreeDescriptors(gCompositeDescriptors);
+    RemoveTrackedRenderTarget(pRenderer, pOverlay);
+    pOverlay = nullptr;
+}
+
+void InvalidateDebugOverlay() { bInvalidated = true; }
+
+auto UpdateDebugOverlay(float deltaTime, float refreshHz) -> bool {
+    gSinceRedraw += deltaTime;
+    if (!bInvalidated && !uiIsFocused() && gSinceRedraw < 1.0f / refreshHz) {
+        return false;
+    }
+
+    bInvalidated = false;
+    gSinceRedraw = 0.0f;
+    return true;
+}
+
+auto DebugOverlayTarget() -> RenderTarget * { return pOverlay; }
+
+void CmdCompositeDebugOverlay(Cmd *cmd) {
+    const CompositeConstants constants = {{1.0f, 1.0f}, {1.0f, 1.0f}};
+
+    cmdBindPipeline(cmd, pCompositePipeline);
+    CmdBindDescriptors(cmd, gCompositeDescriptors, 0);
+    cmdBindPushConstants(cmd, pRootSignature, gCompositeConstantsIndex, &constants);
+    cmdDraw(cmd, 3, 0);
+}
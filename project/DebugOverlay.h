@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+// The profiler text and the UI, drawn into a swap chain sized target only when they change.
+//
+// On all other frames the cached target is composited over the back buffer with one full screen
+// draw, so no glyphs or UI geometry are generated. The overlay is redrawn when its refresh
+// interval has passed, when something invalidated it and, so that hovering and dragging stay
+// responsive, every frame while the UI has focus.
+
+void InitDebugOverlay(Renderer *pRenderer);
+void ExitDebugOverlay(Renderer *pRenderer);
+
+auto LoadDebugOverlay(Renderer *pRenderer, SwapChain *pSwapChain) -> bool;
+void UnloadDebugOverlay(Renderer *pRenderer);
+
+// The overlay is redrawn on the next frame, e.g. after input reached the UI.
+void InvalidateDebugOverlay();
+
+// Call once per frame. True when the overlay is redrawn this frame, the text it shows only needs
+// updating then.
+auto UpdateDebugOverlay(float deltaTime, float refreshHz) -> bool;
+
+// Kept in RESOURCE_STATE_SHADER_RESOURCE between frames.
+auto DebugOverlayTarget() -> RenderTarget *;
+
+// Blends the overlay over the bound target, which must be the size of the swap chain.
+void CmdCompositeDebugOverlay(Cmd *cmd);
@@ -0,0 +1,249 @@
+#include "DescriptorCache.h"
+
+#include "MemoryBudget.h"
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+namespace {
+// Slots per pooled descriptor set, larger requests get a set of their own.
+constexpr uint32_t DescriptorChunkSize = 64;
+
+struct FreeSlots {
+    uint32_t mFirst;
+    uint32_t mCount;
+};
+
+struct DescriptorChunk {
+    DescriptorSet *pSet;
+    uint32_t mCapacity;
+    std::vector<FreeSlots> mFreeSlots;
+};
+
+struct RootSignatureEntry {
+    RootSignature *pRootSignature;
+    uint32_t mRefCount;
+    std::array<std::vector<DescriptorChunk>, DESCRIPTOR_UPDATE_FREQ_COUNT> mChunks;
+    std::vector<std::string> mShaderSources;
+};
+
+Renderer *pCacheRenderer = nullptr;
+
+// Scenes load on the main thread, see Scene::Prepare, the lock keeps lookups from other threads safe.
+std::mutex gCacheMutex;
+
+std::unordered_map<std::string, RootSignatureEntry> gRootSignatures;
+std::unordered_map<RootSignature *, std::string> gRootSignatureKeys;
+} // namespace
+
+static void AppendBytes(std::string &out, const void *pData, size_t size) { out.append((const char *)pData, size); }
+
+// Every resource the shaders declare, in order. Shaders with the same layout share a root signature,
+// the whole list is compared so that no two layouts can be taken for one another.
+static auto ReflectionKey(Shader **ppShaders, uint32_t shaderCount) -> std::string {
+    std::string key;
+    for (uint32_t s = 0; s < shaderCount; ++s) {
+        const PipelineReflection *pReflection = ppShaders[s]->pReflection;
+        AppendBytes(key, &pReflection->mShaderResourceCount, sizeof(uint32_t));
+
+        for (uint32_t r = 0; r < pReflection->mShaderResourceCount; ++r) {
+            const ShaderResource &resource = pReflection->pShaderResources[r];
+            AppendBytes(key, &resource.name_size, sizeof(resource.name_size));
+            AppendBytes(key, resource.name, resource.name_size);
+            AppendBytes(key, &resource.type, sizeof(resource.type));
+            AppendBytes(key, &resource.set, sizeof(resource.set));
+            AppendBytes(key, &resource.reg, sizeof(resource.reg));
+            AppendBytes(key, &resource.size, sizeof(resource.size));
+            AppendBytes(key, &resource.used_stages, sizeof(resource.used_stages));
+        }
+    }
+    return key;
+}
+
+static auto FindChunk(RootSignatureEntry &entry, DescriptorSet *pSet) -> DescriptorChunk * {
+    for (auto &chunks : entry.mChunks) {
+        for (auto &chunk : chunks) {
+            if (chunk.pSet == pSet) {
+                return &chunk;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void InitDescriptorCache(Renderer *pRenderer) {
+    pCacheRenderer = pRenderer;
+}
+
+void ExitDescriptorCache() {
+    for (auto &[key, entry] : gRootSignatures) {
+        LOGF(LogLevel::eWARNING, "Root signature %p still referenced %u times on exit", entry.pRootSignature,
+             entry.mRefCount);
+
+        for (auto &chunks : entry.mChunks) {
+            for (auto &chunk : chunks) {
+                UntrackAllocation(chunk.pSet);
+                removeDescriptorSet(pCacheRenderer, chunk.pSet);
+            }
+        }
+        removeRootSignature(pCacheRenderer, entry.pRootSignature);
+    }
+    gRootSignatures.clear();
+    gRootSignatureKeys.clear();
+
+    pCacheRenderer = nullptr;
+}
+
+auto AcquireRootSignature(Shader **ppShaders, uint32_t shaderCount) -> RootSignature * {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    const std::string key = ReflectionKey(ppShaders, shaderCount);
+
+    auto found = gRootSignatures.find(key);
+    if (found != gRootSignatures.end()) {
+        found->second.mRefCount++;
+        return found->second.pRootSignature;
+    }
+
+    RootSignatureDesc rootDesc = {};
+    rootDesc.mStaticSamplerCount = 0;
+    rootDesc.mShaderCount = shaderCount;
+    rootDesc.ppShaders = ppShaders;
+
+    RootSignature *pRootSignature = nullptr;
+    addRootSignature(pCacheRenderer, &rootDesc, &pRootSignature);
+
+    RootSignatureEntry &entry = gRootSignatures[key];
+    entry.pRootSignature = pRootSignature;
+    entry.mRefCount = 1;
+    for (uint32_t s = 0; s < shaderCount; ++s) {
+        entry.mShaderSources.push_back(ShaderSource(ppShaders[s]));
+    }
+    gRootSignatureKeys[pRootSignature] = key;
+
+    return pRootSignature;
+}
+
+void ReleaseRootSignature(RootSignature *pRootSignature) {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    auto key = gRootSignatureKeys.find(pRootSignature);
+    if (key == gRootSignatureKeys.end()) {
+        LOGF(LogLevel::eERROR, "Releasing a root signature that is not in the cache");
+        return;
+    }
+
+    RootSignatureEntry &entry = gRootSignatures[key->second];
+    if (--entry.mRefCount > 0) {
+        return;
+    }
+
+    for (auto &chunks : entry.mChunks) {
+        for (auto &chunk : chunks) {
+            UntrackAllocation(chunk.pSet);
+            removeDescriptorSet(pCacheRenderer, chunk.pSet);
+        }
+    }
+    removeRootSignature(pCacheRenderer, pRootSignature);
+
+    gRootSignatures.erase(key->second);
+    gRootSignatureKeys.erase(key);
+}
+
+void RetainRootSignature(RootSignature *pRootSignature) {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    gRootSignatures[gRootSignatureKeys.at(pRootSignature)].mRefCount++;
+}
+
+auto RootSignatureShaderSources(RootSignature *pRootSignature) -> std::vector<std::string> {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    return gRootSignatures[gRootSignatureKeys.at(pRootSignature)].mShaderSources;
+}
+
+auto AllocateDescriptors(RootSignature *pRootSignature, DescriptorUpdateFrequency updateFrequency, uint32_t count)
+    -> DescriptorRange {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    RootSignatureEntry &entry = gRootSignatures[gRootSignatureKeys.at(pRootSignature)];
+    auto &chunks = entry.mChunks[updateFrequency];
+
+    // First fit over the chunks already created for this root signature and frequency.
+    for (auto &chunk : chunks) {
+        for (auto it = chunk.mFreeSlots.begin(); it != chunk.mFreeSlots.end(); ++it) {
+            if (it->mCount < count) {
+                continue;
+            }
+
+            DescriptorRange range{chunk.pSet, it->mFirst, count};
+            it->mFirst += count;
+            it->mCount -= count;
+            if (it->mCount == 0) {
+                chunk.mFreeSlots.erase(it);
+            }
+            return range;
+        }
+    }
+
+    DescriptorChunk chunk{};
+    chunk.mCapacity = std::max(count, DescriptorChunkSize);
+
+    DescriptorSetDesc desc = {pRootSignature, updateFrequency, chunk.mCapacity};
+    addDescriptorSet(pCacheRenderer, &desc, &chunk.pSet);
+    TrackDescriptorSet(chunk.pSet, chunk.mCapacity);
+
+    if (chunk.mCapacity > count) {
+        chunk.mFreeSlots.push_back({count, chunk.mCapacity - count});
+    }
+    chunks.push_back(chunk);
+
+    return {chunk.pSet, 0, count};
+}
+
+void FreeDescriptors(DescriptorRange &range) {
+    if (range.pSet == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    for (auto &[key, entry] : gRootSignatures) {
+        DescriptorChunk *pChunk = FindChunk(entry, range.pSet);
+        if (pChunk == nullptr) {
+            continue;
+        }
+
+        // Keep the free list sorted and merge with the neighbours so ranges do not fragment.
+        auto &freeSlots = pChunk->mFreeSlots;
+        auto it = std::lower_bound(freeSlots.begin(), freeSlots.end(), range.mFirst,
+                                   [](const FreeSlots &slots, uint32_t first) { return slots.mFirst < first; });
+        it = freeSlots.insert(it, {range.mFirst, range.mCount});
+
+        auto next = it + 1;
+        if (next != freeSlots.end() && it->mFirst + it->mCount == next->mFirst) {
+            it->mCount += next->mCount;
+            freeSlots.erase(next);
+        }
+        if (it != freeSlots.begin()) {
+            auto previous = it - 1;
+            if (previous->mFirst + previous->mCount == it->mFirst) {
+                previous->mCount += it->mCount;
+                freeSlots.erase(it);
+            }
+        }
+        break;
+    }
+
+    range = {};
+}
+
+void UpdateDescriptors(const DescriptorRange &range, uint32_t index, uint32_t paramCount, DescriptorData *pParams) {
+    updateDescriptorSet(pCacheRenderer, range.mFirst + index, range.pSet, paramCount, pParams);
+}
+
+void CmdBindDescriptors(Cmd *cmd, const DescriptorRange &range, uint32_t index) {
+    cmdBindDescriptorSet(cmd, range.mFirst + index, range.pSet);
+}
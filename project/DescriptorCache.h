@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <string>
+#include <vector>
+
+// Root signatures and descriptor sets shared by every scene, owned by MainApp.
+//
+// Root signatures are looked up by the resources their shaders declare, so every scene whose
+// shaders share a layout also shares the root signature. Descriptors are handed out as ranges of
+// slots carved from a few large descriptor sets per root signature and update frequency, so the
+// number of sets does not grow with the number of objects.
+
+struct DescriptorRange {
+    DescriptorSet *pSet;
+    uint32_t mFirst;
+    uint32_t mCount;
+};
+
+void InitDescriptorCache(Renderer *pRenderer);
+void ExitDescriptorCache();
+
+// Reference counted, the root signature is removed when its last user releases it.
+auto AcquireRootSignature(Shader **ppShaders, uint32_t shaderCount) -> RootSignature *;
+void ReleaseRootSignature(RootSignature *pRootSignature);
+// An extra reference for a holder that did not acquire the root signature itself.
+void RetainRootSignature(RootSignature *pRootSignature);
+// ShaderSource of each shader the root signature was created from, in order.
+auto RootSignatureShaderSources(RootSignature *pRootSignature) -> std::vector<std::string>;
+
+// Slots are returned to the pool on free and must no longer be in use by the GPU.
+auto AllocateDescriptors(RootSignature *pRootSignature, DescriptorUpdateFrequency updateFrequency, uint32_t count)
+    -> DescriptorRange;
+void FreeDescriptors(DescriptorRange &range);
+
+void UpdateDescriptors(const DescriptorRange &range, uint32_t index, uint32_t paramCount, DescriptorData *pParams);
+void CmdBindDescriptors(Cmd *cmd, const DescriptorRange &range, uint32_t index);
@@ -0,0 +1,177 @@
+#include "DynamicResolution.h"
+
+#include "DescriptorCache.h"
+#include "PipelineStateCache.h"
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+constexpr float MinScale = 0.5f;
+// Fraction of the remaining error corrected per frame. The GPU time lags ImageCount frames
+// behind the scale that produced it, a faster response would oscillate.
+constexpr float Response = 0.1f;
+// Changes smaller than this are ignored so the image does not shimmer at a steady load.
+constexpr float Deadband = 0.01f;
+
+struct UpscaleConstants {
+    float uvScale[2];
+    float uvMax[2];
+};
+
+Shader *pUpscaleShader = nullptr;
+RootSignature *pRootSignature = nullptr;
+uint32_t gUpscaleConstantsIndex = 0;
+Sampler *pLinearSampler = nullptr;
+Pipeline *pUpscalePipeline = nullptr;
+
+RGTargetDesc gSceneColorDesc = {};
+// One slot per frame in flight, the graph may hand out a different physical target each frame.
+DescriptorRange gUpscaleDescriptors = {};
+std::array<Texture *, ImageCount> pBoundSceneColors = {nullptr};
+
+float gScale = 1.0f;
+} // namespace
+
+static auto ScaledSize(uint32_t size) -> uint32_t {
+    return std::max(1u, (uint32_t)std::ceil((float)size * gScale));
+}
+
+void InitDynamicResolution(Renderer *pRenderer) {
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"upscale.vert", nullptr, 0};
+        desc.mStages[1] = {"upscale.frag", nullptr, 0};
+        pUpscaleShader = AcquireShader(desc);
+    }
+
+    pRootSignature = AcquireRootSignature(&pUpscaleShader, 1);
+    gUpscaleConstantsIndex = getDescriptorIndexFromName(pRootSignature, "upscaleConstants");
+
+    SamplerDesc samplerDesc = {FILTER_LINEAR,
+                               FILTER_LINEAR,
+                               MIPMAP_MODE_NEAREST,
+                               ADDRESS_MODE_CLAMP_TO_EDGE,
+                               ADDRESS_MODE_CLAMP_TO_EDGE,
+                               ADDRESS_MODE_CLAMP_TO_EDGE};
+    addSampler(pRenderer, &samplerDesc, &pLinearSampler);
+
+    gScale = 1.0f;
+}
+
+void ExitDynamicResolution(Renderer *pRenderer) {
+    removeSampler(pRenderer, pLinearSampler);
+    ReleaseRootSignature(pRootSignature);
+    ReleaseShader(pUpscaleShader);
+}
+
+auto LoadDynamicResolution(Renderer *pRenderer, SwapChain *pSwapChain) -> bool {
+    RenderTarget *pSwapChainTarget = pSwapChain->ppRenderTargets[0];
+
+    gSceneColorDesc = {};
+    gSceneColorDesc.mWidth = pSwapChainTarget->mWidth;
+    gSceneColorDesc.mHeight = pSwapChainTarget->mHeight;
+    gSceneColorDesc.mFormat = pSwapChainTarget->mFormat;
+    gSceneColorDesc.mClearValue = pSwapChainTarget->mClearValue;
+    gSceneColorDesc.pName = "Scene Color";
+
+    // The scene colour is bound per frame in CmdUpscale.
+    gUpscaleDescriptors = AllocateDescriptors(pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, ImageCount);
+    pBoundSceneColors = {nullptr};
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = false;
+        depthStateDesc.mDepthWrite = false;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 1;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.pColorFormats = &pSwapChainTarget->mFormat;
+        pipelineSettings.mSampleCount = pSwapChainTarget->mSampleCount;
+        pipelineSettings.mSampleQuality = pSwapChainTarget->mSampleQuality;
+        pipelineSettings.pRootSignature = pRootSignature;
+        pipelineSettings.pVertexLayout = NULL;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = pUpscaleShader;
+        pUpscalePipeline = AcquirePipeline(desc);
+    }
+
+    return true;
+}
+
+void UnloadDynamicResolution(Renderer *pRenderer) {
+    ReleasePipeline(pUpscalePipeline);
+    FreeDescriptors(gUpscaleDescriptors);
+}
+
+void UpdateDynamicResolution(bool enabled, float targetFrameMs) {
+    if (!enabled) {
+        gScale = 1.0f;
+        return;
+    }
+
+    const float gpuFrameMs = getGpuProfileTime(GpuProfileToken());
+    if (gpuFrameMs <= 0.0f) {
+        return;
+    }
+
+    // GPU time is taken to grow with the pixel count, the square of the scale.
+    const float desired = std::clamp(gScale * std::sqrt(targetFrameMs / gpuFrameMs), MinScale, 1.0f);
+    if (std::fabs(desired - gScale) > Deadband) {
+        gScale += (desired - gScale) * Response;
+    }
+}
+
+auto DynamicResolutionScale() -> float { return gScale; }
+
+auto DynamicResolutionTargetDesc() -> RGTargetDesc { return gSceneColorDesc; }
+
+void CmdSetDynamicResolutionViewport(Cmd *cmd, RenderTarget *pRenderTarget) {
+    const uint32_t width = ScaledSize(pRenderTarget->mWidth);
+    const uint32_t height = ScaledSize(pRenderTarget->mHeight);
+    cmdSetViewport(cmd, 0.0F, 0.0F, (float)width, (float)height, 0.0F, 1.0F);
+    cmdSetScissor(cmd, 0, 0, width, height);
+}
+
+void CmdUpscale(Cmd *cmd, RenderTarget *pSceneColor, uint32_t frameIndex) {
+    // The slot of this frame is no longer in use by the GPU, only rewritten when the target changed.
+    if (pBoundSceneColors[frameIndex] != pSceneColor->pTexture) {
+        pBoundSceneColors[frameIndex] = pSceneColor->pTexture;
+
+        DescriptorData params[2] = {};
+        params[0].pName = "sceneColor";
+        params[0].ppTextures = &pSceneColor->pTexture;
+        params[1].pName = "linearSampler";
+        params[1].ppSamplers = &pLinearSampler;
+        UpdateDescriptors(gUpscaleDescriptors, frameIndex, 2, params);
+    }
+
+    // Keep bilinear taps inside the rendered rectangle, the texels around it are stale.
+    const float width = (float)pSceneColor->mWidth;
+    const float height = (float)pSceneColor->mHeight;
+    const float renderedWidth = (float)ScaledSize(pSceneColor->mWidth);
+    const float renderedHeight = (float)ScaledSize(pSceneColor->mHeight);
+
+    UpscaleConstants constants = {};
+    constants.uvScale[0] = renderedWidth / width;
+    constants.uvScale[1] = renderedHeight / height;
+    constants.uvMax[0] = (renderedWidth - 0.5f) / width;
+    constants.uvMax[1] = (renderedHeight - 0.5f) / height;
+
+    cmdBindPipeline(cmd, pUpscalePipeline);
+    CmdBindDescriptors(cmd, gUpscaleDescriptors, frameIndex);
+    cmdBindPushConstants(cmd, pRootSignature, gUpscaleConstantsIndex, &constants);
+    cmdDraw(cmd, 3, 0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MainApp.h"
+#include "RenderGraph.h"
+
+#include <Common_3/Renderer/IRenderer.h>
+
+// Renders the scene into a swap chain sized colour target at a variable fraction of its size.
+//
+// The scene colour target and the depth buffer keep their full size, only the top left
+// viewport shrinks, so nothing is reallocated when the scale changes. The scene colour target is a
+// transient target of the render graph, it only lives from the scene pass to the upscale. Each frame the scale is
+// nudged towards the value that brings the GPU frame time, read from GpuProfileToken(), down to
+// the target. The result is upscaled into the swap chain with one bilinear full screen draw,
+// before the UI is drawn at native resolution.
+
+void InitDynamicResolution(Renderer *pRenderer);
+void ExitDynamicResolution(Renderer *pRenderer);
+
+auto LoadDynamicResolution(Renderer *pRenderer, SwapChain *pSwapChain) -> bool;
+void UnloadDynamicResolution(Renderer *pRenderer);
+
+// Call once per frame before drawing. When disabled the scale goes back to 1.
+void UpdateDynamicResolution(bool enabled, float targetFrameMs);
+
+// Constant for the whole frame.
+auto DynamicResolutionScale() -> float;
+// Full swap chain size, valid from Load to Unload.
+auto DynamicResolutionTargetDesc() -> RGTargetDesc;
+
+// Viewport and scissor covering the rendered part of pRenderTarget, which must be full size.
+void CmdSetDynamicResolutionViewport(Cmd *cmd, RenderTarget *pRenderTarget);
+
+// Draws the rendered part of pSceneColor over the whole bound target. pSceneColor is the graph's
+// target for DynamicResolutionTargetDesc and must be in RESOURCE_STATE_SHADER_RESOURCE.
+void CmdUpscale(Cmd *cmd, RenderTarget *pSceneColor, uint32_t frameIndex);
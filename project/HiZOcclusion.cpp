@@ -0,0 +1,422 @@
+#include "HiZOcclusion.h"
+
+#include "DescriptorCache.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+constexpr uint32_t DrawArgsSize = MaxMeshLodLevels * sizeof(IndirectDrawIndexArguments);
+
+struct CullUniformBlock {
+    mat4 viewProjection;
+    vec4 viewPos;
+    float lodErrors[MaxMeshLodLevels];
+    uint32_t hizSize[2];
+    uint32_t hizMipCount;
+    uint32_t instanceCount;
+    uint32_t lodCount;
+    uint32_t occlusionEnabled;
+    float pixelsPerUnit;
+    float maxErrorPx;
+    float viewportScale[2];
+};
+
+struct HiZConstants {
+    uint32_t srcSize[2];
+    uint32_t dstSize[2];
+};
+} // namespace
+
+static auto DispatchSize(uint32_t size, uint32_t groupSize) -> uint32_t { return (size + groupSize - 1) / groupSize; }
+
+void InitHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer, const float4 *pInstanceBounds, uint32_t instanceCount,
+                      const MeshLodChain &lodChain) {
+    hiz.mInstanceCount = instanceCount;
+    hiz.mInstanceBounds.assign(pInstanceBounds, pInstanceBounds + instanceCount);
+
+    hiz.mLodCount = (uint32_t)lodChain.mLevels.size();
+    hiz.mDrawArgsTemplate.assign(MaxMeshLodLevels, IndirectDrawIndexArguments{});
+    for (uint32_t lod = 0; lod < hiz.mLodCount; ++lod) {
+        hiz.mDrawArgsTemplate[lod].mIndexCount = lodChain.mLevels[lod].mIndexCount;
+        hiz.mDrawArgsTemplate[lod].mStartIndex = lodChain.mLevels[lod].mIndexOffset;
+        hiz.mLodErrors[lod] = lodChain.mLevels[lod].mError;
+    }
+
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"hiz_copy_depth.comp", nullptr, 0};
+        hiz.pCopyDepthShader = AcquireShader(desc);
+
+        desc.mStages[0] = {"hiz_downsample.comp", nullptr, 0};
+        hiz.pDownsampleShader = AcquireShader(desc);
+
+        desc.mStages[0] = {"hiz_cull.comp", nullptr, 0};
+        hiz.pCullShader = AcquireShader(desc);
+    }
+
+    {
+        Shader *shaders[] = {hiz.pCopyDepthShader, hiz.pDownsampleShader, hiz.pCullShader};
+        hiz.pRootSignature = AcquireRootSignature(shaders, 3);
+
+        hiz.mHiZConstantsIndex = getDescriptorIndexFromName(hiz.pRootSignature, "hizConstants");
+    }
+
+    {
+        IndirectArgumentDescriptor argDesc = {};
+        argDesc.mType = INDIRECT_DRAW_INDEX;
+
+        CommandSignatureDesc desc = {};
+        desc.mIndirectArgCount = 1;
+        desc.pArgDescs = &argDesc;
+        desc.mPacked = true;
+        addIndirectCommandSignature(pRenderer, &desc, &hiz.pDrawCommandSignature);
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mSize = instanceCount * sizeof(float4);
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = instanceCount;
+        desc.mDesc.mStructStride = sizeof(float4);
+        desc.pData = hiz.mInstanceBounds.data();
+        desc.ppBuffer = &hiz.pInstanceBoundsBuffer;
+        AddTrackedResource(&desc, NULL);
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER_RAW;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+        desc.mDesc.mSize = DrawArgsSize;
+        desc.mDesc.mElementCount = DrawArgsSize / sizeof(uint32_t);
+        desc.mDesc.mStructStride = sizeof(uint32_t);
+        desc.pData = hiz.mDrawArgsTemplate.data();
+        desc.ppBuffer = &hiz.pDrawArgsTemplateBuffer;
+        AddTrackedResource(&desc, NULL);
+
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_RW_BUFFER_RAW | DESCRIPTOR_TYPE_INDIRECT_ARGUMENT;
+        desc.mDesc.mStartState = RESOURCE_STATE_INDIRECT_ARGUMENT;
+        for (auto &buffer : hiz.pDrawArgsBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_BUFFER | DESCRIPTOR_TYPE_RW_BUFFER;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_ONLY;
+        desc.mDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mDesc.mSize = (uint64_t)instanceCount * MaxMeshLodLevels * sizeof(uint32_t);
+        desc.mDesc.mFirstElement = 0;
+        desc.mDesc.mElementCount = instanceCount * MaxMeshLodLevels;
+        desc.mDesc.mStructStride = sizeof(uint32_t);
+        desc.pData = NULL;
+        for (auto &buffer : hiz.pVisibleInstanceBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc ubDesc = {};
+        ubDesc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        ubDesc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+        ubDesc.mDesc.mSize = sizeof(CullUniformBlock);
+        ubDesc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        ubDesc.pData = NULL;
+        for (auto &buffer : hiz.pCullUniformBuffers) {
+            ubDesc.ppBuffer = &buffer;
+            AddTrackedResource(&ubDesc, NULL);
+        }
+    }
+
+    {
+        BufferLoadDesc desc = {};
+        desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNDEFINED;
+        desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_GPU_TO_CPU;
+        desc.mDesc.mFlags = BUFFER_CREATION_FLAG_PERSISTENT_MAP_BIT;
+        desc.mDesc.mStartState = RESOURCE_STATE_COPY_DEST;
+        desc.mDesc.mSize = DrawArgsSize;
+        desc.pData = NULL;
+        for (auto &buffer : hiz.pReadbackBuffers) {
+            desc.ppBuffer = &buffer;
+            AddTrackedResource(&desc, NULL);
+        }
+        hiz.mReadbackValid = {};
+    }
+
+    hiz.mCullDescriptors =
+        AllocateDescriptors(hiz.pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_FRAME, ImageCount * HiZVisibleSetCount);
+
+    waitForAllResourceLoads();
+
+    for (uint32_t i = 0; i < ImageCount; ++i) {
+        for (uint32_t set = 0; set < HiZVisibleSetCount; ++set) {
+            DescriptorData params[3] = {};
+            params[0].pName = "cullUniforms";
+            params[0].ppBuffers = &hiz.pCullUniformBuffers[i];
+            params[1].pName = "drawArgs";
+            params[1].ppBuffers = &hiz.pDrawArgsBuffers[set];
+            params[2].pName = "visibleInstances";
+            params[2].ppBuffers = &hiz.pVisibleInstanceBuffers[set];
+            UpdateDescriptors(hiz.mCullDescriptors, i * HiZVisibleSetCount + set, 3, params);
+        }
+    }
+
+    {
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_COMPUTE;
+        ComputePipelineDesc &pipelineSettings = desc.mComputeDesc;
+        pipelineSettings.pRootSignature = hiz.pRootSignature;
+
+        pipelineSettings.pShaderProgram = hiz.pCopyDepthShader;
+        hiz.pCopyDepthPipeline = AcquirePipeline(desc);
+
+        pipelineSettings.pShaderProgram = hiz.pDownsampleShader;
+        hiz.pDownsamplePipeline = AcquirePipeline(desc);
+
+        pipelineSettings.pShaderProgram = hiz.pCullShader;
+        hiz.pCullPipeline = AcquirePipeline(desc);
+    }
+}
+
+void ExitHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer) {
+    ReleasePipeline(hiz.pCopyDepthPipeline);
+    ReleasePipeline(hiz.pDownsamplePipeline);
+    ReleasePipeline(hiz.pCullPipeline);
+
+    FreeDescriptors(hiz.mCullDescriptors);
+
+    for (auto &buffer : hiz.pReadbackBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    for (auto &buffer : hiz.pCullUniformBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    for (auto &buffer : hiz.pVisibleInstanceBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    for (auto &buffer : hiz.pDrawArgsBuffers) {
+        RemoveTrackedResource(buffer);
+    }
+    RemoveTrackedResource(hiz.pDrawArgsTemplateBuffer);
+    RemoveTrackedResource(hiz.pInstanceBoundsBuffer);
+
+    removeIndirectCommandSignature(pRenderer, hiz.pDrawCommandSignature);
+    ReleaseRootSignature(hiz.pRootSignature);
+
+    ReleaseShader(hiz.pCopyDepthShader);
+    ReleaseShader(hiz.pDownsampleShader);
+    ReleaseShader(hiz.pCullShader);
+}
+
+auto LoadHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer, RenderTarget *pDepthBuffer) -> bool {
+    hiz.mHiZWidth = pDepthBuffer->mWidth;
+    hiz.mHiZHeight = pDepthBuffer->mHeight;
+    hiz.mHiZMipCount = 1;
+    while ((std::max(hiz.mHiZWidth, hiz.mHiZHeight) >> hiz.mHiZMipCount) > 0) {
+        ++hiz.mHiZMipCount;
+    }
+
+    {
+        TextureDesc desc = {};
+        desc.mWidth = hiz.mHiZWidth;
+        desc.mHeight = hiz.mHiZHeight;
+        desc.mDepth = 1;
+        desc.mArraySize = 1;
+        desc.mMipLevels = hiz.mHiZMipCount;
+        desc.mSampleCount = SAMPLE_COUNT_1;
+        desc.mFormat = TinyImageFormat_R32_SFLOAT;
+        desc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE | DESCRIPTOR_TYPE_RW_TEXTURE;
+        desc.pName = "HiZ Pyramid";
+
+        TextureLoadDesc loadDesc = {};
+        loadDesc.pDesc = &desc;
+        loadDesc.ppTexture = &hiz.pHiZTexture;
+        AddTrackedResource(&loadDesc, NULL);
+    }
+
+    waitForAllResourceLoads();
+
+    if (hiz.pHiZTexture == nullptr) {
+        return false;
+    }
+
+    {
+        hiz.mHiZSourceDescriptors = AllocateDescriptors(hiz.pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1);
+
+        DescriptorData params[3] = {};
+        params[0].pName = "depthTexture";
+        params[0].ppTextures = &pDepthBuffer->pTexture;
+        params[1].pName = "hizTexture";
+        params[1].ppTextures = &hiz.pHiZTexture;
+        params[2].pName = "instanceBounds";
+        params[2].ppBuffers = &hiz.pInstanceBoundsBuffer;
+        UpdateDescriptors(hiz.mHiZSourceDescriptors, 0, 3, params);
+    }
+
+    {
+        // Set i writes mip i, reading mip i - 1 for every set but the first.
+        hiz.mHiZMipDescriptors =
+            AllocateDescriptors(hiz.pRootSignature, DESCRIPTOR_UPDATE_FREQ_PER_DRAW, hiz.mHiZMipCount);
+
+        for (uint32_t mip = 0; mip < hiz.mHiZMipCount; ++mip) {
+            DescriptorData params[2] = {};
+            params[0].pName = "dstMip";
+            params[0].ppTextures = &hiz.pHiZTexture;
+            params[0].mUAVMipSlice = mip;
+            params[1].pName = "srcMip";
+            params[1].ppTextures = &hiz.pHiZTexture;
+            params[1].mUAVMipSlice = mip > 0 ? mip - 1 : 0;
+            UpdateDescriptors(hiz.mHiZMipDescriptors, mip, mip > 0 ? 2 : 1, params);
+        }
+    }
+
+    return true;
+}
+
+void UnloadHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer) {
+    FreeDescriptors(hiz.mHiZSourceDescriptors);
+    FreeDescriptors(hiz.mHiZMipDescriptors);
+    RemoveTrackedResource(hiz.pHiZTexture);
+}
+
+void BuildHiZPyramid(Cmd *cmd, HiZOcclusion &hiz) {
+    {
+        TextureBarrier hizBarrier = {hiz.pHiZTexture, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS};
+        cmdResourceBarrier(cmd, 0, nullptr, 1, &hizBarrier, 0, nullptr);
+    }
+
+    HiZConstants constants = {{hiz.mHiZWidth, hiz.mHiZHeight}, {hiz.mHiZWidth, hiz.mHiZHeight}};
+
+    cmdBindPipeline(cmd, hiz.pCopyDepthPipeline);
+    CmdBindDescriptors(cmd, hiz.mHiZSourceDescriptors, 0);
+    CmdBindDescriptors(cmd, hiz.mHiZMipDescriptors, 0);
+    cmdBindPushConstants(cmd, hiz.pRootSignature, hiz.mHiZConstantsIndex, &constants);
+    cmdDispatch(cmd, DispatchSize(hiz.mHiZWidth, 8), DispatchSize(hiz.mHiZHeight, 8), 1);
+
+    cmdBindPipeline(cmd, hiz.pDownsamplePipeline);
+    for (uint32_t mip = 1; mip < hiz.mHiZMipCount; ++mip) {
+        TextureBarrier uavBarrier = {hiz.pHiZTexture, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_UNORDERED_ACCESS};
+        cmdResourceBarrier(cmd, 0, nullptr, 1, &uavBarrier, 0, nullptr);
+
+        // Rounded down, the last texel of a row or column also reduces the odd source texel left
+        // over, so every level still covers all of level 0. hiz_cull relies on that.
+        constants.srcSize[0] = constants.dstSize[0];
+        constants.srcSize[1] = constants.dstSize[1];
+        constants.dstSize[0] = std::max(hiz.mHiZWidth >> mip, 1u);
+        constants.dstSize[1] = std::max(hiz.mHiZHeight >> mip, 1u);
+
+        CmdBindDescriptors(cmd, hiz.mHiZMipDescriptors, mip);
+        cmdBindPushConstants(cmd, hiz.pRootSignature, hiz.mHiZConstantsIndex, &constants);
+        cmdDispatch(cmd, DispatchSize(constants.dstSize[0], 8), DispatchSize(constants.dstSize[1], 8), 1);
+    }
+
+    {
+        TextureBarrier hizBarrier = {hiz.pHiZTexture, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE};
+        cmdResourceBarrier(cmd, 0, nullptr, 1, &hizBarrier, 0, nullptr);
+    }
+}
+
+void CullInstances(Cmd *cmd, HiZOcclusion &hiz, int imageIndex, const HiZCullParams &params) {
+    // The fence of imageIndex has been waited on, its readback holds the counters of that frame.
+    if (hiz.mReadbackValid[imageIndex]) {
+        const IndirectDrawIndexArguments *pArgs =
+            (const IndirectDrawIndexArguments *)hiz.pReadbackBuffers[imageIndex]->pCpuMappedAddress;
+
+        hiz.mStats.mDrawnInstances = 0;
+        for (uint32_t lod = 0; lod < hiz.mLodCount; ++lod) {
+            hiz.mStats.mDrawnInstances += pArgs[lod].mInstanceCount;
+        }
+        hiz.mStats.mCulledInstances = hiz.mInstanceCount - hiz.mStats.mDrawnInstances;
+    }
+
+    {
+        CullUniformBlock uniform = {};
+        uniform.viewProjection = params.mViewProjection;
+        uniform.viewPos = vec4(params.mViewPosition, 1.0f);
+        for (uint32_t lod = 0; lod < MaxMeshLodLevels; ++lod) {
+            uniform.lodErrors[lod] = hiz.mLodErrors[lod];
+        }
+        uniform.hizSize[0] = hiz.mHiZWidth;
+        uniform.hizSize[1] = hiz.mHiZHeight;
+        uniform.hizMipCount = hiz.mHiZMipCount;
+        uniform.instanceCount = hiz.mInstanceCount;
+        uniform.lodCount = hiz.mLodCount;
+        uniform.occlusionEnabled = params.mOcclusionEnabled ? 1 : 0;
+        uniform.pixelsPerUnit = params.mPixelsPerUnit;
+        uniform.maxErrorPx = params.mMaxLodErrorPx;
+        uniform.viewportScale[0] = params.mViewportScale;
+        uniform.viewportScale[1] = params.mViewportScale;
+
+        BufferUpdateDesc uniformUpdate = {hiz.pCullUniformBuffers[imageIndex]};
+        BeginTrackedUpdate(&uniformUpdate);
+        *(CullUniformBlock *)uniformUpdate.pMappedData = uniform;
+        endUpdateResource(&uniformUpdate, NULL);
+    }
+
+    hiz.mCurrentSet = (hiz.mCurrentSet + 1) % HiZVisibleSetCount;
+    Buffer *pDrawArgs = hiz.pDrawArgsBuffers[hiz.mCurrentSet];
+    Buffer *pVisibleInstances = hiz.pVisibleInstanceBuffers[hiz.mCurrentSet];
+
+    {
+        BufferBarrier barrier = {pDrawArgs, RESOURCE_STATE_INDIRECT_ARGUMENT, RESOURCE_STATE_COPY_DEST};
+        cmdResourceBarrier(cmd, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    cmdUpdateBuffer(cmd, pDrawArgs, 0, hiz.pDrawArgsTemplateBuffer, 0, DrawArgsSize);
+
+    {
+        BufferBarrier barriers[] = {
+            {pDrawArgs, RESOURCE_STATE_COPY_DEST, RESOURCE_STATE_UNORDERED_ACCESS},
+            {pVisibleInstances, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_UNORDERED_ACCESS},
+        };
+        cmdResourceBarrier(cmd, 2, barriers, 0, nullptr, 0, nullptr);
+    }
+
+    cmdBindPipeline(cmd, hiz.pCullPipeline);
+    CmdBindDescriptors(cmd, hiz.mHiZSourceDescriptors, 0);
+    CmdBindDescriptors(cmd, hiz.mCullDescriptors, imageIndex * HiZVisibleSetCount + hiz.mCurrentSet);
+    cmdDispatch(cmd, DispatchSize(hiz.mInstanceCount, 64), 1, 1);
+
+    {
+        BufferBarrier barriers[] = {
+            {pDrawArgs, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_COPY_SOURCE},
+            {pVisibleInstances, RESOURCE_STATE_UNORDERED_ACCESS, RESOURCE_STATE_SHADER_RESOURCE},
+        };
+        cmdResourceBarrier(cmd, 2, barriers, 0, nullptr, 0, nullptr);
+    }
+
+    cmdUpdateBuffer(cmd, hiz.pReadbackBuffers[imageIndex], 0, pDrawArgs, 0, DrawArgsSize);
+    hiz.mReadbackValid[imageIndex] = true;
+
+    {
+        BufferBarrier barrier = {pDrawArgs, RESOURCE_STATE_COPY_SOURCE, RESOURCE_STATE_INDIRECT_ARGUMENT};
+        cmdResourceBarrier(cmd, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+auto HiZCurrentSet(const HiZOcclusion &hiz) -> uint32_t { return hiz.mCurrentSet; }
+
+auto HiZVisibleInstanceBuffer(const HiZOcclusion &hiz, uint32_t set) -> Buffer * {
+    return hiz.pVisibleInstanceBuffers[set];
+}
+
+void CmdDrawHiZVisibleLod(Cmd *cmd, const HiZOcclusion &hiz, uint32_t set, uint32_t lod) {
+    cmdExecuteIndirect(cmd, hiz.pDrawCommandSignature, 1, hiz.pDrawArgsBuffers[set],
+                       lod * sizeof(IndirectDrawIndexArguments), nullptr, 0);
+}
+
+auto HiZStats(const HiZOcclusion &hiz) -> HiZCullStats { return hiz.mStats; }
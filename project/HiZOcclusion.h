@@ -0,0 +1,102 @@
+#pragma once
+
+#include "DescriptorCache.h"
+#include "MainApp.h"
+#include "MeshLod.h"
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <array>
+#include <vector>
+
+// GPU instance culling against a hierarchical depth pyramid.
+//
+// Each frame the caller lays down depth for the previous frame's visible set, builds the
+// pyramid from it and culls every instance bound against the pyramid. Surviving instances
+// get a level of detail and are appended to one list per level, together with indirect
+// draw arguments, so the main pass draws them with one indirect draw per level.
+//
+// Two visible sets are kept: the one being written this frame and the one from the previous
+// frame that seeds the depth pre-pass.
+//
+// A HiZOcclusion holds the pyramid and visible sets of one instance set, each scene instance that
+// culls keeps its own.
+
+struct HiZCullParams {
+    mat4 mViewProjection;
+    vec3 mViewPosition;
+    float mPixelsPerUnit;
+    float mMaxLodErrorPx;
+    bool mOcclusionEnabled;
+    // Fraction of the depth buffer rendered in each axis, from its top left corner.
+    float mViewportScale;
+};
+
+struct HiZCullStats {
+    uint32_t mDrawnInstances;
+    uint32_t mCulledInstances;
+};
+
+constexpr uint32_t HiZVisibleSetCount = 2;
+
+struct HiZOcclusion {
+    Shader *pCopyDepthShader = nullptr;
+    Shader *pDownsampleShader = nullptr;
+    Shader *pCullShader = nullptr;
+
+    RootSignature *pRootSignature = nullptr;
+    uint32_t mHiZConstantsIndex = 0;
+    CommandSignature *pDrawCommandSignature = nullptr;
+
+    Pipeline *pCopyDepthPipeline = nullptr;
+    Pipeline *pDownsamplePipeline = nullptr;
+    Pipeline *pCullPipeline = nullptr;
+
+    Texture *pHiZTexture = nullptr;
+    uint32_t mHiZWidth = 0;
+    uint32_t mHiZHeight = 0;
+    uint32_t mHiZMipCount = 0;
+
+    std::vector<float4> mInstanceBounds;
+    std::vector<IndirectDrawIndexArguments> mDrawArgsTemplate;
+    std::array<float, MaxMeshLodLevels> mLodErrors = {};
+    uint32_t mInstanceCount = 0;
+    uint32_t mLodCount = 0;
+
+    Buffer *pInstanceBoundsBuffer = nullptr;
+    Buffer *pDrawArgsTemplateBuffer = nullptr;
+    std::array<Buffer *, HiZVisibleSetCount> pDrawArgsBuffers = {nullptr};
+    std::array<Buffer *, HiZVisibleSetCount> pVisibleInstanceBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pCullUniformBuffers = {nullptr};
+    std::array<Buffer *, ImageCount> pReadbackBuffers = {nullptr};
+    std::array<bool, ImageCount> mReadbackValid = {};
+
+    DescriptorRange mHiZSourceDescriptors = {};
+    DescriptorRange mHiZMipDescriptors = {};
+    DescriptorRange mCullDescriptors = {};
+
+    uint32_t mCurrentSet = 0;
+    HiZCullStats mStats = {};
+};
+
+// pInstanceBounds holds one world space bounding sphere (center, radius) per instance.
+void InitHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer, const float4 *pInstanceBounds, uint32_t instanceCount,
+                      const MeshLodChain &lodChain);
+void ExitHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer);
+
+auto LoadHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer, RenderTarget *pDepthBuffer) -> bool;
+void UnloadHiZOcclusion(HiZOcclusion &hiz, Renderer *pRenderer);
+
+// pDepthBuffer must be in RESOURCE_STATE_SHADER_RESOURCE.
+void BuildHiZPyramid(Cmd *cmd, HiZOcclusion &hiz);
+void CullInstances(Cmd *cmd, HiZOcclusion &hiz, int imageIndex, const HiZCullParams &params);
+
+// Visible set written by the latest CullInstances. Before culling it is still the previous frame's set.
+auto HiZCurrentSet(const HiZOcclusion &hiz) -> uint32_t;
+auto HiZVisibleInstanceBuffer(const HiZOcclusion &hiz, uint32_t set) -> Buffer *;
+
+// Visible instances of one level are stored at lod * instanceCount in the visible instance buffer.
+void CmdDrawHiZVisibleLod(Cmd *cmd, const HiZOcclusion &hiz, uint32_t set, uint32_t lod);
+
+// Counters read back from the GPU, they lag ImageCount frames behind.
+auto HiZStats(const HiZOcclusion &hiz) -> HiZCullStats;
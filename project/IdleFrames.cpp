@@ -0,0 +1,153 @@
+#include "IdleFrames.h"
+
+#include "MainApp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <Common_3/OS/Interfaces/ICameraController.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// Drawn after the last change: occlusion culls against the depth of the previous frame and the GPU
+// times behind dynamic resolution arrive with the frames in flight.
+constexpr uint32_t SettleFrames = ImageCount;
+constexpr float StatsWindowSeconds = 1.0f;
+
+uint32_t gFramesToSettle = SettleFrames;
+bool bDrawing = true;
+Clock::time_point gRedrawTime = Clock::time_point::max();
+
+// The current stats window.
+Clock::time_point gWindowStart = Clock::now();
+double gWindowCpuSeconds = 0.0;
+uint32_t gWindowFrames = 0;
+uint32_t gWindowDrawnFrames = 0;
+float gWindowGpuMs = 0.0f;
+
+// Cost of a drawn frame in the last window that had any, what a skipped frame is taken to save.
+float gDrawnFrameCpuMs = 0.0f;
+float gDrawnFrameGpuMs = 0.0f;
+
+IdleFrameStats gStats = {};
+} // namespace
+
+// CPU time spent by the calling thread, waits excluded.
+static auto ThreadCpuSeconds() -> double {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto seconds = [](const FILETIME &time) {
+        return (((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return seconds(kernel) + seconds(user);
+#else
+    timespec time = {};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+}
+
+static void WaitForWake() {
+    const Clock::time_point now = Clock::now();
+    auto waitMs = (int64_t)MaxIdleWaitMs;
+    if (gRedrawTime != Clock::time_point::max()) {
+        // Rounded up, the timer would otherwise be polled for its last millisecond.
+        waitMs = std::min(waitMs, (int64_t)std::chrono::ceil<std::chrono::milliseconds>(gRedrawTime - now).count());
+    }
+    if (waitMs <= 0) {
+        return;
+    }
+
+#if defined(_WIN32)
+    // Returns as soon as input or any other message is queued for the window, including messages
+    // already queued but not yet handled.
+    MsgWaitForMultipleObjectsEx(0, nullptr, (DWORD)waitMs, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+#endif
+}
+
+void RequestRedraw(float delaySeconds) {
+    const auto delay = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(delaySeconds));
+    gRedrawTime = std::min(gRedrawTime, Clock::now() + delay);
+}
+
+auto UpdateIdleFrames(bool enabled, bool changed, bool overlayChanged) -> bool {
+    if (Clock::now() >= gRedrawTime) {
+        gRedrawTime = Clock::time_point::max();
+        changed = true;
+    }
+
+    if (changed || !enabled) {
+        gFramesToSettle = SettleFrames;
+        bDrawing = true;
+    } else if (gFramesToSettle > 0) {
+        gFramesToSettle--;
+        bDrawing = true;
+    } else {
+        // The scene has settled, drawing the frame once shows the new overlay.
+        bDrawing = overlayChanged;
+    }
+    return bDrawing;
+}
+
+void EndIdleFrame() {
+    gWindowFrames++;
+    if (bDrawing) {
+        gWindowDrawnFrames++;
+        gWindowGpuMs += getGpuProfileTime(GpuProfileToken());
+    } else {
+        WaitForWake();
+    }
+
+    const float elapsed = std::chrono::duration<float>(Clock::now() - gWindowStart).count();
+    if (elapsed < StatsWindowSeconds) {
+        return;
+    }
+
+    const double cpuSeconds = ThreadCpuSeconds();
+    const float cpuMs = (float)(cpuSeconds - gWindowCpuSeconds) * 1000.0f;
+    const uint32_t skippedFrames = gWindowFrames - gWindowDrawnFrames;
+    const float elapsedMs = elapsed * 1000.0f;
+
+    // Skipped frames take next to no CPU time, so the drawn ones are charged with all of it.
+    if (gWindowDrawnFrames > 0) {
+        gDrawnFrameCpuMs = cpuMs / gWindowDrawnFrames;
+        gDrawnFrameGpuMs = gWindowGpuMs / gWindowDrawnFrames;
+    }
+
+    gStats.mSkippedFraction = (float)skippedFrames / (float)gWindowFrames;
+    gStats.mCpuUtilization = cpuMs / elapsedMs;
+    gStats.mCpuSaved = gDrawnFrameCpuMs * skippedFrames / elapsedMs;
+    gStats.mGpuUtilization = gWindowGpuMs / elapsedMs;
+    gStats.mGpuSaved = gDrawnFrameGpuMs * skippedFrames / elapsedMs;
+
+    gWindowStart = Clock::now();
+    gWindowCpuSeconds = cpuSeconds;
+    gWindowFrames = 0;
+    gWindowDrawnFrames = 0;
+    gWindowGpuMs = 0.0f;
+}
+
+auto CameraMoved(ICameraController *pCamera, mat4 *pLastView) -> bool {
+    const mat4 view = pCamera->getViewMatrix();
+    const bool moved = memcmp(&view, pLastView, sizeof(view)) != 0;
+    *pLastView = view;
+    return moved;
+}
+
+auto GetIdleFrameStats() -> IdleFrameStats { return gStats; }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Common_3/OS/Math/MathTypes.h>
+
+#include <cstdint>
+
+class ICameraController;
+
+// Skips recording and presenting frames while nothing on screen changes, owned by MainApp.
+//
+// Every frame MainApp gathers whether the scene, the UI or anything still in progress changed and
+// asks UpdateIdleFrames whether to draw. After the last change a few more frames are drawn so that
+// work that lags behind by the frames in flight settles. A skipped frame leaves the last presented
+// image on screen and EndIdleFrame blocks until a window message arrives, a redraw timer runs out
+// or MaxIdleWaitMs passed, whichever comes first, so an idle app neither spins the CPU nor the GPU.
+
+// Gamepads are polled rather than sending messages, and MainApp's own timers such as the overlay
+// refresh run on the frame time, so an idle loop still goes round this often.
+constexpr uint32_t MaxIdleWaitMs = 50;
+
+// Redraw after delaySeconds even if nothing reports a change, e.g. for a scene animating on a
+// timer. Main thread only.
+void RequestRedraw(float delaySeconds = 0.0f);
+
+// Call once per frame after everything that may change has been updated. Returns whether the
+// frame is drawn, always true when skipping is disabled. overlayChanged draws the frame without
+// counting as a change, nothing else lags behind a new overlay and needs the frames to settle.
+auto UpdateIdleFrames(bool enabled, bool changed, bool overlayChanged) -> bool;
+
+// Call at the end of every frame, drawn or not. Waits on skipped frames.
+void EndIdleFrame();
+
+// True when the camera's view differs from *pLastView, which is updated. For the scenes' Update.
+auto CameraMoved(ICameraController *pCamera, mat4 *pLastView) -> bool;
+
+// Over the last second. Utilization is busy time over elapsed time, the CPU's of the main thread.
+// Saved is an estimate of what the skipped frames would have cost at the average of the drawn ones.
+struct IdleFrameStats {
+    float mSkippedFraction;
+    float mCpuUtilization;
+    float mCpuSaved;
+    float mGpuUtilization;
+    float mGpuSaved;
+};
+
+auto GetIdleFrameStats() -> IdleFrameStats;
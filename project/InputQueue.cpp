@@ -0,0 +1,85 @@
+#include "InputQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+static_assert((InputQueueCapacity & (InputQueueCapacity - 1)) == 0, "InputQueueCapacity must be a power of two");
+
+constexpr int64_t StatsWindowUSec = 1000000;
+
+// Counts of events ever pushed and drained, the slot is the count modulo the capacity. Each is
+// written by one side only and kept on its own cache line.
+alignas(64) std::atomic<uint32_t> gWriteCount{0};
+alignas(64) std::atomic<uint32_t> gReadCount{0};
+alignas(64) std::atomic<uint32_t> gDropped{0};
+InputEvent gEvents[InputQueueCapacity] = {};
+
+// Consumer side, the current stats window.
+int64_t gWindowStart = 0;
+uint32_t gWindowEvents = 0;
+uint32_t gWindowBatches = 0;
+int64_t gWindowLatencyUSec = 0;
+int64_t gWindowMaxLatencyUSec = 0;
+
+InputQueueStats gStats = {};
+} // namespace
+
+auto InputTimeUSec() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+auto PushInputEvent(InputBindings::Binding binding, float2 value) -> bool {
+    const uint32_t write = gWriteCount.load(std::memory_order_relaxed);
+    if (write - gReadCount.load(std::memory_order_acquire) == InputQueueCapacity) {
+        gDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    gEvents[write % InputQueueCapacity] = {binding, value, InputTimeUSec()};
+    gWriteCount.store(write + 1, std::memory_order_release);
+
+    return true;
+}
+
+auto DrainInputEvents(InputEvent *pEvents, uint32_t maxCount) -> uint32_t {
+    const uint32_t read = gReadCount.load(std::memory_order_relaxed);
+    const uint32_t count = std::min(gWriteCount.load(std::memory_order_acquire) - read, maxCount);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        pEvents[i] = gEvents[(read + i) % InputQueueCapacity];
+    }
+    gReadCount.store(read + count, std::memory_order_release);
+
+    const int64_t now = InputTimeUSec();
+    for (uint32_t i = 0; i < count; ++i) {
+        const int64_t latency = now - pEvents[i].mTimeUSec;
+        gWindowLatencyUSec += latency;
+        gWindowMaxLatencyUSec = std::max(gWindowMaxLatencyUSec, latency);
+    }
+    gWindowEvents += count;
+    gWindowBatches += count > 0 ? 1 : 0;
+
+    if (now - gWindowStart >= StatsWindowUSec) {
+        gStats.mEvents = gWindowEvents;
+        gStats.mBatches = gWindowBatches;
+        gStats.mAverageLatencyMs = gWindowEvents > 0 ? gWindowLatencyUSec / (gWindowEvents * 1000.0f) : 0.0f;
+        gStats.mMaxLatencyMs = gWindowMaxLatencyUSec / 1000.0f;
+
+        gWindowStart = now;
+        gWindowEvents = 0;
+        gWindowBatches = 0;
+        gWindowLatencyUSec = 0;
+        gWindowMaxLatencyUSec = 0;
+    }
+
+    return count;
+}
+
+auto GetInputQueueStats() -> InputQueueStats {
+    InputQueueStats stats = gStats;
+    stats.mDropped = gDropped.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Common_3/OS/Interfaces/IInput.h>
+#include <Common_3/OS/Math/MathTypes.h>
+
+#include <cstdint>
+
+// Input events passed from the thread sampling input to the thread simulating, without locks.
+//
+// The queue is a ring of InputQueueCapacity events with one producer and one consumer. The input
+// action callbacks push an event stamped with the time it was sampled, the simulation drains every
+// queued event as one batch at the start of its tick and applies them in order. Nothing else is
+// touched from the callbacks, so input sampling can move to a thread of its own. The time an event
+// waited is recorded on drain, as the latency from sampling to the tick that used it.
+
+// A power of two. A full queue drops the new events, they are counted in the stats.
+constexpr uint32_t InputQueueCapacity = 256;
+
+struct InputEvent {
+    InputBindings::Binding mBinding;
+    float2 mValue;
+    int64_t mTimeUSec;
+};
+
+// Microseconds on a steady clock, the time base of InputEvent::mTimeUSec.
+auto InputTimeUSec() -> int64_t;
+
+// Producer thread only. Returns false when the queue is full and the event was dropped.
+auto PushInputEvent(InputBindings::Binding binding, float2 value) -> bool;
+
+// Consumer thread only. Removes up to maxCount events in the order they were pushed, returns how
+// many were written to pEvents.
+auto DrainInputEvents(InputEvent *pEvents, uint32_t maxCount) -> uint32_t;
+
+// Over the last second of drains. Latency is from an event being pushed to its drain.
+struct InputQueueStats {
+    uint32_t mEvents;
+    uint32_t mBatches;
+    float mAverageLatencyMs;
+    float mMaxLatencyMs;
+    // Since start.
+    uint32_t mDropped;
+};
+
+auto GetInputQueueStats() -> InputQueueStats;
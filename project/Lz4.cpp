@@ -0,0 +1,179 @@
+#include "Lz4.h"
+
+#include <cstring>
+
+namespace {
+constexpr size_t MinMatch = 4;
+// The last match has to start this far from the end, the last literals are at least LastLiterals.
+constexpr size_t MatchLimit = 12;
+constexpr size_t LastLiterals = 5;
+constexpr size_t MaxOffset = 65535;
+constexpr uint32_t HashBits = 12;
+} // namespace
+
+static auto Read32(const uint8_t *p) -> uint32_t {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static auto Hash(uint32_t sequence) -> uint32_t { return (sequence * 2654435761u) >> (32 - HashBits); }
+
+// 15 in the token nibble, then bytes of 255 until the remainder.
+static auto WriteLength(uint8_t *pOut, const uint8_t *pEnd, size_t length) -> uint8_t * {
+    for (; length >= 255; length -= 255) {
+        if (pOut >= pEnd) {
+            return nullptr;
+        }
+        *pOut++ = 255;
+    }
+    if (pOut >= pEnd) {
+        return nullptr;
+    }
+    *pOut++ = (uint8_t)length;
+    return pOut;
+}
+
+static auto WriteSequence(uint8_t *pOut, const uint8_t *pEnd, const uint8_t *pLiterals, size_t literalCount,
+                          size_t offset, size_t matchLength) -> uint8_t * {
+    if (pOut >= pEnd) {
+        return nullptr;
+    }
+    uint8_t *pToken = pOut++;
+    *pToken = (uint8_t)((literalCount >= 15 ? 15 : literalCount) << 4);
+    if (literalCount >= 15 && (pOut = WriteLength(pOut, pEnd, literalCount - 15)) == nullptr) {
+        return nullptr;
+    }
+
+    if ((size_t)(pEnd - pOut) < literalCount) {
+        return nullptr;
+    }
+    if (literalCount > 0) {
+        memcpy(pOut, pLiterals, literalCount);
+        pOut += literalCount;
+    }
+
+    // The last sequence has literals only.
+    if (matchLength == 0) {
+        return pOut;
+    }
+
+    if (pEnd - pOut < 2) {
+        return nullptr;
+    }
+    *pOut++ = (uint8_t)offset;
+    *pOut++ = (uint8_t)(offset >> 8);
+
+    const size_t extra = matchLength - MinMatch;
+    *pToken |= (uint8_t)(extra >= 15 ? 15 : extra);
+    if (extra >= 15 && (pOut = WriteLength(pOut, pEnd, extra - 15)) == nullptr) {
+        return nullptr;
+    }
+    return pOut;
+}
+
+auto Lz4CompressBound(size_t size) -> size_t { return size + size / 255 + 16; }
+
+auto Lz4Compress(const uint8_t *pSource, size_t size, uint8_t *pDest, size_t capacity) -> size_t {
+    const uint8_t *pEnd = pDest + capacity;
+    uint8_t *pOut = pDest;
+
+    // Positions of the last occurrence of each hashed 4 byte sequence, plus one, zero is empty.
+    uint32_t table[1 << HashBits] = {};
+
+    size_t anchor = 0;
+    size_t position = 0;
+    while (size >= MatchLimit && position + MatchLimit <= size) {
+        const uint32_t sequence = Read32(pSource + position);
+        uint32_t &slot = table[Hash(sequence)];
+        const size_t candidate = slot;
+        slot = (uint32_t)(position + 1);
+
+        if (candidate == 0 || position - (candidate - 1) > MaxOffset || Read32(pSource + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+
+        const size_t matchStart = candidate - 1;
+        size_t length = MinMatch;
+        while (position + length < size - LastLiterals && pSource[matchStart + length] == pSource[position + length]) {
+            length++;
+        }
+
+        pOut = WriteSequence(pOut, pEnd, pSource + anchor, position - anchor, position - matchStart, length);
+        if (pOut == nullptr) {
+            return 0;
+        }
+        position += length;
+        anchor = position;
+    }
+
+    pOut = WriteSequence(pOut, pEnd, pSource + anchor, size - anchor, 0, 0);
+    return pOut == nullptr ? 0 : (size_t)(pOut - pDest);
+}
+
+auto Lz4Decompress(const uint8_t *pSource, size_t sourceSize, uint8_t *pDest, size_t destSize) -> bool {
+    const uint8_t *pIn = pSource;
+    const uint8_t *pInEnd = pSource + sourceSize;
+    uint8_t *pOut = pDest;
+    uint8_t *pOutEnd = pDest + destSize;
+
+    auto readLength = [&pIn, pInEnd](size_t &length) {
+        uint8_t byte = 255;
+        while (byte == 255) {
+            if (pIn >= pInEnd) {
+                return false;
+            }
+            byte = *pIn++;
+            length += byte;
+        }
+        return true;
+    };
+
+    while (pIn < pInEnd) {
+        const uint8_t token = *pIn++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(literalCount)) {
+            return false;
+        }
+        if ((size_t)(pInEnd - pIn) < literalCount || (size_t)(pOutEnd - pOut) < literalCount) {
+            return false;
+        }
+        if (literalCount > 0) {
+            memcpy(pOut, pIn, literalCount);
+            pIn += literalCount;
+            pOut += literalCount;
+        }
+
+        if (pIn == pInEnd) {
+            break;
+        }
+
+        if (pInEnd - pIn < 2) {
+            return false;
+        }
+        const size_t offset = pIn[0] | (size_t)pIn[1] << 8;
+        pIn += 2;
+        if (offset == 0 || offset > (size_t)(pOut - pDest)) {
+            return false;
+        }
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MinMatch;
+        if ((size_t)(pOutEnd - pOut) < matchLength) {
+            return false;
+        }
+
+        // Byte by byte, the match may overlap the bytes it produces.
+        const uint8_t *pMatch = pOut - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            pOut[i] = pMatch[i];
+        }
+        pOut += matchLength;
+    }
+    return pOut == pOutEnd;
+}
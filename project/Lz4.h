@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The LZ4 block format, without the frame around it: compressed data from these functions can be
+// read by any LZ4 decoder given the decompressed size, and the other way around.
+//
+// Compression is greedy with a single hash table, which is the fast mode of the reference encoder
+// and decompression needs no state. Both are only used on assets, offline in the packer and while
+// opening packed files.
+
+// Largest output Lz4Compress can produce for size bytes of input.
+auto Lz4CompressBound(size_t size) -> size_t;
+
+// Returns the compressed size, or zero when the result does not fit in capacity.
+auto Lz4Compress(const uint8_t *pSource, size_t size, uint8_t *pDest, size_t capacity) -> size_t;
+
+// Decompresses exactly destSize bytes, false when the input is malformed or of another size.
+auto Lz4Decompress(const uint8_t *pSource, size_t sourceSize, uint8_t *pDest, size_t destSize) -> bool;
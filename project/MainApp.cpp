@@ -1,7 +1,22 @@
 #include "MainApp.h"
 
-#include "Scene.h"
-#include "2.Lighting/Scene02BasicLighting.h"
+#include "AssetPack.h"
+#include "Bvh.h"
+#include "DebugOverlay.h"
+#include "DescriptorCache.h"
+#include "DynamicResolution.h"
+#include "IdleFrames.h"
+#include "InputQueue.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "QualityPresets.h"
+#include "RenderGraph.h"
+#include "ResourceCache.h"
+#include "SceneRegistry.h"
+#include "StartupTimeline.h"
+#include "TextureStreamer.h"
+#include "UploadBatcher.h"
+#include <Common_3/OS/Interfaces/ICameraController.h>
 #include <Common_3/OS/Interfaces/IFileSystem.h>
 #include <Common_3/OS/Interfaces/IFont.h>
 #include <Common_3/OS/Interfaces/IInput.h>
@@ -13,7 +28,12 @@
 #include <Common_3/Renderer/IResourceLoader.h>
 #include <Common_3/ThirdParty/OpenSource/renderdoc/renderdoc_app.h>
 #include <array>
+#include <atomic>
+#include <cstdio>
 #include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
 
 extern RendererApi gSelectedRendererApi;
 
@@ -39,17 +59,79 @@ UIComponent *pGuiWindow{nullptr};
 FontDrawDesc gFrameTimeDraw;
 uint32_t gFontID;
 
+char gResourceCacheText[128] = {};
+char gPipelineCacheText[128] = {};
+char gUploadText[64] = {};
+char gTextureStreamingText[128] = {};
+char gAssetPackText[128] = {};
+char gMemoryText[128] = {};
+
+// Interned at Init, so that the scopes opened every frame do not look the names up.
+MemoryOwner gSwapChainMemory = 0;
+MemoryOwner gResourceLoaderMemory = 0;
+MemoryOwner gCachesMemory = 0;
+MemoryOwner gDynamicResolutionMemory = 0;
+MemoryOwner gOverlayMemory = 0;
+std::array<MemoryOwner, Scenes::Count> gSceneMemory = {};
+
+UIComponent *pMemoryWindow{nullptr};
+char gMemoryOwnerTexts[MaxMemoryOwners][128] = {};
+uint32_t gMemoryOwnerTextCount = 0;
+
+// Forge's defaults, spelled out so that the staging buffers can be accounted for.
+ResourceLoaderDesc gResourceLoaderDesc = {8ull << 20, 2};
+char gStartupText[64] = "Starting up";
+
+bool bDynamicResolution = false;
+float gTargetFrameMs = 16.6f;
+
+uint32_t gTextureBudgetMb = 64;
+
+uint32_t gQualityLevel = 0;
+uint32_t gQualityValues[(uint32_t)QualityLevel::Count] = {};
+
+float gOverlayRefreshHz = 4.0f;
+bool bRedrawOverlay = true;
+char gRenderScaleText[64] = {};
+float4 gResourceCacheColor{1.0f, 1.0f, 1.0f, 1.0f};
+
+bool bSkipIdleFrames = false;
+bool bDrawFrame = true;
+char gIdleFramesText[128] = {};
+
+char gInputText[128] = {};
+
 RENDERDOC_API_1_1_2 *rdoc_api = nullptr;
 
 bool bToggleVSync = false;
 bool bIsCapturing = false;
 bool bIsTakingScreenshot = false;
 
-Scene currentScene;
+AnyScene currentScene;
+uint32_t gSceneIndex = 1;
+uint32_t gRequestedSceneIndex = 1;
+std::vector<const char *> gSceneNames;
+std::vector<uint32_t> gSceneValues;
+
+// Switching scenes: the next scene runs Prepare on a worker thread while the current scene keeps
+// rendering. Once that is done, Init and Load run on the main thread at the start of a frame, where
+// the renderer is not in use, and the scene is swapped in. The old scene is retired once every frame
+// that used it has finished.
+enum class PreloadState { Idle, Preparing, Ready };
+
+AnyScene nextScene;
+uint32_t gNextSceneIndex = 0;
+std::atomic<PreloadState> gPreloadState{PreloadState::Idle};
+std::thread gPreloadThread;
+
+AnyScene retiringScene;
+// One bit per frame index whose fence has not been waited on since the switch.
+uint32_t gRetireFrameMask = 0;
 
 } // namespace
 
 auto AppInstance() -> IApp * { return pAppInstance; }
+auto GpuProfileToken() -> ProfileToken { return gGpuProfileToken; }
 
 static auto AddSwapChain() -> bool {
     auto &&mSettings = AppInstance()->mSettings;
@@ -69,6 +151,11 @@ static auto AddSwapChain() -> bool {
     return pSwapChain != nullptr;
 }
 
+static void TrackSwapChain() {
+    MemoryScope memory(gSwapChainMemory);
+    TrackGpuAllocation(pSwapChain, TextureBytes(pSwapChain->ppRenderTargets[0]->pTexture) * pSwapChain->mImageCount);
+}
+
 static auto AddDepthBuffer() -> bool {
     auto &&mSettings = AppInstance()->mSettings;
     // Add depth buffer
@@ -83,84 +170,244 @@ static auto AddDepthBuffer() -> bool {
     depthRT.mSampleCount = SAMPLE_COUNT_1;
     depthRT.mSampleQuality = 0;
     depthRT.mWidth = mSettings.mWidth;
-    depthRT.mFlags = TEXTURE_CREATION_FLAG_ON_TILE;
-    addRenderTarget(pRenderer, &depthRT, &pDepthBuffer);
+    depthRT.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    AddTrackedRenderTarget(pRenderer, &depthRT, &pDepthBuffer);
 
     return pDepthBuffer != nullptr;
 }
 
+// Runs wherever input is sampled, the camera is only moved when the events are drained.
+static bool OnCameraInput(InputActionContext *ctx, InputBindings::Binding binding) {
+    if (uiIsFocused() || !(*ctx->pCaptured)) {
+        return true;
+    }
+
+    PushInputEvent(binding, binding == InputBindings::BUTTON_NORTH ? float2{0.0f, 0.0f} : ctx->mFloat2);
+    return true;
+};
+
+// Applies the camera input queued since the last tick to the current scene's camera, in one batch.
+static void ProcessInputEvents() {
+    InputEvent events[InputQueueCapacity];
+    const uint32_t count = DrainInputEvents(events, InputQueueCapacity);
+
+    ICameraController *pCameraController = currentScene.Camera();
+    if (pCameraController == nullptr) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        switch (events[i].mBinding) {
+        case InputBindings::FLOAT_LEFTSTICK:
+            pCameraController->onMove(events[i].mValue);
+            break;
+
+        case InputBindings::FLOAT_RIGHTSTICK:
+            pCameraController->onRotate(events[i].mValue);
+            break;
+
+        case InputBindings::BUTTON_NORTH:
+            pCameraController->resetView();
+        }
+    }
+}
+
+static void StartScenePreload(uint32_t index) {
+    nextScene.Create(index);
+    gNextSceneIndex = index;
+    gPreloadState = PreloadState::Preparing;
+
+    gPreloadThread = std::thread([index] {
+        MemoryScope memory(gSceneMemory[index]);
+        nextScene.Prepare();
+
+        gPreloadState = PreloadState::Ready;
+    });
+}
+
+static void RetireScene() {
+    retiringScene.Unload(pRenderer);
+    retiringScene.Exit(pRenderer);
+    retiringScene.Reset();
+    gRetireFrameMask = 0;
+}
+
+// Called at the start of a frame, nothing of the current frame has been recorded yet.
+static void UpdateSceneSwitch() {
+    if (gPreloadState == PreloadState::Ready && retiringScene.Empty()) {
+        if (gPreloadThread.joinable()) {
+            gPreloadThread.join();
+        }
+        {
+            MemoryScope memory(gSceneMemory[gNextSceneIndex]);
+            nextScene.Init(pRenderer);
+            nextScene.Load(pRenderer, pSwapChain, pDepthBuffer);
+            waitForAllResourceLoads();
+        }
+
+        currentScene.Deactivate();
+
+        retiringScene = std::move(currentScene);
+        gRetireFrameMask = (1u << ImageCount) - 1;
+
+        currentScene = std::move(nextScene);
+        nextScene.Reset();
+        gSceneIndex = gNextSceneIndex;
+        gPreloadState = PreloadState::Idle;
+
+        currentScene.Activate();
+        InvalidateDebugOverlay();
+    }
+
+    // One switch at a time, the retiring scene has to be gone before the next one is created.
+    if (gPreloadState == PreloadState::Idle && retiringScene.Empty() && gRequestedSceneIndex != gSceneIndex) {
+        StartScenePreload(gRequestedSceneIndex);
+    }
+}
+
 auto Init(IApp *app) -> bool {
+    BeginStartupTimeline();
+
     ::pAppInstance = app;
     auto &&mSettings = AppInstance()->mSettings;
     auto &&pWindow = AppInstance()->pWindow;
 
-    // currentScene = NopScene::Create();
-    currentScene = Ch2Lighings::Scene02BasicLighting::Create();
+    currentScene.Create(gSceneIndex);
+
+    gSwapChainMemory = InternMemoryOwner("Swap Chain");
+    gResourceLoaderMemory = InternMemoryOwner("Resource Loader");
+    gCachesMemory = InternMemoryOwner("Caches");
+    gDynamicResolutionMemory = InternMemoryOwner("Dynamic Resolution");
+    gOverlayMemory = InternMemoryOwner("Debug Overlay");
+    for (uint32_t i = 0; i < Scenes::Count; ++i) {
+        gSceneMemory[i] = InternMemoryOwner(Scenes::Names[i]);
+    }
 
     gSelectedRendererApi = RENDERER_API_D3D11;
 
     // FILE PATHS
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_SHADER_SOURCES, "Shaders");
+    // Shader binaries are written back and compared by time stamp with their sources, so they stay loose.
+    MountAssetPack("Assets.pack");
+    SetPackedResourceDir(RM_CONTENT, RD_SHADER_SOURCES, "Shaders");
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_SHADER_BINARIES, "CompiledShaders");
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_GPU_CONFIG, "GPUCfg");
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_TEXTURES, "Textures");
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_MESHES, "Meshes");
-    fsSetPathForResourceDir(pSystemFileIO, RM_CONTENT, RD_FONTS, "Fonts");
+    SetPackedResourceDir(RM_CONTENT, RD_GPU_CONFIG, "GPUCfg");
+    SetPackedResourceDir(RM_CONTENT, RD_TEXTURES, "Textures");
+    SetPackedResourceDir(RM_CONTENT, RD_MESHES, "Meshes");
+    SetPackedResourceDir(RM_CONTENT, RD_FONTS, "Fonts");
     fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_SCREENSHOTS, "Screenshots");
+    // Written by the pipeline state cache, the startup timeline and the memory report.
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_PIPELINE_CACHE, "PipelineCaches");
+    fsSetPathForResourceDir(pSystemFileIO, RM_DEBUG, RD_LOG, "Logs");
 
     // window and renderer setup
-    RendererDesc settings = {};
-    initRenderer(AppInstance()->GetName(), &settings, &pRenderer);
-    // check for init success
-    if (pRenderer == nullptr) {
-        return false;
+    {
+        StartupStage stage("Renderer");
+        RendererDesc settings = {};
+        initRenderer(AppInstance()->GetName(), &settings, &pRenderer);
+        // check for init success
+        if (pRenderer == nullptr) {
+            return false;
+        }
     }
 
-    QueueDesc queueDesc = {};
-    queueDesc.mType = QUEUE_TYPE_GRAPHICS;
-    queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
-    addQueue(pRenderer, &queueDesc, &pGraphicsQueue);
-
-    for (uint32_t i = 0; i < ImageCount; ++i) {
-        CmdPoolDesc cmdPoolDesc = {};
-        cmdPoolDesc.pQueue = pGraphicsQueue;
-        addCmdPool(pRenderer, &cmdPoolDesc, &pCmdPools[i]);
-        CmdDesc cmdDesc = {};
-        cmdDesc.pPool = pCmdPools[i];
-        addCmd(pRenderer, &cmdDesc, &pCmds[i]);
+    {
+        // Before any resource is created, the scenes size themselves from the preset.
+        StartupStage stage("Quality Preset");
+        InitQualityPresets(pRenderer);
+        gQualityLevel = (uint32_t)ActiveQualityLevel();
+        bDynamicResolution = ActiveQualityPreset().mDynamicResolution;
+    }
 
-        addFence(pRenderer, &pRenderCompleteFences[i]);
-        addSemaphore(pRenderer, &pRenderCompleteSemaphores[i]);
+    {
+        StartupStage stage("Queue and Command Buffers");
+        QueueDesc queueDesc = {};
+        queueDesc.mType = QUEUE_TYPE_GRAPHICS;
+        queueDesc.mFlag = QUEUE_FLAG_INIT_MICROPROFILE;
+        addQueue(pRenderer, &queueDesc, &pGraphicsQueue);
+
+        for (uint32_t i = 0; i < ImageCount; ++i) {
+            CmdPoolDesc cmdPoolDesc = {};
+            cmdPoolDesc.pQueue = pGraphicsQueue;
+            addCmdPool(pRenderer, &cmdPoolDesc, &pCmdPools[i]);
+            CmdDesc cmdDesc = {};
+            cmdDesc.pPool = pCmdPools[i];
+            addCmd(pRenderer, &cmdDesc, &pCmds[i]);
+
+            addFence(pRenderer, &pRenderCompleteFences[i]);
+            addSemaphore(pRenderer, &pRenderCompleteSemaphores[i]);
+        }
+        addSemaphore(pRenderer, &pImageAcquiredSemaphore);
     }
-    addSemaphore(pRenderer, &pImageAcquiredSemaphore);
 
-    initResourceLoaderInterface(pRenderer);
-    initScreenshotInterface(pRenderer, pGraphicsQueue);
+    {
+        StartupStage stage("Resource Loader");
+        {
+            MemoryScope memory(gResourceLoaderMemory);
+            initResourceLoaderInterface(pRenderer, &gResourceLoaderDesc);
+            TrackGpuAllocation(&gResourceLoaderDesc, gResourceLoaderDesc.mBufferSize * gResourceLoaderDesc.mBufferCount);
+        }
+
+        MemoryScope memory(gCachesMemory);
+        InitDescriptorCache(pRenderer);
+        InitResourceCache(pRenderer);
+        InitPipelineStateCache(pRenderer);
+        InitUploadBatcher(pRenderer);
+        InitTextureStreamer(pRenderer, (uint64_t)gTextureBudgetMb << 20);
+        InitDynamicResolution(pRenderer);
+        InitDebugOverlay(pRenderer);
+        InitRenderGraph(pRenderer);
+        initScreenshotInterface(pRenderer, pGraphicsQueue);
+    }
 
-    // Load fonts
-    FontDesc font{};
-    font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
-    fntDefineFonts(&font, 1, &gFontID);
+    // The scene reads its files ahead while the fonts, UI and profiler are brought up here. Its Init
+    // creates GPU objects, it runs on this thread once they are up, see Scene::Prepare.
+    std::thread scenePrepareThread([] {
+        StartupStage stage("Scene Prepare");
+        MemoryScope memory(gSceneMemory[gSceneIndex]);
+        currentScene.Prepare();
+    });
 
-    FontSystemDesc fontRenderDesc{};
-    fontRenderDesc.pRenderer = pRenderer;
-    if (!initFontSystem(&fontRenderDesc))
+    bool fontSystemReady = false;
+    {
+        StartupStage stage("Font System");
+        // Load fonts
+        FontDesc font{};
+        font.pFontPath = "TitilliumText/TitilliumText-Bold.otf";
+        fntDefineFonts(&font, 1, &gFontID);
+
+        FontSystemDesc fontRenderDesc{};
+        fontRenderDesc.pRenderer = pRenderer;
+        fontSystemReady = initFontSystem(&fontRenderDesc);
+    }
+    if (!fontSystemReady) {
+        scenePrepareThread.join();
         return false; // report?
+    }
 
-    // Initialize Forge User Interface Rendering
-    UserInterfaceDesc uiRenderDesc{};
-    uiRenderDesc.pRenderer = pRenderer;
-    initUserInterface(&uiRenderDesc);
+    {
+        StartupStage stage("User Interface");
+        // Initialize Forge User Interface Rendering
+        UserInterfaceDesc uiRenderDesc{};
+        uiRenderDesc.pRenderer = pRenderer;
+        initUserInterface(&uiRenderDesc);
+    }
 
-    // Initialize micro profiler and its UI.
-    ProfilerDesc profiler{};
-    profiler.pRenderer = pRenderer;
-    profiler.mWidthUI = mSettings.mWidth;
-    profiler.mHeightUI = mSettings.mHeight;
-    initProfiler(&profiler);
+    {
+        StartupStage stage("Profiler");
+        // Initialize micro profiler and its UI.
+        ProfilerDesc profiler{};
+        profiler.pRenderer = pRenderer;
+        profiler.mWidthUI = mSettings.mWidth;
+        profiler.mHeightUI = mSettings.mHeight;
+        initProfiler(&profiler);
+
+        // Gpu profiler can only be added after initProfile.
+        gGpuProfileToken = addGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+    }
 
-    // Gpu profiler can only be added after initProfile.
-    gGpuProfileToken = addGpuProfiler(pRenderer, pGraphicsQueue, "Graphics");
+    // Ended before waiting on the scene, the wait is not part of the stage.
+    std::optional<StartupStage> guiStage;
+    guiStage.emplace("GUI and Input");
 
     /************************************************************************/
     // GUI
@@ -188,10 +435,150 @@ auto Init(IApp *app) -> bool {
     UIWidget *pScreenshot = uiCreateComponentWidget(pGuiWindow, "Screenshot", &screenshot, WIDGET_TYPE_BUTTON);
     uiSetWidgetOnEditedCallback(pScreenshot, [] { bIsTakingScreenshot = true; });
 
+    ButtonWidget dumpRenderGraph;
+    UIWidget *pDumpRenderGraph =
+        uiCreateComponentWidget(pGuiWindow, "Dump Render Graph", &dumpRenderGraph, WIDGET_TYPE_BUTTON);
+    uiSetWidgetOnEditedCallback(pDumpRenderGraph, [] { RequestRenderGraphDump(); });
+
+    // Blocks the frame for several seconds, the timings go to the log.
+    ButtonWidget bvhBenchmark;
+    UIWidget *pBvhBenchmark = uiCreateComponentWidget(pGuiWindow, "Benchmark BVH", &bvhBenchmark, WIDGET_TYPE_BUTTON);
+    uiSetWidgetOnEditedCallback(pBvhBenchmark, [] { RunBvhBenchmarks(); });
+
+    DynamicTextWidget resourceCache;
+    resourceCache.pText = gResourceCacheText;
+    resourceCache.mLength = sizeof(gResourceCacheText);
+    resourceCache.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Resource Cache", &resourceCache, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget pipelineCache;
+    pipelineCache.pText = gPipelineCacheText;
+    pipelineCache.mLength = sizeof(gPipelineCacheText);
+    pipelineCache.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Pipeline Cache", &pipelineCache, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget uploads;
+    uploads.pText = gUploadText;
+    uploads.mLength = sizeof(gUploadText);
+    uploads.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Uploads", &uploads, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    SliderUintWidget textureBudget;
+    textureBudget.pData = &gTextureBudgetMb;
+    textureBudget.mMin = 1;
+    textureBudget.mMax = 1024;
+    textureBudget.mStep = 1;
+    UIWidget *pTextureBudget =
+        uiCreateComponentWidget(pGuiWindow, "Texture Budget (MB)", &textureBudget, WIDGET_TYPE_SLIDER_UINT);
+    uiSetWidgetOnEditedCallback(pTextureBudget, [] { SetTextureStreamingBudget((uint64_t)gTextureBudgetMb << 20); });
+
+    DynamicTextWidget textureStreaming;
+    textureStreaming.pText = gTextureStreamingText;
+    textureStreaming.mLength = sizeof(gTextureStreamingText);
+    textureStreaming.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Texture Streaming", &textureStreaming, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget assetPack;
+    assetPack.pText = gAssetPackText;
+    assetPack.mLength = sizeof(gAssetPackText);
+    assetPack.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Asset Pack", &assetPack, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget memory;
+    memory.pText = gMemoryText;
+    memory.mLength = sizeof(gMemoryText);
+    memory.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Memory", &memory, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    ButtonWidget memoryReport;
+    UIWidget *pMemoryReport =
+        uiCreateComponentWidget(pGuiWindow, "Write Memory Report", &memoryReport, WIDGET_TYPE_BUTTON);
+    uiSetWidgetOnEditedCallback(pMemoryReport, [] { WriteMemoryReport(); });
+
+    // One line per owner, added by Update as owners show up.
+    UIComponentDesc memoryDesc{};
+    memoryDesc.mStartPosition = vec2(mSettings.mWidth * 0.7f, mSettings.mHeight * 0.2f);
+    uiCreateComponent("Memory", &memoryDesc, &pMemoryWindow);
+
+    DynamicTextWidget startup;
+    startup.pText = gStartupText;
+    startup.mLength = sizeof(gStartupText);
+    startup.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Startup", &startup, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    CheckboxWidget dynamicResolution;
+    dynamicResolution.pData = &bDynamicResolution;
+    uiCreateComponentWidget(pGuiWindow, "Dynamic Resolution", &dynamicResolution, WIDGET_TYPE_CHECKBOX);
+
+    SliderFloatWidget targetFrameMs;
+    targetFrameMs.pData = &gTargetFrameMs;
+    targetFrameMs.mMin = 4.0f;
+    targetFrameMs.mMax = 33.3f;
+    targetFrameMs.mStep = 0.1f;
+    uiCreateComponentWidget(pGuiWindow, "Target GPU Time (ms)", &targetFrameMs, WIDGET_TYPE_SLIDER_FLOAT);
+
+    DynamicTextWidget renderScale;
+    renderScale.pText = gRenderScaleText;
+    renderScale.mLength = sizeof(gRenderScaleText);
+    renderScale.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Render Scale", &renderScale, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    for (uint32_t i = 0; i < (uint32_t)QualityLevel::Count; ++i) {
+        gQualityValues[i] = i;
+    }
+
+    // Scene sizes follow on the next scene load.
+    DropdownWidget quality;
+    quality.pData = &gQualityLevel;
+    quality.pNames = QualityLevelNames();
+    quality.pValues = gQualityValues;
+    quality.mCount = (uint32_t)QualityLevel::Count;
+    UIWidget *pQuality = uiCreateComponentWidget(pGuiWindow, "Quality", &quality, WIDGET_TYPE_DROPDOWN);
+    uiSetWidgetOnEditedCallback(pQuality, [] {
+        SetQualityLevel((QualityLevel)gQualityLevel);
+        bDynamicResolution = ActiveQualityPreset().mDynamicResolution;
+    });
+
+    CheckboxWidget skipIdleFrames;
+    skipIdleFrames.pData = &bSkipIdleFrames;
+    uiCreateComponentWidget(pGuiWindow, "Skip Idle Frames", &skipIdleFrames, WIDGET_TYPE_CHECKBOX);
+
+    DynamicTextWidget idleFrames;
+    idleFrames.pText = gIdleFramesText;
+    idleFrames.mLength = sizeof(gIdleFramesText);
+    idleFrames.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Idle Frames", &idleFrames, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    DynamicTextWidget input;
+    input.pText = gInputText;
+    input.mLength = sizeof(gInputText);
+    input.pColor = &gResourceCacheColor;
+    uiCreateComponentWidget(pGuiWindow, "Input", &input, WIDGET_TYPE_DYNAMIC_TEXT);
+
+    SliderFloatWidget overlayRefresh;
+    overlayRefresh.pData = &gOverlayRefreshHz;
+    overlayRefresh.mMin = 1.0f;
+    overlayRefresh.mMax = 60.0f;
+    overlayRefresh.mStep = 1.0f;
+    uiCreateComponentWidget(pGuiWindow, "Overlay Refresh (Hz)", &overlayRefresh, WIDGET_TYPE_SLIDER_FLOAT);
+
+    for (uint32_t i = 0; i < Scenes::Count; ++i) {
+        gSceneNames.push_back(Scenes::Names[i]);
+        gSceneValues.push_back(i);
+    }
+
+    DropdownWidget sceneSelector;
+    sceneSelector.pData = &gRequestedSceneIndex;
+    sceneSelector.pNames = gSceneNames.data();
+    sceneSelector.pValues = gSceneValues.data();
+    sceneSelector.mCount = Scenes::Count;
+    uiCreateComponentWidget(pGuiWindow, "Scene", &sceneSelector, WIDGET_TYPE_DROPDOWN);
+
     InputSystemDesc inputDesc{};
     inputDesc.pRenderer = pRenderer;
     inputDesc.pWindow = pWindow;
     if (!initInputSystem(&inputDesc)) {
+        scenePrepareThread.join();
         return false;
     }
 
@@ -218,9 +605,37 @@ auto Init(IApp *app) -> bool {
                                    }};
         addInputAction(&actionDesc);
     }
+    {
+        InputActionDesc actionDesc = {
+            InputBindings::FLOAT_RIGHTSTICK,
+            [](InputActionContext *ctx) { return OnCameraInput(ctx, InputBindings::FLOAT_RIGHTSTICK); },
+            NULL,
+            2.0f,
+            20.0f,
+            0.05f};
+        addInputAction(&actionDesc);
+    }
+    {
+        InputActionDesc actionDesc = {
+            InputBindings::FLOAT_LEFTSTICK,
+            [](InputActionContext *ctx) { return OnCameraInput(ctx, InputBindings::FLOAT_LEFTSTICK); },
+            NULL,
+            2.0f,
+            20.0f,
+            0.1f};
+        addInputAction(&actionDesc);
+    }
+    {
+        InputActionDesc actionDesc = {
+            InputBindings::BUTTON_NORTH,
+            [](InputActionContext *ctx) { return OnCameraInput(ctx, InputBindings::BUTTON_NORTH); },
+        };
+        addInputAction(&actionDesc);
+    }
     {
         InputActionDesc actionDesc{InputBindings::BUTTON_ANY, [](InputActionContext *ctx) {
                                        bool capture = uiOnButton(ctx->mBinding, ctx->mBool, ctx->pPosition);
+                                       InvalidateDebugOverlay();
                                        setEnableCaptureInput(capture && INPUT_ACTION_PHASE_CANCELED != ctx->mPhase);
                                        return true;
                                    }};
@@ -232,17 +647,35 @@ auto Init(IApp *app) -> bool {
         RENDERDOC_GetAPI(eRENDERDOC_API_Version_1_1_2, (void **)&rdoc_api);
     }
 
-    currentScene.Init(pRenderer);
+    guiStage.reset();
+    scenePrepareThread.join();
+    {
+        StartupStage stage("Scene Init");
+        MemoryScope memory(gSceneMemory[gSceneIndex]);
+        currentScene.Init(pRenderer);
+    }
+    currentScene.Activate();
 
     return true;
 }
 
 void Exit() {
+    // Export the steady state, before anything is torn down.
+    WriteMemoryReport();
+
+    currentScene.Deactivate();
+
     exitInputSystem();
+    uiDestroyComponent(pMemoryWindow);
     exitUserInterface();
     exitFontSystem();
     exitProfiler();
 
+    // Unload already finished any preload and retired the previous scene. A prepared scene has not
+    // been initialized, there is nothing to exit.
+    nextScene.Reset();
+    gPreloadState = PreloadState::Idle;
+
     currentScene.Exit(pRenderer);
 
     for (uint32_t i = 0; i < ImageCount; ++i) {
@@ -255,6 +688,15 @@ void Exit() {
 
     removeSemaphore(pRenderer, pImageAcquiredSemaphore);
 
+    ExitRenderGraph();
+    ExitDebugOverlay(pRenderer);
+    ExitDynamicResolution(pRenderer);
+    ExitTextureStreamer();
+    ExitUploadBatcher();
+    // Pipelines hold references on shaders and root signatures.
+    ExitPipelineStateCache();
+    ExitResourceCache();
+    ExitDescriptorCache();
     exitResourceLoaderInterface(pRenderer);
     exitScreenshotInterface();
 
@@ -262,45 +704,143 @@ void Exit() {
 
     exitRenderer(pRenderer);
     pRenderer = nullptr;
+
+    UnmountAssetPack();
 }
 
 auto Load() -> bool {
+    {
+        StartupStage stage("Swap Chain");
+        if (!AddSwapChain()) {
+            return false;
+        }
+        TrackSwapChain();
 
-    if (!AddSwapChain()) {
-        return false;
-    }
-
-    if (!AddDepthBuffer()) {
-        return false;
-    }
+        MemoryScope memory(gSwapChainMemory);
+        if (!AddDepthBuffer()) {
+            return false;
+        }
 
-    RenderTarget *ppPipelineRenderTargets[]{pSwapChain->ppRenderTargets[0], pDepthBuffer};
-    if (!addFontSystemPipelines(ppPipelineRenderTargets, 2, nullptr))
-        return false;
+        MemoryScope dynamicResolutionMemory(gDynamicResolutionMemory);
+        if (!LoadDynamicResolution(pRenderer, pSwapChain)) {
+            return false;
+        }
 
-    if (!addUserInterfacePipelines(ppPipelineRenderTargets[0])) {
-        return false;
+        MemoryScope overlayMemory(gOverlayMemory);
+        if (!LoadDebugOverlay(pRenderer, pSwapChain)) {
+            return false;
+        }
     }
 
-    waitForAllResourceLoads();
+    // Pipelines are created one after the other, the D3D11 context is not thread safe.
+    {
+        StartupStage stage("Scene Load");
+        MemoryScope memory(gSceneMemory[gSceneIndex]);
+        currentScene.Load(pRenderer, pSwapChain, pDepthBuffer);
+    }
 
-    currentScene.Load(pRenderer, pSwapChain, pDepthBuffer);
+    {
+        StartupStage stage("Font and UI Pipelines");
+        // Only ever drawn into the overlay, which has no depth attachment.
+        RenderTarget *pOverlayTarget = DebugOverlayTarget();
+        if (!addFontSystemPipelines(&pOverlayTarget, 1, PipelineStateDriverCache()) ||
+            !addUserInterfacePipelines(pOverlayTarget)) {
+            return false;
+        }
+    }
 
+    StartupStage stage("Resource Uploads");
     waitForAllResourceLoads();
 
+    // The swap chain is new, nothing has been presented to it.
+    RequestRedraw();
     return true;
 }
 void Unload() {
 
     waitQueueIdle(pGraphicsQueue);
 
+    // A running preload only reads files, it is let finish so that the scene is either swapped in
+    // after the next Load or dropped by Exit.
+    if (gPreloadThread.joinable()) {
+        gPreloadThread.join();
+    }
+    if (!retiringScene.Empty()) {
+        RetireScene();
+    }
+
     currentScene.Unload(pRenderer);
 
     removeUserInterfacePipelines();
     removeFontSystemPipelines();
 
+    ReleaseRenderGraphTargets();
+    UnloadDebugOverlay(pRenderer);
+    UnloadDynamicResolution(pRenderer);
+    UntrackAllocation(pSwapChain);
     removeSwapChain(pRenderer, pSwapChain);
-    removeRenderTarget(pRenderer, pDepthBuffer);
+    RemoveTrackedRenderTarget(pRenderer, pDepthBuffer);
+}
+
+static void UpdateOverlayText() {
+    const RGTargetDesc sceneColor = DynamicResolutionTargetDesc();
+    snprintf(gRenderScaleText, sizeof(gRenderScaleText), "%.0f%%, %ux%u", DynamicResolutionScale() * 100.0f,
+             (uint32_t)(sceneColor.mWidth * DynamicResolutionScale()),
+             (uint32_t)(sceneColor.mHeight * DynamicResolutionScale()));
+
+    ResourceCacheStats cacheStats = GetResourceCacheStats();
+    snprintf(gResourceCacheText, sizeof(gResourceCacheText), "%u assets (%u unused), %.2f MB, %.2f MB uploaded",
+             cacheStats.mAssetCount, cacheStats.mUnreferencedCount, cacheStats.mBytes / (1024.0f * 1024.0f),
+             cacheStats.mUploadedBytes / (1024.0f * 1024.0f));
+
+    PipelineStateCacheStats pipelineStats = GetPipelineStateCacheStats();
+    snprintf(gPipelineCacheText, sizeof(gPipelineCacheText), "%u pipelines (%u prewarmed), %u hits, %u misses",
+             pipelineStats.mPipelineCount, pipelineStats.mPrewarmed, pipelineStats.mHits, pipelineStats.mMisses);
+
+    const UploadStats uploadStats = GetUploadStats();
+    snprintf(gUploadText, sizeof(gUploadText), "%u writes in %u copies, %.1f KB", uploadStats.mWrites,
+             uploadStats.mCopies, uploadStats.mBytes / 1024.0f);
+
+    const TextureStreamingStats streamingStats = GetTextureStreamingStats();
+    snprintf(gTextureStreamingText, sizeof(gTextureStreamingText),
+             "%u textures, %.2f of %.2f MB, %u loading, %u evicted, %.2f MB read", streamingStats.mTextureCount,
+             streamingStats.mResidentBytes / (1024.0f * 1024.0f), streamingStats.mBudgetBytes / (1024.0f * 1024.0f),
+             streamingStats.mPendingLoads, streamingStats.mEvictions, streamingStats.mStreamedBytes / (1024.0f * 1024.0f));
+
+    const AssetPackStats packStats = GetAssetPackStats();
+    snprintf(gAssetPackText, sizeof(gAssetPackText), "%u files, %.2f MB mapped, %u opens (%u from disk), %.2f MB inflated",
+             packStats.mEntryCount, packStats.mMappedBytes / (1024.0f * 1024.0f), packStats.mPackedOpens + packStats.mDiskOpens,
+             packStats.mDiskOpens, packStats.mDecompressedBytes / (1024.0f * 1024.0f));
+
+    const IdleFrameStats idleStats = GetIdleFrameStats();
+    snprintf(gIdleFramesText, sizeof(gIdleFramesText), "%.0f%% skipped, CPU %.0f%% (%.0f%% saved), GPU %.0f%% (%.0f%% saved)",
+             idleStats.mSkippedFraction * 100.0f, idleStats.mCpuUtilization * 100.0f, idleStats.mCpuSaved * 100.0f,
+             idleStats.mGpuUtilization * 100.0f, idleStats.mGpuSaved * 100.0f);
+
+    const InputQueueStats inputStats = GetInputQueueStats();
+    snprintf(gInputText, sizeof(gInputText), "%u events in %u batches, latency %.2f ms (max %.2f ms), %u dropped",
+             inputStats.mEvents, inputStats.mBatches, inputStats.mAverageLatencyMs, inputStats.mMaxLatencyMs,
+             inputStats.mDropped);
+
+    const MemoryStats memoryStats = GetMemoryStats();
+    snprintf(gMemoryText, sizeof(gMemoryText), "GPU %.2f MB, heap %.2f MB, process %.2f MB, %.1f KB uploaded",
+             memoryStats.mGpuBytes / (1024.0f * 1024.0f), memoryStats.mCpuBytes / (1024.0f * 1024.0f),
+             memoryStats.mProcessBytes / (1024.0f * 1024.0f), memoryStats.mUploadedBytesLastFrame / 1024.0f);
+
+    for (uint32_t i = 0; i < memoryStats.mOwnerCount; ++i) {
+        const MemoryOwnerStats owner = GetMemoryOwnerStats(i);
+        if (i == gMemoryOwnerTextCount) {
+            DynamicTextWidget ownerText;
+            ownerText.pText = gMemoryOwnerTexts[i];
+            ownerText.mLength = sizeof(gMemoryOwnerTexts[i]);
+            ownerText.pColor = &gResourceCacheColor;
+            uiCreateComponentWidget(pMemoryWindow, owner.pOwner, &ownerText, WIDGET_TYPE_DYNAMIC_TEXT);
+            gMemoryOwnerTextCount++;
+        }
+        snprintf(gMemoryOwnerTexts[i], sizeof(gMemoryOwnerTexts[i]), "GPU %.2f MB, heap %.2f MB, %lld descriptors",
+                 owner.mGpuBytes / (1024.0f * 1024.0f), owner.mCpuBytes / (1024.0f * 1024.0f),
+                 (long long)owner.mDescriptorSlots);
+    }
 }
 
 void Update(float deltaTime) {
@@ -310,16 +850,57 @@ void Update(float deltaTime) {
     if (pSwapChain->mEnableVsync != static_cast<int>(bToggleVSync)) {
         waitQueueIdle(pGraphicsQueue);
         gFrameIndex = 0;
+        UntrackAllocation(pSwapChain);
         ::toggleVSync(pRenderer, &pSwapChain);
+        TrackSwapChain();
+        RequestRedraw();
     }
 #endif
 
     updateInputSystem(mSettings.mWidth, mSettings.mHeight);
 
-    currentScene.Update(deltaTime);
+    UpdateSceneSwitch();
+    // After the switch, the input goes to the camera of the scene updated below.
+    ProcessInputEvents();
+    // Calibrate at full resolution, a scaled render would hide the headroom being measured.
+    if (UpdateQualityCalibration(getGpuProfileTime(gGpuProfileToken), deltaTime * 1000.0f, gTargetFrameMs)) {
+        gQualityLevel = (uint32_t)ActiveQualityLevel();
+        bDynamicResolution = ActiveQualityPreset().mDynamicResolution;
+        InvalidateDebugOverlay();
+    }
+    bool changed = false;
+    {
+        MemoryScope memory(gSceneMemory[gSceneIndex]);
+        changed = currentScene.Update(deltaTime);
+    }
+
+    // The text is only seen when the overlay is redrawn.
+    bRedrawOverlay = UpdateDebugOverlay(deltaTime, gOverlayRefreshHz);
+    if (bRedrawOverlay) {
+        UpdateOverlayText();
+    }
+
+    // Work that only progresses on drawn frames counts as a change: retiring the previous scene
+    // waits on the frame fences, streamed textures are swapped in while drawing and calibration
+    // measures GPU times.
+    changed = changed || !retiringScene.Empty() || GetTextureStreamingStats().mPendingLoads > 0 ||
+              IsCalibratingQuality() || bIsTakingScreenshot || bIsCapturing;
+    // The overlay refreshes a few times per second even when idle, each refresh only draws once.
+    bDrawFrame = UpdateIdleFrames(bSkipIdleFrames, changed, bRedrawOverlay);
+
+    // The GPU time it reads is only measured on drawn frames.
+    if (bDrawFrame) {
+        UpdateDynamicResolution(bDynamicResolution && !IsCalibratingQuality(), gTargetFrameMs);
+    }
 }
 
 void Draw() {
+    // The last presented image stays on screen.
+    if (!bDrawFrame) {
+        EndIdleFrame();
+        return;
+    }
+
     if (bIsCapturing) {
         rdoc_api->StartFrameCapture(nullptr, nullptr);
     }
@@ -337,6 +918,16 @@ void Draw() {
         waitForFences(pRenderer, 1, &pRenderCompleteFence);
     }
 
+    gRetireFrameMask &= ~(1u << gFrameIndex);
+    if (gRetireFrameMask == 0 && !retiringScene.Empty()) {
+        RetireScene();
+    }
+
+    // The staging memory of this frame is free again.
+    BeginUploadFrame(gFrameIndex);
+    // Before the scene reports this frame's texture sizes, which are acted on next frame.
+    UpdateTextureStreaming();
+
     // Reset cmd pool for this frame
     resetCmdPool(pRenderer, pCmdPools[gFrameIndex]);
 
@@ -345,49 +936,57 @@ void Draw() {
 
     cmdBeginGpuFrameProfile(cmd, gGpuProfileToken);
 
-    RenderTargetBarrier barriers[] = {
-        {pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_RENDER_TARGET},
-    };
-    cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, 1, barriers);
-
-    // simply record the screen cleaning command
-    LoadActionsDesc loadActions = {};
-    loadActions.mLoadActionsColor[0] = LOAD_ACTION_CLEAR;
-    loadActions.mLoadActionDepth = LOAD_ACTION_CLEAR;
-    loadActions.mClearDepth.depth = 0.0F;
-    loadActions.mClearDepth.stencil = 0;
-    cmdBindRenderTargets(cmd, 1, &pRenderTarget, pDepthBuffer, &loadActions, nullptr, nullptr, -1, -1);
-    cmdSetViewport(cmd, 0.0F, 0.0F, (float)pRenderTarget->mWidth, (float)pRenderTarget->mHeight, 0.0F, 1.0F);
-    cmdSetScissor(cmd, 0, 0, pRenderTarget->mWidth, pRenderTarget->mHeight);
-
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw Scene");
-    { currentScene.Draw(cmd, gFrameIndex); }
-    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
-
-    loadActions = {};
-    loadActions.mLoadActionsColor[0] = LOAD_ACTION_LOAD;
-
-    cmdBindRenderTargets(cmd, 1, &pRenderTarget, nullptr, &loadActions, nullptr, nullptr, -1, -1);
-    cmdBeginGpuTimestampQuery(cmd, gGpuProfileToken, "Draw UI");
-    {
-        gFrameTimeDraw.mFontColor = 0xff00ffff;
-        gFrameTimeDraw.mFontSize = 18.0f;
-        gFrameTimeDraw.mFontID = gFontID;
-
-        const float txtIndent = 8.F;
-        float2 txtSizePx = cmdDrawCpuProfile(cmd, float2(txtIndent, 15.F), &gFrameTimeDraw);
-        cmdDrawGpuProfile(cmd, float2(txtIndent, txtSizePx.y + 30.F), gGpuProfileToken, &gFrameTimeDraw);
-
-        cmdDrawGpuProfile(cmd, float2(8.f, txtSizePx.y + 30.f), gGpuProfileToken, &gFrameTimeDraw);
-
-        cmdDrawUserInterface(cmd);
-
-        cmdBindRenderTargets(cmd, 0, nullptr, nullptr, nullptr, nullptr, nullptr, -1, -1);
+    BeginRenderGraph();
+
+    RGResource backBuffer =
+        ImportRenderTarget("Back Buffer", pRenderTarget, RESOURCE_STATE_PRESENT, RESOURCE_STATE_PRESENT);
+    RGResource depthBuffer =
+        ImportRenderTarget("Depth Buffer", pDepthBuffer, RESOURCE_STATE_DEPTH_WRITE, RESOURCE_STATE_DEPTH_WRITE);
+    // Only lives until the upscale, its memory is the graph's to alias.
+    RGResource sceneColor = CreateTransientTarget(DynamicResolutionTargetDesc());
+
+    // Executes after every pass is declared, the scene writes its uploads while declaring.
+    RGPass uploadPass = AddRenderGraphPass("Flush Uploads", [](Cmd *cmd) { CmdFlushUploads(cmd); });
+    PassSideEffect(uploadPass);
+
+    const bool depthWritten = currentScene.AddPasses(gFrameIndex, depthBuffer);
+
+    // The scene is drawn into the scaled part of the scene colour target, then upscaled.
+    RGPass scenePass = AddRenderGraphPass("Draw Scene", [sceneColor](Cmd *cmd) {
+        MemoryScope memory(gSceneMemory[gSceneIndex]);
+        CmdSetDynamicResolutionViewport(cmd, RenderGraphTarget(sceneColor));
+        currentScene.Draw(cmd, gFrameIndex);
+    });
+    PassColorAttachment(scenePass, sceneColor, LOAD_ACTION_CLEAR);
+    PassDepthAttachment(scenePass, depthBuffer, depthWritten ? LOAD_ACTION_LOAD : LOAD_ACTION_CLEAR);
+
+    RGPass upscalePass = AddRenderGraphPass(
+        "Upscale", [sceneColor](Cmd *cmd) { CmdUpscale(cmd, RenderGraphTarget(sceneColor), gFrameIndex); });
+    PassRead(upscalePass, sceneColor, RESOURCE_STATE_SHADER_RESOURCE);
+    PassColorAttachment(upscalePass, backBuffer, LOAD_ACTION_DONTCARE);
+
+    RGResource overlay = ImportRenderTarget("Debug Overlay", DebugOverlayTarget(), RESOURCE_STATE_SHADER_RESOURCE,
+                                            RESOURCE_STATE_SHADER_RESOURCE);
+    if (bRedrawOverlay) {
+        RGPass overlayPass = AddRenderGraphPass("Draw Overlay", [](Cmd *cmd) {
+            gFrameTimeDraw.mFontColor = 0xff00ffff;
+            gFrameTimeDraw.mFontSize = 18.0f;
+            gFrameTimeDraw.mFontID = gFontID;
+
+            const float txtIndent = 8.F;
+            float2 txtSizePx = cmdDrawCpuProfile(cmd, float2(txtIndent, 15.F), &gFrameTimeDraw);
+            cmdDrawGpuProfile(cmd, float2(txtIndent, txtSizePx.y + 30.F), gGpuProfileToken, &gFrameTimeDraw);
+
+            cmdDrawUserInterface(cmd);
+        });
+        PassColorAttachment(overlayPass, overlay, LOAD_ACTION_CLEAR);
     }
-    cmdEndGpuTimestampQuery(cmd, gGpuProfileToken);
 
-    barriers[0] = {pRenderTarget, RESOURCE_STATE_RENDER_TARGET, RESOURCE_STATE_PRESENT};
-    cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, 1, barriers);
+    RGPass compositePass = AddRenderGraphPass("Composite Overlay", [](Cmd *cmd) { CmdCompositeDebugOverlay(cmd); });
+    PassRead(compositePass, overlay, RESOURCE_STATE_SHADER_RESOURCE);
+    PassColorAttachment(compositePass, backBuffer, LOAD_ACTION_LOAD);
+
+    CmdExecuteRenderGraph(cmd);
 
     cmdEndGpuFrameProfile(cmd, gGpuProfileToken);
     endCmd(cmd);
@@ -401,6 +1000,7 @@ void Draw() {
     submitDesc.ppWaitSemaphores = &pImageAcquiredSemaphore;
     submitDesc.pSignalFence = pRenderCompleteFence;
     queueSubmit(pGraphicsQueue, &submitDesc);
+    EndMemoryFrame();
     QueuePresentDesc presentDesc = {};
     presentDesc.mIndex = swapchainImageIndex;
     presentDesc.mWaitSemaphoreCount = 1;
@@ -418,6 +1018,12 @@ void Draw() {
     }
 
     queuePresent(pGraphicsQueue, &presentDesc);
+
+    if (TimeToFirstFrameMs() == 0.0f) {
+        MarkFirstFrame();
+        snprintf(gStartupText, sizeof(gStartupText), "First frame after %.1f ms", TimeToFirstFrameMs());
+        InvalidateDebugOverlay();
+    }
     flipProfiler();
 
     gFrameIndex = (gFrameIndex + 1) % ImageCount;
@@ -425,4 +1031,6 @@ void Draw() {
         rdoc_api->EndFrameCapture(nullptr, nullptr);
         bIsCapturing = false;
     }
+
+    EndIdleFrame();
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Common_3/OS/Interfaces/IApp.h>
+#include <Common_3/OS/Interfaces/IProfiler.h>
 
 constexpr int ImageCount = 3;
 
@@ -13,4 +14,5 @@ void Unload();
 void Update(float deltaTime);
 void Draw();
 
-auto AppInstance() -> IApp *;
\ No newline at end of file
+auto AppInstance() -> IApp *;
+auto GpuProfileToken() -> ProfileToken;
\ No newline at end of file
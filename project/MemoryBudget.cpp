@@ -0,0 +1,318 @@
+#include "MemoryBudget.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+#include <Common_3/OS/Interfaces/ILog.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+struct OwnerRecord {
+    const char *pName;
+    std::atomic<int64_t> mGpuBytes;
+    std::atomic<int64_t> mCpuBytes;
+    std::atomic<int64_t> mDescriptorSlots;
+};
+
+// Constant initialised, the heap hooks below run before any dynamic initialiser.
+OwnerRecord gOwners[MaxMemoryOwners] = {{"Unscoped"}};
+std::atomic<uint32_t> gOwnerCount{1};
+thread_local uint32_t tCurrentOwner = 0;
+
+struct GpuAllocation {
+    uint32_t mOwner;
+    int64_t mBytes;
+    int64_t mDescriptorSlots;
+};
+
+std::mutex gBudgetMutex;
+std::unordered_map<const void *, GpuAllocation> gGpuAllocations;
+
+std::atomic<uint64_t> gFrameUploadBytes{0};
+uint64_t gUploadedBytesLastFrame = 0;
+uint64_t gUploadedBytesPeak = 0;
+
+// Prefixed to every heap block so that the free is charged to the owner of the allocation.
+struct alignas(16) HeapHeader {
+    uint64_t mBytes;
+    uint32_t mOwner;
+    // From the start of the malloc block to the header, only over-aligned blocks have padding.
+    uint32_t mOffset;
+};
+} // namespace
+
+// Header right before the returned memory, alignment is a power of two of at least the header's.
+static auto TrackedAlignedMalloc(size_t size, size_t alignment) -> void * {
+    const size_t padding = alignment > alignof(HeapHeader) ? alignment - alignof(HeapHeader) : 0;
+    uint8_t *pBlock = (uint8_t *)malloc(sizeof(HeapHeader) + padding + (size > 0 ? size : 1));
+    if (pBlock == nullptr) {
+        return nullptr;
+    }
+
+    const uintptr_t memory = ((uintptr_t)(pBlock + sizeof(HeapHeader)) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    HeapHeader *pHeader = (HeapHeader *)memory - 1;
+    pHeader->mBytes = size;
+    pHeader->mOwner = tCurrentOwner;
+    pHeader->mOffset = (uint32_t)((uint8_t *)pHeader - pBlock);
+    gOwners[pHeader->mOwner].mCpuBytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+    return pHeader + 1;
+}
+
+static auto TrackedMalloc(size_t size) -> void * { return TrackedAlignedMalloc(size, alignof(HeapHeader)); }
+
+static void TrackedFree(void *pMemory) {
+    if (pMemory == nullptr) {
+        return;
+    }
+
+    HeapHeader *pHeader = (HeapHeader *)pMemory - 1;
+    gOwners[pHeader->mOwner].mCpuBytes.fetch_sub((int64_t)pHeader->mBytes, std::memory_order_relaxed);
+    free((uint8_t *)pHeader - pHeader->mOffset);
+}
+
+void *operator new(size_t size) {
+    if (void *pMemory = TrackedMalloc(size)) {
+        return pMemory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return TrackedMalloc(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return TrackedMalloc(size); }
+void operator delete(void *pMemory) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory) noexcept { TrackedFree(pMemory); }
+void operator delete(void *pMemory, size_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory, size_t) noexcept { TrackedFree(pMemory); }
+void operator delete(void *pMemory, const std::nothrow_t &) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory, const std::nothrow_t &) noexcept { TrackedFree(pMemory); }
+
+// Types declared alignas above the default, e.g. SIMD math, come through these.
+void *operator new(size_t size, std::align_val_t alignment) {
+    if (void *pMemory = TrackedAlignedMalloc(size, (size_t)alignment)) {
+        return pMemory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return TrackedAlignedMalloc(size, (size_t)alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return TrackedAlignedMalloc(size, (size_t)alignment);
+}
+void operator delete(void *pMemory, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete(void *pMemory, size_t, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory, size_t, std::align_val_t) noexcept { TrackedFree(pMemory); }
+void operator delete(void *pMemory, std::align_val_t, const std::nothrow_t &) noexcept { TrackedFree(pMemory); }
+void operator delete[](void *pMemory, std::align_val_t, const std::nothrow_t &) noexcept { TrackedFree(pMemory); }
+
+auto InternMemoryOwner(const char *pName) -> MemoryOwner {
+    std::lock_guard<std::mutex> lock(gBudgetMutex);
+
+    const uint32_t count = gOwnerCount.load();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (strcmp(gOwners[i].pName, pName) == 0) {
+            return i;
+        }
+    }
+
+    if (count == MaxMemoryOwners) {
+        LOGF(LogLevel::eWARNING, "Too many memory owners, %s is charged to %s", pName, gOwners[0].pName);
+        return 0;
+    }
+
+    gOwners[count].pName = pName;
+    gOwnerCount.store(count + 1);
+    return count;
+}
+
+static auto ProcessPrivateBytes() -> uint64_t {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS_EX counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS *)&counters, sizeof(counters))) {
+        return counters.PrivateUsage;
+    }
+#endif
+    return 0;
+}
+
+static void Track(const void *pResource, int64_t bytes, int64_t descriptorSlots) {
+    if (pResource == nullptr) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gBudgetMutex);
+    gGpuAllocations[pResource] = {tCurrentOwner, bytes, descriptorSlots};
+    gOwners[tCurrentOwner].mGpuBytes += bytes;
+    gOwners[tCurrentOwner].mDescriptorSlots += descriptorSlots;
+}
+
+MemoryScope::MemoryScope(MemoryOwner owner) : mPreviousOwner(tCurrentOwner) { tCurrentOwner = owner; }
+
+MemoryScope::~MemoryScope() { tCurrentOwner = mPreviousOwner; }
+
+void TrackGpuAllocation(const void *pResource, uint64_t bytes) { Track(pResource, (int64_t)bytes, 0); }
+
+void TrackDescriptorSet(const DescriptorSet *pSet, uint32_t slotCount) { Track(pSet, 0, slotCount); }
+
+void UntrackAllocation(const void *pResource) {
+    std::lock_guard<std::mutex> lock(gBudgetMutex);
+
+    auto found = gGpuAllocations.find(pResource);
+    if (found == gGpuAllocations.end()) {
+        return;
+    }
+
+    OwnerRecord &owner = gOwners[found->second.mOwner];
+    owner.mGpuBytes -= found->second.mBytes;
+    owner.mDescriptorSlots -= found->second.mDescriptorSlots;
+    gGpuAllocations.erase(found);
+}
+
+auto TextureBytes(const Texture *pTexture) -> uint64_t {
+    const TinyImageFormat format = (TinyImageFormat)pTexture->mFormat;
+    const uint64_t blockBytes = TinyImageFormat_BitSizeOfBlock(format) / 8;
+    const uint32_t blockWidth = TinyImageFormat_WidthOfBlock(format);
+    const uint32_t blockHeight = TinyImageFormat_HeightOfBlock(format);
+
+    uint64_t bytes = 0;
+    for (uint32_t mip = 0; mip < pTexture->mMipLevels; ++mip) {
+        uint32_t width = (uint32_t)pTexture->mWidth >> mip;
+        uint32_t height = (uint32_t)pTexture->mHeight >> mip;
+        width = width > 0 ? width : 1;
+        height = height > 0 ? height : 1;
+        bytes += (uint64_t)((width + blockWidth - 1) / blockWidth) * ((height + blockHeight - 1) / blockHeight) *
+                 blockBytes * pTexture->mDepth;
+    }
+    return bytes * (pTexture->mArraySizeMinusOne + 1);
+}
+
+auto GeometryBytes(const Geometry *pGeometry) -> uint64_t {
+    uint64_t bytes = pGeometry->pIndexBuffer != nullptr ? pGeometry->pIndexBuffer->mSize : 0;
+    for (uint32_t i = 0; i < pGeometry->mVertexBufferCount; ++i) {
+        bytes += pGeometry->pVertexBuffers[i]->mSize;
+    }
+    return bytes;
+}
+
+void AddTrackedResource(BufferLoadDesc *pDesc, SyncToken *pToken) {
+    addResource(pDesc, pToken);
+    TrackGpuAllocation(*pDesc->ppBuffer, pDesc->mDesc.mSize);
+}
+
+void AddTrackedResource(TextureLoadDesc *pDesc, SyncToken *pToken) {
+    addResource(pDesc, pToken);
+    if (*pDesc->ppTexture != nullptr) {
+        TrackGpuAllocation(*pDesc->ppTexture, TextureBytes(*pDesc->ppTexture));
+    }
+}
+
+void RemoveTrackedResource(Buffer *pBuffer) {
+    UntrackAllocation(pBuffer);
+    removeResource(pBuffer);
+}
+
+void RemoveTrackedResource(Texture *pTexture) {
+    UntrackAllocation(pTexture);
+    removeResource(pTexture);
+}
+
+void AddTrackedRenderTarget(Renderer *pRenderer, const RenderTargetDesc *pDesc, RenderTarget **ppRenderTarget) {
+    addRenderTarget(pRenderer, pDesc, ppRenderTarget);
+    if (*ppRenderTarget != nullptr) {
+        TrackGpuAllocation(*ppRenderTarget, TextureBytes((*ppRenderTarget)->pTexture) * (*ppRenderTarget)->mSampleCount);
+    }
+}
+
+void RemoveTrackedRenderTarget(Renderer *pRenderer, RenderTarget *pRenderTarget) {
+    UntrackAllocation(pRenderTarget);
+    removeRenderTarget(pRenderer, pRenderTarget);
+}
+
+void BeginTrackedUpdate(BufferUpdateDesc *pDesc) {
+    beginUpdateResource(pDesc);
+
+    // A size of zero maps the rest of the buffer.
+    const uint64_t size = pDesc->mSize > 0 ? pDesc->mSize : pDesc->pBuffer->mSize - pDesc->mDstOffset;
+    CountUploadBytes(size);
+}
+
+void CountUploadBytes(uint64_t bytes) { gFrameUploadBytes.fetch_add(bytes, std::memory_order_relaxed); }
+
+void EndMemoryFrame() {
+    gUploadedBytesLastFrame = gFrameUploadBytes.exchange(0);
+    gUploadedBytesPeak = gUploadedBytesLastFrame > gUploadedBytesPeak ? gUploadedBytesLastFrame : gUploadedBytesPeak;
+}
+
+auto GetMemoryStats() -> MemoryStats {
+    MemoryStats stats = {};
+    stats.mOwnerCount = gOwnerCount.load();
+    for (uint32_t i = 0; i < stats.mOwnerCount; ++i) {
+        stats.mGpuBytes += gOwners[i].mGpuBytes.load(std::memory_order_relaxed);
+        stats.mCpuBytes += gOwners[i].mCpuBytes.load(std::memory_order_relaxed);
+    }
+    stats.mProcessBytes = ProcessPrivateBytes();
+    stats.mUploadedBytesLastFrame = gUploadedBytesLastFrame;
+    stats.mUploadedBytesPeak = gUploadedBytesPeak;
+    return stats;
+}
+
+auto GetMemoryOwnerStats(uint32_t owner) -> MemoryOwnerStats {
+    const OwnerRecord &record = gOwners[owner];
+    return {record.pName, record.mGpuBytes.load(std::memory_order_relaxed),
+            record.mCpuBytes.load(std::memory_order_relaxed), record.mDescriptorSlots.load(std::memory_order_relaxed)};
+}
+
+void WriteMemoryReport() {
+    const MemoryStats stats = GetMemoryStats();
+
+    std::string json = "{\n";
+    char line[256];
+    snprintf(line, sizeof(line),
+             "  \"gpuBytes\": %lld,\n  \"cpuBytes\": %lld,\n  \"processBytes\": %llu,\n"
+             "  \"uploadedBytesLastFrame\": %llu,\n  \"uploadedBytesPeak\": %llu,\n  \"owners\": [\n",
+             (long long)stats.mGpuBytes, (long long)stats.mCpuBytes, (unsigned long long)stats.mProcessBytes,
+             (unsigned long long)stats.mUploadedBytesLastFrame, (unsigned long long)stats.mUploadedBytesPeak);
+    json += line;
+
+    LOGF(LogLevel::eINFO, "Memory: GPU %.2f MB, CPU heap %.2f MB, process %.2f MB, peak upload %.2f MB per frame",
+         stats.mGpuBytes / (1024.0 * 1024.0), stats.mCpuBytes / (1024.0 * 1024.0),
+         stats.mProcessBytes / (1024.0 * 1024.0), stats.mUploadedBytesPeak / (1024.0 * 1024.0));
+    for (uint32_t i = 0; i < stats.mOwnerCount; ++i) {
+        const MemoryOwnerStats owner = GetMemoryOwnerStats(i);
+        LOGF(LogLevel::eINFO, "  %-24s GPU %9.2f MB, CPU %9.2f MB, %lld descriptors", owner.pOwner,
+             owner.mGpuBytes / (1024.0 * 1024.0), owner.mCpuBytes / (1024.0 * 1024.0),
+             (long long)owner.mDescriptorSlots);
+
+        snprintf(line, sizeof(line),
+                 "    {\"owner\": \"%s\", \"gpuBytes\": %lld, \"cpuBytes\": %lld, \"descriptors\": %lld}%s\n",
+                 owner.pOwner, (long long)owner.mGpuBytes, (long long)owner.mCpuBytes,
+                 (long long)owner.mDescriptorSlots, i + 1 < stats.mOwnerCount ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_LOG, "memory_report.json", FM_WRITE, nullptr, &file)) {
+        LOGF(LogLevel::eWARNING, "Could not write memory_report.json");
+        return;
+    }
+    fsWriteToStream(&file, json.data(), json.size());
+    fsCloseStream(&file);
+}
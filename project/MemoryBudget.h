@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+#include <cstdint>
+
+// GPU and CPU memory attributed to the scene or subsystem that allocated it, owned by MainApp.
+//
+// Allocations are charged to the owner of the innermost MemoryScope on the allocating thread, or
+// to "Unscoped" outside of any scope, and stay charged to that owner until they are freed. Assets
+// shared through the resource cache are charged to the owner that loaded them first.
+//
+// GPU memory is the size of the buffers, textures and render targets created through the tracked
+// wrappers below, descriptor sets are counted in slots. CPU memory is the C++ heap of the
+// application, over-aligned allocations included. Forge allocates from its own heap, which cannot
+// be hooked from the application, so the font system, the UI and the resource loader only show up
+// in the process total.
+
+constexpr uint32_t MaxMemoryOwners = 64;
+
+using MemoryOwner = uint32_t;
+
+// The owner named pName, which must be a string literal or otherwise outlive the application, added
+// on first use. Takes a lock, intern owners once at Init and keep the id.
+auto InternMemoryOwner(const char *pName) -> MemoryOwner;
+
+// Charges every allocation made by this thread to owner until the scope ends. Does not lock, cheap
+// enough for every frame.
+class MemoryScope {
+  public:
+    explicit MemoryScope(MemoryOwner owner);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope &) = delete;
+    auto operator=(const MemoryScope &) -> MemoryScope & = delete;
+
+  private:
+    MemoryOwner mPreviousOwner;
+};
+
+void TrackGpuAllocation(const void *pResource, uint64_t bytes);
+void TrackDescriptorSet(const DescriptorSet *pSet, uint32_t slotCount);
+void UntrackAllocation(const void *pResource);
+
+auto TextureBytes(const Texture *pTexture) -> uint64_t;
+auto GeometryBytes(const Geometry *pGeometry) -> uint64_t;
+
+// addResource and removeResource for resources whose size is known when they are created. File
+// textures and geometry are only sized once loaded, track them with TrackGpuAllocation.
+void AddTrackedResource(BufferLoadDesc *pDesc, SyncToken *pToken);
+void AddTrackedResource(TextureLoadDesc *pDesc, SyncToken *pToken);
+void RemoveTrackedResource(Buffer *pBuffer);
+void RemoveTrackedResource(Texture *pTexture);
+
+void AddTrackedRenderTarget(Renderer *pRenderer, const RenderTargetDesc *pDesc, RenderTarget **ppRenderTarget);
+void RemoveTrackedRenderTarget(Renderer *pRenderer, RenderTarget *pRenderTarget);
+
+// beginUpdateResource, counting the bytes written towards the uploads of the frame.
+void BeginTrackedUpdate(BufferUpdateDesc *pDesc);
+// For uploads made without beginUpdateResource, e.g. copies from the upload batcher.
+void CountUploadBytes(uint64_t bytes);
+
+// Closes the upload count of the frame, called once per frame after submitting.
+void EndMemoryFrame();
+
+struct MemoryOwnerStats {
+    const char *pOwner;
+    int64_t mGpuBytes;
+    int64_t mCpuBytes;
+    int64_t mDescriptorSlots;
+};
+
+struct MemoryStats {
+    uint32_t mOwnerCount;
+    int64_t mGpuBytes;
+    int64_t mCpuBytes;
+    // Private bytes of the whole process, zero where the platform does not report it.
+    uint64_t mProcessBytes;
+    uint64_t mUploadedBytesLastFrame;
+    uint64_t mUploadedBytesPeak;
+};
+
+auto GetMemoryStats() -> MemoryStats;
+// owner is below MemoryStats::mOwnerCount, owners are never removed.
+auto GetMemoryOwnerStats(uint32_t owner) -> MemoryOwnerStats;
+
+// Writes every owner to the log and to memory_report.json in the log directory.
+void WriteMemoryReport();
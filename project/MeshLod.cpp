@@ -0,0 +1,159 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+// Levels are built by vertex clustering: the bounds are split into a grid, every cell
+// collapses onto the source vertex closest to the cell average and triangles that
+// become degenerate are dropped. Each coarser level halves the grid resolution.
+
+namespace {
+constexpr uint32_t InitialGridResolution = 64;
+constexpr float MinTriangleReduction = 0.9f;
+
+struct Cell {
+    float3 mSum;
+    uint32_t mCount;
+    uint32_t mRepresentative;
+    float mRepresentativeDistance;
+};
+
+auto Distance(const float3 &a, const float3 &b) -> float {
+    float3 d = a - b;
+    return sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+}
+
+auto CellKey(uint32_t x, uint32_t y, uint32_t z) -> uint64_t {
+    return (uint64_t)x | ((uint64_t)y << 21) | ((uint64_t)z << 42);
+}
+} // namespace
+
+void GenerateMeshLodChain(const float3 *pPositions, uint32_t vertexCount, const uint32_t *pIndices,
+                          uint32_t indexCount, uint32_t maxLevels, MeshLodChain *pOut) {
+    pOut->mIndices.assign(pIndices, pIndices + indexCount);
+    pOut->mLevels.clear();
+    pOut->mLevels.push_back({0, indexCount, 0.0f});
+
+    float3 boundsMin{FLT_MAX};
+    float3 boundsMax{-FLT_MAX};
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        boundsMin = min(boundsMin, pPositions[i]);
+        boundsMax = max(boundsMax, pPositions[i]);
+    }
+
+    pOut->mBoundsCenter = vertexCount > 0 ? (boundsMin + boundsMax) * 0.5f : float3{0.0f};
+    pOut->mBoundsRadius = 0.0f;
+    for (uint32_t i = 0; i < vertexCount; ++i) {
+        pOut->mBoundsRadius = std::max(pOut->mBoundsRadius, Distance(pPositions[i], pOut->mBoundsCenter));
+    }
+
+    if (vertexCount == 0 || indexCount < 3) {
+        return;
+    }
+
+    float3 size = boundsMax - boundsMin;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    if (extent <= 0.0f) {
+        return;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> cellLookup;
+    std::vector<Cell> cells;
+    std::vector<uint32_t> vertexCells(vertexCount);
+    std::vector<uint32_t> levelIndices;
+    levelIndices.reserve(indexCount);
+
+    uint32_t previousIndexCount = indexCount;
+    float previousError = 0.0f;
+
+    for (uint32_t resolution = InitialGridResolution;
+         resolution > 0 && pOut->mLevels.size() < std::min(maxLevels, MaxMeshLodLevels); resolution /= 2) {
+        const float cellSize = extent / (float)resolution;
+
+        cellLookup.clear();
+        cells.clear();
+        for (uint32_t i = 0; i < vertexCount; ++i) {
+            float3 local = (pPositions[i] - boundsMin) / cellSize;
+            uint32_t x = std::min((uint32_t)local.x, resolution - 1);
+            uint32_t y = std::min((uint32_t)local.y, resolution - 1);
+            uint32_t z = std::min((uint32_t)local.z, resolution - 1);
+
+            auto inserted = cellLookup.emplace(CellKey(x, y, z), (uint32_t)cells.size());
+            if (inserted.second) {
+                cells.push_back({float3{0.0f}, 0, i, FLT_MAX});
+            }
+
+            Cell &cell = cells[inserted.first->second];
+            cell.mSum += pPositions[i];
+            cell.mCount++;
+            vertexCells[i] = inserted.first->second;
+        }
+
+        for (uint32_t i = 0; i < vertexCount; ++i) {
+            Cell &cell = cells[vertexCells[i]];
+            float d = Distance(pPositions[i], cell.mSum / (float)cell.mCount);
+            if (d < cell.mRepresentativeDistance) {
+                cell.mRepresentativeDistance = d;
+                cell.mRepresentative = i;
+            }
+        }
+
+        float error = previousError;
+        for (uint32_t i = 0; i < vertexCount; ++i) {
+            error = std::max(error, Distance(pPositions[i], pPositions[cells[vertexCells[i]].mRepresentative]));
+        }
+
+        levelIndices.clear();
+        for (uint32_t t = 0; t + 2 < indexCount; t += 3) {
+            uint32_t a = cells[vertexCells[pIndices[t + 0]]].mRepresentative;
+            uint32_t b = cells[vertexCells[pIndices[t + 1]]].mRepresentative;
+            uint32_t c = cells[vertexCells[pIndices[t + 2]]].mRepresentative;
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            levelIndices.push_back(a);
+            levelIndices.push_back(b);
+            levelIndices.push_back(c);
+        }
+
+        if (levelIndices.empty()) {
+            break;
+        }
+
+        // Not worth a level of its own, try a coarser grid.
+        if ((float)levelIndices.size() > (float)previousIndexCount * MinTriangleReduction) {
+            continue;
+        }
+
+        MeshLodLevel level{};
+        level.mIndexOffset = (uint32_t)pOut->mIndices.size();
+        level.mIndexCount = (uint32_t)levelIndices.size();
+        level.mError = error;
+        pOut->mLevels.push_back(level);
+        pOut->mIndices.insert(pOut->mIndices.end(), levelIndices.begin(), levelIndices.end());
+
+        previousIndexCount = level.mIndexCount;
+        previousError = error;
+    }
+}
+
+auto LodPixelsPerUnit(float fov, float viewportExtent) -> float {
+    return viewportExtent / (2.0f * tanf(fov * 0.5f));
+}
+
+auto SelectMeshLod(const MeshLodChain &chain, float distance, float pixelsPerUnit, float maxErrorPx) -> uint32_t {
+    if (distance <= 0.0f) {
+        return 0;
+    }
+
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < (uint32_t)chain.mLevels.size(); ++i) {
+        if (chain.mLevels[i].mError * pixelsPerUnit / distance > maxErrorPx) {
+            break;
+        }
+        selected = i;
+    }
+    return selected;
+}
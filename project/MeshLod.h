@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Common_3/OS/Math/MathTypes.h>
+#include <cstdint>
+#include <vector>
+
+// Index-only level of detail: every level shares the source vertex buffer and only
+// references a subset of its vertices, so picking a level is picking an index range.
+struct MeshLodLevel {
+    uint32_t mIndexOffset;
+    uint32_t mIndexCount;
+    // Object space distance between the source surface and this level.
+    float mError;
+};
+
+struct MeshLodChain {
+    // Indices of every level, finest level first.
+    std::vector<uint32_t> mIndices;
+    std::vector<MeshLodLevel> mLevels;
+
+    float3 mBoundsCenter;
+    float mBoundsRadius;
+};
+
+constexpr uint32_t MaxMeshLodLevels = 8;
+
+void GenerateMeshLodChain(const float3 *pPositions, uint32_t vertexCount, const uint32_t *pIndices,
+                          uint32_t indexCount, uint32_t maxLevels, MeshLodChain *pOut);
+
+// Number of pixels covered by one world unit at distance 1, fov and viewportExtent taken along the same axis.
+auto LodPixelsPerUnit(float fov, float viewportExtent) -> float;
+
+// Picks the coarsest level whose projected error stays below maxErrorPx.
+auto SelectMeshLod(const MeshLodChain &chain, float distance, float pixelsPerUnit, float maxErrorPx) -> uint32_t;
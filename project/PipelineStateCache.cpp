@@ -0,0 +1,464 @@
+#include "PipelineStateCache.h"
+
+#include "DescriptorCache.h"
+#include "ResourceCache.h"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+#include <Common_3/OS/Interfaces/ILog.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+constexpr const char *DriverCacheFileName = "pipelines.cache";
+constexpr const char *PipelineListFileName = "pipelines.list";
+constexpr uint32_t PipelineListMagic = 0x4c4f5350; // "PSOL"
+// The state structs are stored byte for byte, a build where any of them changed size ignores the
+// list.
+constexpr uint32_t PipelineListLayout = sizeof(VertexLayout) ^ (sizeof(BlendStateDesc) << 8) ^
+                                        (sizeof(DepthStateDesc) << 16) ^ (sizeof(RasterizerStateDesc) << 24);
+
+struct PipelineEntry {
+    Pipeline *pPipeline;
+    uint32_t mRefCount;
+    // The cache holds a reference on both so that a key never matches a recycled pointer.
+    Shader *pShader;
+    RootSignature *pRootSignature;
+    // The description without pointers, empty when it cannot be recorded.
+    std::string mRecord;
+};
+
+Renderer *pCacheRenderer = nullptr;
+PipelineCache *pDriverCache = nullptr;
+
+// Keyed by the whole description, byte for byte, so different descriptions never share an entry.
+std::unordered_map<std::string, PipelineEntry> gPipelines;
+std::unordered_map<Pipeline *, std::string> gPipelineKeys;
+
+// Records of the pipelines acquired this run, saved for the next one.
+std::unordered_set<std::string> gRecords;
+
+uint32_t gHits = 0;
+uint32_t gMisses = 0;
+uint32_t gPrewarmed = 0;
+
+// Scenes load on the main thread, see Scene::Prepare, the lock keeps lookups from other threads safe.
+std::mutex gCacheMutex;
+} // namespace
+
+static void AppendBytes(std::string &out, const void *pData, size_t size) { out.append((const char *)pData, size); }
+
+template <typename T> static void AppendOptional(std::string &out, const T *pState) {
+    const bool present = pState != nullptr;
+    AppendBytes(out, &present, sizeof(present));
+    if (present) {
+        AppendBytes(out, pState, sizeof(T));
+    }
+}
+
+static void AppendString(std::string &out, const std::string &value) {
+    const uint32_t size = (uint32_t)value.size();
+    AppendBytes(out, &size, sizeof(size));
+    out += value;
+}
+
+// Everything after the shader and root signature, shared by the key and the record.
+static void AppendFixedState(std::string &out, const GraphicsPipelineDesc &graphics) {
+    const uint32_t attribCount = graphics.pVertexLayout != nullptr ? graphics.pVertexLayout->mAttribCount : 0;
+    AppendBytes(out, &attribCount, sizeof(attribCount));
+    if (attribCount > 0) {
+        AppendBytes(out, graphics.pVertexLayout->mAttribs, attribCount * sizeof(VertexAttrib));
+    }
+
+    AppendOptional(out, graphics.pBlendState);
+    AppendOptional(out, graphics.pDepthState);
+    AppendOptional(out, graphics.pRasterizerState);
+
+    AppendBytes(out, &graphics.mRenderTargetCount, sizeof(graphics.mRenderTargetCount));
+    if (graphics.mRenderTargetCount > 0) {
+        AppendBytes(out, graphics.pColorFormats, graphics.mRenderTargetCount * sizeof(TinyImageFormat));
+    }
+    AppendBytes(out, &graphics.mDepthStencilFormat, sizeof(graphics.mDepthStencilFormat));
+    AppendBytes(out, &graphics.mSampleCount, sizeof(graphics.mSampleCount));
+    AppendBytes(out, &graphics.mSampleQuality, sizeof(graphics.mSampleQuality));
+    AppendBytes(out, &graphics.mPrimitiveTopo, sizeof(graphics.mPrimitiveTopo));
+    AppendBytes(out, &graphics.mSupportIndirectCommandBuffer, sizeof(graphics.mSupportIndirectCommandBuffer));
+}
+
+static auto PipelineKey(const PipelineDesc &desc) -> std::string {
+    std::string key;
+    AppendBytes(key, &desc.mType, sizeof(desc.mType));
+
+    if (desc.mType == PIPELINE_TYPE_COMPUTE) {
+        AppendBytes(key, &desc.mComputeDesc.pShaderProgram, sizeof(desc.mComputeDesc.pShaderProgram));
+        AppendBytes(key, &desc.mComputeDesc.pRootSignature, sizeof(desc.mComputeDesc.pRootSignature));
+        return key;
+    }
+
+    AppendBytes(key, &desc.mGraphicsDesc.pShaderProgram, sizeof(desc.mGraphicsDesc.pShaderProgram));
+    AppendBytes(key, &desc.mGraphicsDesc.pRootSignature, sizeof(desc.mGraphicsDesc.pRootSignature));
+    AppendFixedState(key, desc.mGraphicsDesc);
+    return key;
+}
+
+// The key with the shader and root signature replaced by the sources they are loaded from.
+static auto PipelineRecord(const PipelineDesc &desc, Shader *pShader, RootSignature *pRootSignature) -> std::string {
+    const std::string shaderSource = ShaderSource(pShader);
+    const std::vector<std::string> rootSources = RootSignatureShaderSources(pRootSignature);
+    if (shaderSource.empty()) {
+        return {};
+    }
+
+    std::string record;
+    AppendBytes(record, &desc.mType, sizeof(desc.mType));
+    AppendString(record, shaderSource);
+
+    const uint32_t rootSourceCount = (uint32_t)rootSources.size();
+    AppendBytes(record, &rootSourceCount, sizeof(rootSourceCount));
+    for (const auto &source : rootSources) {
+        if (source.empty()) {
+            return {};
+        }
+        AppendString(record, source);
+    }
+
+    if (desc.mType != PIPELINE_TYPE_COMPUTE) {
+        AppendFixedState(record, desc.mGraphicsDesc);
+    }
+    return record;
+}
+
+struct RecordReader {
+    const std::string &mRecord;
+    size_t mOffset;
+
+    auto Read(void *pData, size_t size) -> bool {
+        if (mRecord.size() - mOffset < size) {
+            return false;
+        }
+        memcpy(pData, mRecord.data() + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    auto ReadString(std::string &value) -> bool {
+        uint32_t size = 0;
+        if (!Read(&size, sizeof(size)) || mRecord.size() - mOffset < size) {
+            return false;
+        }
+        value = mRecord.substr(mOffset, size);
+        mOffset += size;
+        return true;
+    }
+
+    template <typename T> auto ReadOptional(T &state, T *&pState) -> bool {
+        bool present = false;
+        if (!Read(&present, sizeof(present)) || (present && !Read(&state, sizeof(T)))) {
+            return false;
+        }
+        pState = present ? &state : nullptr;
+        return true;
+    }
+};
+
+static void RemoveEntry(const PipelineEntry &entry) {
+    removePipeline(pCacheRenderer, entry.pPipeline);
+    ReleaseRootSignature(entry.pRootSignature);
+    ReleaseShader(entry.pShader);
+}
+
+static auto AcquireCachedPipeline(const PipelineDesc &desc, bool record) -> Pipeline * {
+    const std::string key = PipelineKey(desc);
+
+    {
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+
+        auto found = gPipelines.find(key);
+        if (found != gPipelines.end()) {
+            found->second.mRefCount++;
+            if (record && !found->second.mRecord.empty()) {
+                gRecords.insert(found->second.mRecord);
+            }
+            gHits++;
+            return found->second.pPipeline;
+        }
+    }
+
+    // The lock is not held while the pipeline is created and the other caches are asked for its
+    // sources, they take their own locks. Two threads missing on the same key both create it and
+    // the second is dropped.
+    PipelineDesc cachedDesc = desc;
+    cachedDesc.pCache = pDriverCache;
+
+    PipelineEntry entry = {};
+    addPipeline(pCacheRenderer, &cachedDesc, &entry.pPipeline);
+    entry.mRefCount = 1;
+
+    const bool compute = desc.mType == PIPELINE_TYPE_COMPUTE;
+    entry.pShader = compute ? desc.mComputeDesc.pShaderProgram : desc.mGraphicsDesc.pShaderProgram;
+    entry.pRootSignature = compute ? desc.mComputeDesc.pRootSignature : desc.mGraphicsDesc.pRootSignature;
+    RetainShader(entry.pShader);
+    RetainRootSignature(entry.pRootSignature);
+    entry.mRecord = PipelineRecord(desc, entry.pShader, entry.pRootSignature);
+
+    Pipeline *pCached = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+
+        auto found = gPipelines.find(key);
+        if (found != gPipelines.end()) {
+            found->second.mRefCount++;
+            pCached = found->second.pPipeline;
+        } else {
+            pCached = entry.pPipeline;
+            gPipelineKeys[pCached] = key;
+            gPipelines[key] = entry;
+        }
+        if (record && !entry.mRecord.empty()) {
+            gRecords.insert(entry.mRecord);
+        }
+        gMisses++;
+    }
+
+    if (pCached != entry.pPipeline) {
+        RemoveEntry(entry);
+    }
+    return pCached;
+}
+
+// Creates the pipeline a record describes and leaves it in the cache unreferenced.
+static auto PrewarmPipeline(const std::string &record) -> bool {
+    RecordReader reader = {record, 0};
+
+    PipelineDesc desc = {};
+    std::string shaderSource;
+    uint32_t rootSourceCount = 0;
+    if (!reader.Read(&desc.mType, sizeof(desc.mType)) || !reader.ReadString(shaderSource) ||
+        !reader.Read(&rootSourceCount, sizeof(rootSourceCount)) || rootSourceCount == 0) {
+        return false;
+    }
+
+    std::vector<std::string> rootSources(rootSourceCount);
+    for (auto &source : rootSources) {
+        if (!reader.ReadString(source)) {
+            return false;
+        }
+    }
+
+    VertexLayout vertexLayout = {};
+    BlendStateDesc blendState = {};
+    DepthStateDesc depthState = {};
+    RasterizerStateDesc rasterizerState = {};
+    TinyImageFormat colorFormats[MAX_RENDER_TARGET_ATTACHMENTS] = {};
+    if (desc.mType != PIPELINE_TYPE_COMPUTE) {
+        GraphicsPipelineDesc &graphics = desc.mGraphicsDesc;
+
+        if (!reader.Read(&vertexLayout.mAttribCount, sizeof(vertexLayout.mAttribCount)) ||
+            vertexLayout.mAttribCount > MAX_VERTEX_ATTRIBS ||
+            !reader.Read(vertexLayout.mAttribs, vertexLayout.mAttribCount * sizeof(VertexAttrib))) {
+            return false;
+        }
+        graphics.pVertexLayout = vertexLayout.mAttribCount > 0 ? &vertexLayout : nullptr;
+
+        if (!reader.ReadOptional(blendState, graphics.pBlendState) ||
+            !reader.ReadOptional(depthState, graphics.pDepthState) ||
+            !reader.ReadOptional(rasterizerState, graphics.pRasterizerState)) {
+            return false;
+        }
+
+        if (!reader.Read(&graphics.mRenderTargetCount, sizeof(graphics.mRenderTargetCount)) ||
+            graphics.mRenderTargetCount > MAX_RENDER_TARGET_ATTACHMENTS ||
+            !reader.Read(colorFormats, graphics.mRenderTargetCount * sizeof(TinyImageFormat))) {
+            return false;
+        }
+        graphics.pColorFormats = colorFormats;
+
+        if (!reader.Read(&graphics.mDepthStencilFormat, sizeof(graphics.mDepthStencilFormat)) ||
+            !reader.Read(&graphics.mSampleCount, sizeof(graphics.mSampleCount)) ||
+            !reader.Read(&graphics.mSampleQuality, sizeof(graphics.mSampleQuality)) ||
+            !reader.Read(&graphics.mPrimitiveTopo, sizeof(graphics.mPrimitiveTopo)) ||
+            !reader.Read(&graphics.mSupportIndirectCommandBuffer, sizeof(graphics.mSupportIndirectCommandBuffer))) {
+            return false;
+        }
+    }
+    if (reader.mOffset != record.size()) {
+        return false;
+    }
+
+    Shader *pShader = AcquireShader(shaderSource);
+    std::vector<Shader *> rootShaders;
+    for (const auto &source : rootSources) {
+        rootShaders.push_back(AcquireShader(source));
+    }
+
+    bool loaded = pShader != nullptr;
+    for (Shader *pRootShader : rootShaders) {
+        loaded = loaded && pRootShader != nullptr;
+    }
+
+    if (loaded) {
+        RootSignature *pRootSignature = AcquireRootSignature(rootShaders.data(), rootSourceCount);
+        if (desc.mType == PIPELINE_TYPE_COMPUTE) {
+            desc.mComputeDesc.pShaderProgram = pShader;
+            desc.mComputeDesc.pRootSignature = pRootSignature;
+        } else {
+            desc.mGraphicsDesc.pShaderProgram = pShader;
+            desc.mGraphicsDesc.pRootSignature = pRootSignature;
+        }
+
+        // The cache keeps its own references.
+        ReleasePipeline(AcquireCachedPipeline(desc, false));
+        ReleaseRootSignature(pRootSignature);
+    }
+
+    for (Shader *pRootShader : rootShaders) {
+        if (pRootShader != nullptr) {
+            ReleaseShader(pRootShader);
+        }
+    }
+    if (pShader != nullptr) {
+        ReleaseShader(pShader);
+    }
+    return loaded;
+}
+
+static void LoadPipelineList() {
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_PIPELINE_CACHE, PipelineListFileName, FM_READ_BINARY, nullptr, &file)) {
+        return;
+    }
+
+    uint32_t header[3] = {};
+    bool read = fsReadFromStream(&file, header, sizeof(header)) == sizeof(header) && header[0] == PipelineListMagic &&
+                header[1] == PipelineListLayout;
+
+    std::vector<std::string> records(read ? header[2] : 0);
+    for (auto &record : records) {
+        uint32_t size = 0;
+        read = read && fsReadFromStream(&file, &size, sizeof(size)) == sizeof(size);
+        record.resize(read ? size : 0);
+        read = read && fsReadFromStream(&file, record.data(), size) == size;
+    }
+    fsCloseStream(&file);
+
+    if (!read) {
+        LOGF(LogLevel::eWARNING, "Ignoring %s, it is from another build or damaged", PipelineListFileName);
+        return;
+    }
+
+    for (const auto &record : records) {
+        if (PrewarmPipeline(record)) {
+            gPrewarmed++;
+        }
+    }
+}
+
+static void SavePipelineList() {
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_PIPELINE_CACHE, PipelineListFileName, FM_WRITE_BINARY, nullptr, &file)) {
+        return;
+    }
+
+    const uint32_t header[3] = {PipelineListMagic, PipelineListLayout, (uint32_t)gRecords.size()};
+    fsWriteToStream(&file, header, sizeof(header));
+    for (const auto &record : gRecords) {
+        const uint32_t size = (uint32_t)record.size();
+        fsWriteToStream(&file, &size, sizeof(size));
+        fsWriteToStream(&file, record.data(), size);
+    }
+    fsCloseStream(&file);
+}
+
+void InitPipelineStateCache(Renderer *pRenderer) {
+    pCacheRenderer = pRenderer;
+    gPrewarmed = 0;
+    gRecords.clear();
+
+    // Starts empty when there is no file from a previous run.
+    PipelineCacheLoadDesc desc = {};
+    desc.pFileName = DriverCacheFileName;
+    loadPipelineCache(pRenderer, &desc, &pDriverCache);
+
+    // Only what the scenes acquire counts towards hits and misses.
+    LoadPipelineList();
+    gHits = 0;
+    gMisses = 0;
+}
+
+void ExitPipelineStateCache() {
+    SavePipelineList();
+
+    for (auto &[key, entry] : gPipelines) {
+        if (entry.mRefCount > 0) {
+            LOGF(LogLevel::eWARNING, "Pipeline %p still referenced %u times on exit", (void *)entry.pPipeline,
+                 entry.mRefCount);
+        }
+        RemoveEntry(entry);
+    }
+    gPipelines.clear();
+    gPipelineKeys.clear();
+
+    if (pDriverCache != nullptr) {
+        PipelineCacheSaveDesc desc = {};
+        desc.pFileName = DriverCacheFileName;
+        savePipelineCache(pCacheRenderer, pDriverCache, &desc);
+        removePipelineCache(pCacheRenderer, pDriverCache);
+        pDriverCache = nullptr;
+    }
+
+    pCacheRenderer = nullptr;
+}
+
+auto AcquirePipeline(const PipelineDesc &desc) -> Pipeline * { return AcquireCachedPipeline(desc, true); }
+
+void ReleasePipeline(Pipeline *pPipeline) {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    auto key = gPipelineKeys.find(pPipeline);
+    if (key == gPipelineKeys.end()) {
+        LOGF(LogLevel::eERROR, "Releasing a pipeline that is not in the cache");
+        return;
+    }
+
+    PipelineEntry &entry = gPipelines[key->second];
+    if (entry.mRefCount == 0) {
+        LOGF(LogLevel::eERROR, "Releasing pipeline %p more times than it was acquired", (void *)pPipeline);
+        return;
+    }
+    entry.mRefCount--;
+}
+
+void PurgePipelineStateCache() {
+    // Removed after the lock is released, releasing the shaders and root signatures locks their caches.
+    std::vector<PipelineEntry> removed;
+    {
+        std::lock_guard<std::mutex> lock(gCacheMutex);
+
+        for (auto it = gPipelines.begin(); it != gPipelines.end();) {
+            if (it->second.mRefCount > 0) {
+                ++it;
+                continue;
+            }
+
+            gPipelineKeys.erase(it->second.pPipeline);
+            removed.push_back(std::move(it->second));
+            it = gPipelines.erase(it);
+        }
+    }
+
+    for (const PipelineEntry &entry : removed) {
+        RemoveEntry(entry);
+    }
+}
+
+auto PipelineStateDriverCache() -> PipelineCache * { return pDriverCache; }
+
+auto GetPipelineStateCacheStats() -> PipelineStateCacheStats {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    return {(uint32_t)gPipelines.size(), gHits, gMisses, gPrewarmed};
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+
+// Pipelines shared by every scene, owned by MainApp.
+//
+// Pipelines are looked up by their whole description: shader, root signature, vertex layout,
+// rasterizer, depth and blend state, render target formats and sample count. Released
+// pipelines stay alive until PurgePipelineStateCache, so a scene reloading after the swap chain is
+// rebuilt gets its pipelines back without compiling anything. Descriptions must be zero
+// initialised, `= {}`, as the state structs are compared byte for byte.
+//
+// The descriptions of the pipelines acquired during a run are saved on exit to
+// RD_PIPELINE_CACHE/pipelines.list, with the shaders named by the files they load from. Init
+// creates them again, with their shaders and root signatures, so a scene loading later finds its
+// pipelines in the cache on every backend. Pipelines are also created through a driver pipeline
+// cache saved next to it, which speeds up creating them where the backend supports one; Direct3D
+// 11 does not.
+
+void InitPipelineStateCache(Renderer *pRenderer);
+void ExitPipelineStateCache();
+
+auto AcquirePipeline(const PipelineDesc &desc) -> Pipeline *;
+void ReleasePipeline(Pipeline *pPipeline);
+
+// Removes every pipeline that is no longer referenced. The GPU must be done with them.
+void PurgePipelineStateCache();
+
+// For pipelines created outside the cache, e.g. by the font system.
+auto PipelineStateDriverCache() -> PipelineCache *;
+
+struct PipelineStateCacheStats {
+    uint32_t mPipelineCount;
+    uint32_t mHits;
+    uint32_t mMisses;
+    // Created at Init from the list of the previous run.
+    uint32_t mPrewarmed;
+};
+
+auto GetPipelineStateCacheStats() -> PipelineStateCacheStats;
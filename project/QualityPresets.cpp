@@ -0,0 +1,160 @@
+#include "QualityPresets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+#include <Common_3/OS/Interfaces/ILog.h>
+
+namespace {
+constexpr QualityPreset Presets[(uint32_t)QualityLevel::Count] = {
+    // Office
+    {16, 8, 65536, 8.0f, true},
+    // Low
+    {64, 16, 262144, 4.0f, true},
+    // Medium
+    {256, 24, 524288, 2.0f, true},
+    // High
+    {1024, 32, 1048576, 1.0f, false},
+    // Ultra
+    {4096, 32, 2097152, 0.5f, false},
+};
+
+const char *pLevelNames[(uint32_t)QualityLevel::Count] = {"Office", "Low", "Medium", "High", "Ultra"};
+
+// Frames skipped while pipelines and uploads settle, then frames averaged.
+constexpr uint32_t WarmupFrames = 16;
+constexpr uint32_t CalibrationFrames = 64;
+
+QualityLevel gLevel = QualityLevel::Low;
+bool bCalibrating = false;
+uint32_t gCalibrationFrame = 0;
+double gCalibrationMs = 0.0;
+} // namespace
+
+static auto ParseClass(const char *pBegin, const char *pEnd, QualityLevel *pLevel) -> bool {
+    while (pBegin < pEnd && *pBegin == ' ') {
+        ++pBegin;
+    }
+    while (pEnd > pBegin && pEnd[-1] == ' ') {
+        --pEnd;
+    }
+
+    const size_t length = pEnd - pBegin;
+    // gpu.cfg also has Medium-Low, which the presets fold into Low.
+    const struct {
+        const char *pName;
+        QualityLevel mLevel;
+    } classes[] = {{"Ultra", QualityLevel::Ultra},   {"High", QualityLevel::High},
+                   {"Medium", QualityLevel::Medium}, {"Medium-Low", QualityLevel::Low},
+                   {"Low", QualityLevel::Low},       {"Office", QualityLevel::Office}};
+
+    for (const auto &entry : classes) {
+        if (strlen(entry.pName) == length && strncmp(entry.pName, pBegin, length) == 0) {
+            *pLevel = entry.mLevel;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One pass over the file, stopping at the first line whose vendor and device ids match.
+static auto ClassifyGpu(uint32_t vendorId, uint32_t deviceId, QualityLevel *pLevel) -> bool {
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_GPU_CONFIG, "gpu.cfg", FM_READ, nullptr, &file)) {
+        LOGF(LogLevel::eWARNING, "Could not open gpu.cfg");
+        return false;
+    }
+
+    std::vector<char> text(fsGetStreamFileSize(&file) + 1);
+    const size_t size = fsReadFromStream(&file, text.data(), text.size() - 1);
+    fsCloseStream(&file);
+    text[size] = '\0';
+
+    const char *pLine = text.data();
+    const char *pTextEnd = text.data() + size;
+    while (pLine < pTextEnd) {
+        const char *pLineEnd = (const char *)memchr(pLine, '\n', pTextEnd - pLine);
+        pLineEnd = pLineEnd != nullptr ? pLineEnd : pTextEnd;
+
+        // #VendorId; DeviceId; Classification; Name...
+        if (*pLine != '#') {
+            char *pNext = nullptr;
+            const uint32_t vendor = (uint32_t)strtoul(pLine, &pNext, 16);
+            if (vendor == vendorId && *pNext == ';') {
+                const uint32_t device = (uint32_t)strtoul(pNext + 1, &pNext, 16);
+                const char *pClass = pNext + 1;
+                const char *pClassEnd = (const char *)memchr(pClass, ';', pLineEnd - pClass);
+                if (device == deviceId && *pNext == ';' && pClassEnd != nullptr) {
+                    return ParseClass(pClass, pClassEnd, pLevel);
+                }
+            }
+        }
+        pLine = pLineEnd + 1;
+    }
+    return false;
+}
+
+void InitQualityPresets(Renderer *pRenderer) {
+    const GPUVendorPreset &gpu = pRenderer->pActiveGpuSettings->mGpuVendorPreset;
+    const uint32_t vendorId = (uint32_t)strtoul(gpu.mVendorId, nullptr, 16);
+    const uint32_t deviceId = (uint32_t)strtoul(gpu.mModelId, nullptr, 16);
+
+    QualityLevel level = QualityLevel::Low;
+    bCalibrating = !ClassifyGpu(vendorId, deviceId, &level);
+    gLevel = level;
+    gCalibrationFrame = 0;
+    gCalibrationMs = 0.0;
+
+    if (bCalibrating) {
+        LOGF(LogLevel::eINFO, "%s (%s, %s) is not in gpu.cfg, calibrating from %s", gpu.mGpuName, gpu.mVendorId,
+             gpu.mModelId, pLevelNames[(uint32_t)gLevel]);
+    } else {
+        LOGF(LogLevel::eINFO, "%s is classified %s", gpu.mGpuName, pLevelNames[(uint32_t)gLevel]);
+    }
+}
+
+auto ActiveQualityLevel() -> QualityLevel { return gLevel; }
+
+auto ActiveQualityPreset() -> const QualityPreset & { return Presets[(uint32_t)gLevel]; }
+
+auto QualityLevelNames() -> const char ** { return pLevelNames; }
+
+void SetQualityLevel(QualityLevel level) {
+    gLevel = level;
+    bCalibrating = false;
+}
+
+auto UpdateQualityCalibration(float gpuFrameMs, float frameMs, float targetFrameMs) -> bool {
+    if (!bCalibrating) {
+        return false;
+    }
+
+    if (++gCalibrationFrame <= WarmupFrames) {
+        return false;
+    }
+
+    // Without timestamp queries the wall time is all there is.
+    gCalibrationMs += gpuFrameMs > 0.0f ? gpuFrameMs : frameMs;
+    if (gCalibrationFrame < WarmupFrames + CalibrationFrames) {
+        return false;
+    }
+
+    // Each level roughly doubles the work of the one below, so every halving of the measured time
+    // against the target is room for one more level.
+    const double averageMs = gCalibrationMs / CalibrationFrames;
+    const int headroom = (int)std::floor(std::log2(targetFrameMs / std::max(averageMs, 0.01)));
+    const int level = std::min(std::max((int)gLevel + headroom, 0), (int)QualityLevel::Count - 1);
+
+    LOGF(LogLevel::eINFO, "Calibration: %.3f ms per frame at %s, target %.1f ms, picking %s", averageMs,
+         pLevelNames[(uint32_t)gLevel], targetFrameMs, pLevelNames[level]);
+
+    gLevel = (QualityLevel)level;
+    bCalibrating = false;
+    return true;
+}
+
+auto IsCalibratingQuality() -> bool { return bCalibrating; }
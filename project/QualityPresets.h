@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+
+// Scene parameters picked from the class GPUCfg/gpu.cfg gives the active GPU.
+//
+// The class is looked up once, right after the renderer is created and before any scene creates
+// resources. Devices gpu.cfg does not list, software rasterizers among them, start at Low and are
+// calibrated: the GPU time of the first frames decides how many levels there is headroom for.
+// Scenes read the active preset in Init, a level change reaches a scene the next time it loads.
+
+enum class QualityLevel : uint32_t { Office, Low, Medium, High, Ultra, Count };
+
+struct QualityPreset {
+    // Cubes drawn by the basic lighting scene.
+    uint32_t mCubeCount;
+    // Side of the instance grid of the model LOD scene.
+    uint32_t mModelGridSize;
+    // Particles the compute particle scene starts with.
+    uint32_t mParticleCount;
+    // Screen space error, in pixels, the LOD selection starts with.
+    float mMaxLodErrorPx;
+    bool mDynamicResolution;
+};
+
+void InitQualityPresets(Renderer *pRenderer);
+
+auto ActiveQualityLevel() -> QualityLevel;
+auto ActiveQualityPreset() -> const QualityPreset &;
+// Indexed by QualityLevel.
+auto QualityLevelNames() -> const char **;
+
+void SetQualityLevel(QualityLevel level);
+
+// Call once per frame while calibrating, with the GPU and wall time of the last frame. True on the
+// frame the calibration finishes, ActiveQualityLevel is the refined level from then on.
+auto UpdateQualityCalibration(float gpuFrameMs, float frameMs, float targetFrameMs) -> bool;
+auto IsCalibratingQuality() -> bool;
@@ -0,0 +1,473 @@
+#include "RenderGraph.h"
+
+#include "MainApp.h"
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+
+namespace {
+constexpr uint32_t NoPhysicalTarget = UINT32_MAX;
+
+struct ResourceUse {
+    RGResource mResource;
+    ResourceState mState;
+    bool bRead;
+    bool bWrite;
+};
+
+struct PassNode {
+    const char *pName;
+    std::function<void(Cmd *cmd)> mExecute;
+    std::vector<ResourceUse> mUses;
+
+    RGResource mColors[MAX_RENDER_TARGET_ATTACHMENTS];
+    LoadActionType mColorLoads[MAX_RENDER_TARGET_ATTACHMENTS];
+    uint32_t mColorCount;
+    bool bHasDepth;
+    RGResource mDepth;
+    LoadActionType mDepthLoad;
+
+    bool bSideEffect;
+    bool bCulled;
+    uint32_t mRefCount;
+    std::vector<RenderTargetBarrier> mBarriers;
+};
+
+struct ResourceNode {
+    // Null for transient targets.
+    RenderTarget *pImported;
+    ResourceState mState;
+    ResourceState mFinalState;
+
+    // Only the name is used for imported targets.
+    RGTargetDesc mDesc;
+    uint32_t mPhysical;
+
+    uint32_t mRefCount;
+    std::vector<RGPass> mWriters;
+    uint32_t mFirstPass;
+    uint32_t mLastPass;
+};
+
+// Physical targets behind transient targets, kept from frame to frame.
+struct PooledTarget {
+    RenderTarget *pRenderTarget;
+    ResourceState mState;
+    // Last pass of this frame using the target, -1 while it is free.
+    int32_t mBusyUntil;
+};
+
+Renderer *pGraphRenderer = nullptr;
+MemoryOwner gMemoryOwner = 0;
+
+std::vector<PassNode> gPasses;
+std::vector<ResourceNode> gResources;
+std::vector<RenderTargetBarrier> gFinalBarriers;
+std::vector<PooledTarget> gPool;
+
+bool bDumpRequested = false;
+} // namespace
+
+static auto TargetBytes(const RenderTarget *pRenderTarget) -> uint64_t {
+    return (uint64_t)pRenderTarget->mWidth * pRenderTarget->mHeight *
+           (TinyImageFormat_BitSizeOfBlock(pRenderTarget->mFormat) / 8);
+}
+
+static auto StateName(ResourceState state) -> const char * {
+    switch (state) {
+    case RESOURCE_STATE_UNDEFINED:
+        return "UNDEFINED";
+    case RESOURCE_STATE_RENDER_TARGET:
+        return "RENDER_TARGET";
+    case RESOURCE_STATE_UNORDERED_ACCESS:
+        return "UNORDERED_ACCESS";
+    case RESOURCE_STATE_DEPTH_WRITE:
+        return "DEPTH_WRITE";
+    case RESOURCE_STATE_DEPTH_READ:
+        return "DEPTH_READ";
+    case RESOURCE_STATE_SHADER_RESOURCE:
+        return "SHADER_RESOURCE";
+    case RESOURCE_STATE_COPY_DEST:
+        return "COPY_DEST";
+    case RESOURCE_STATE_COPY_SOURCE:
+        return "COPY_SOURCE";
+    case RESOURCE_STATE_PRESENT:
+        return "PRESENT";
+    default:
+        return "OTHER";
+    }
+}
+
+static auto PhysicalTarget(const ResourceNode &resource) -> RenderTarget * {
+    if (resource.pImported != nullptr) {
+        return resource.pImported;
+    }
+    return resource.mPhysical != NoPhysicalTarget ? gPool[resource.mPhysical].pRenderTarget : nullptr;
+}
+
+static auto CurrentState(ResourceNode &resource) -> ResourceState & {
+    return resource.pImported != nullptr ? resource.mState : gPool[resource.mPhysical].mState;
+}
+
+// Aliased transient targets share a physical target, the first one using it is named.
+static auto BarrierTargetName(const RenderTargetBarrier &barrier) -> const char * {
+    for (const auto &resource : gResources) {
+        if (PhysicalTarget(resource) == barrier.pRenderTarget) {
+            return resource.mDesc.pName;
+        }
+    }
+    return "unknown";
+}
+
+static void AddUse(RGPass pass, RGResource resource, ResourceState state, bool read, bool write) {
+    gPasses[pass].mUses.push_back({resource, state, read, write});
+}
+
+static void CullPasses() {
+    for (auto &pass : gPasses) {
+        pass.mRefCount = 0;
+        pass.bCulled = false;
+        for (const auto &use : pass.mUses) {
+            pass.mRefCount += use.bWrite ? 1 : 0;
+        }
+    }
+
+    std::vector<RGResource> unreferenced;
+    for (RGResource r = 0; r < gResources.size(); ++r) {
+        ResourceNode &resource = gResources[r];
+        resource.mWriters.clear();
+        // Imported targets outlive the frame, whatever is written to them is used.
+        resource.mRefCount = resource.pImported != nullptr ? 1 : 0;
+    }
+    for (RGPass p = 0; p < gPasses.size(); ++p) {
+        for (const auto &use : gPasses[p].mUses) {
+            if (use.bRead) {
+                gResources[use.mResource].mRefCount++;
+            }
+            if (use.bWrite) {
+                gResources[use.mResource].mWriters.push_back(p);
+            }
+        }
+    }
+
+    std::vector<RGPass> culled;
+    for (RGPass p = 0; p < gPasses.size(); ++p) {
+        if (gPasses[p].mRefCount == 0 && !gPasses[p].bSideEffect) {
+            culled.push_back(p);
+        }
+    }
+    for (RGResource r = 0; r < gResources.size(); ++r) {
+        if (gResources[r].mRefCount == 0) {
+            unreferenced.push_back(r);
+        }
+    }
+
+    // Walk back from the unread targets, a pass whose writes are all unread goes, and so may
+    // the targets only it was reading.
+    while (!culled.empty() || !unreferenced.empty()) {
+        if (!unreferenced.empty()) {
+            const RGResource r = unreferenced.back();
+            unreferenced.pop_back();
+            for (RGPass writer : gResources[r].mWriters) {
+                PassNode &pass = gPasses[writer];
+                if (--pass.mRefCount == 0 && !pass.bSideEffect) {
+                    culled.push_back(writer);
+                }
+            }
+            continue;
+        }
+
+        PassNode &pass = gPasses[culled.back()];
+        culled.pop_back();
+        pass.bCulled = true;
+        for (const auto &use : pass.mUses) {
+            if (use.bRead && --gResources[use.mResource].mRefCount == 0) {
+                unreferenced.push_back(use.mResource);
+            }
+        }
+    }
+}
+
+static void AssignPhysicalTargets() {
+    std::vector<RGResource> transients;
+    for (RGResource r = 0; r < gResources.size(); ++r) {
+        ResourceNode &resource = gResources[r];
+        resource.mFirstPass = UINT32_MAX;
+        resource.mLastPass = 0;
+        resource.mPhysical = NoPhysicalTarget;
+    }
+    for (RGPass p = 0; p < gPasses.size(); ++p) {
+        if (gPasses[p].bCulled) {
+            continue;
+        }
+        for (const auto &use : gPasses[p].mUses) {
+            ResourceNode &resource = gResources[use.mResource];
+            resource.mFirstPass = std::min(resource.mFirstPass, p);
+            resource.mLastPass = std::max(resource.mLastPass, p);
+        }
+    }
+    for (RGResource r = 0; r < gResources.size(); ++r) {
+        if (gResources[r].pImported == nullptr && gResources[r].mFirstPass != UINT32_MAX) {
+            transients.push_back(r);
+        }
+    }
+    std::sort(transients.begin(), transients.end(),
+              [](RGResource a, RGResource b) { return gResources[a].mFirstPass < gResources[b].mFirstPass; });
+
+    for (auto &pooled : gPool) {
+        pooled.mBusyUntil = -1;
+    }
+
+    for (RGResource r : transients) {
+        ResourceNode &resource = gResources[r];
+        const RGTargetDesc &desc = resource.mDesc;
+
+        for (uint32_t i = 0; i < gPool.size(); ++i) {
+            const RenderTarget *pPooled = gPool[i].pRenderTarget;
+            if (gPool[i].mBusyUntil < (int32_t)resource.mFirstPass && pPooled->mWidth == desc.mWidth &&
+                pPooled->mHeight == desc.mHeight && pPooled->mFormat == desc.mFormat) {
+                resource.mPhysical = i;
+                break;
+            }
+        }
+
+        if (resource.mPhysical == NoPhysicalTarget) {
+            RenderTargetDesc rtDesc = {};
+            rtDesc.mArraySize = 1;
+            rtDesc.mDepth = 1;
+            rtDesc.mWidth = desc.mWidth;
+            rtDesc.mHeight = desc.mHeight;
+            rtDesc.mFormat = desc.mFormat;
+            rtDesc.mClearValue = desc.mClearValue;
+            rtDesc.mSampleCount = SAMPLE_COUNT_1;
+            rtDesc.mSampleQuality = 0;
+            rtDesc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+            rtDesc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+            rtDesc.pName = desc.pName;
+
+            MemoryScope scope(gMemoryOwner);
+            PooledTarget pooled = {nullptr, rtDesc.mStartState, -1};
+            AddTrackedRenderTarget(pGraphRenderer, &rtDesc, &pooled.pRenderTarget);
+            resource.mPhysical = (uint32_t)gPool.size();
+            gPool.push_back(pooled);
+        }
+
+        gPool[resource.mPhysical].mBusyUntil = (int32_t)resource.mLastPass;
+    }
+}
+
+static void ComputeBarriers() {
+    for (auto &pass : gPasses) {
+        pass.mBarriers.clear();
+        if (pass.bCulled) {
+            continue;
+        }
+
+        for (const auto &use : pass.mUses) {
+            ResourceNode &resource = gResources[use.mResource];
+            ResourceState &state = CurrentState(resource);
+
+            // Back to back storage writes still need to be ordered.
+            if (state != use.mState || use.mState == RESOURCE_STATE_UNORDERED_ACCESS) {
+                pass.mBarriers.push_back({PhysicalTarget(resource), state, use.mState});
+                state = use.mState;
+            }
+        }
+    }
+
+    gFinalBarriers.clear();
+    for (auto &resource : gResources) {
+        if (resource.pImported != nullptr && resource.mState != resource.mFinalState) {
+            gFinalBarriers.push_back({resource.pImported, resource.mState, resource.mFinalState});
+            resource.mState = resource.mFinalState;
+        }
+    }
+}
+
+static void DumpRenderGraph() {
+    uint32_t culledCount = 0;
+    for (const auto &pass : gPasses) {
+        culledCount += pass.bCulled ? 1 : 0;
+    }
+    LOGF(LogLevel::eINFO, "Render graph: %u passes, %u culled, %u resources", (uint32_t)gPasses.size(), culledCount,
+         (uint32_t)gResources.size());
+
+    for (const auto &pass : gPasses) {
+        LOGF(LogLevel::eINFO, "  %s%s", pass.pName, pass.bCulled ? " (culled)" : "");
+        for (const auto &use : pass.mUses) {
+            const ResourceNode &resource = gResources[use.mResource];
+            LOGF(LogLevel::eINFO, "    %s%s %s as %s", use.bRead ? "read" : "", use.bWrite ? "write" : "",
+                 resource.mDesc.pName, StateName(use.mState));
+        }
+        for (const auto &barrier : pass.mBarriers) {
+            LOGF(LogLevel::eINFO, "    barrier %s %s -> %s", BarrierTargetName(barrier), StateName(barrier.mCurrentState),
+                 StateName(barrier.mNewState));
+        }
+    }
+
+    uint64_t virtualBytes = 0;
+    uint64_t physicalBytes = 0;
+    std::vector<bool> counted(gPool.size(), false);
+    for (const auto &resource : gResources) {
+        if (resource.pImported != nullptr || resource.mPhysical == NoPhysicalTarget) {
+            continue;
+        }
+
+        const uint64_t bytes = TargetBytes(gPool[resource.mPhysical].pRenderTarget);
+        LOGF(LogLevel::eINFO, "  %s: passes %u-%u, physical target %u, %.2f MB", resource.mDesc.pName,
+             resource.mFirstPass, resource.mLastPass, resource.mPhysical, bytes / (1024.0f * 1024.0f));
+
+        virtualBytes += bytes;
+        if (!counted[resource.mPhysical]) {
+            counted[resource.mPhysical] = true;
+            physicalBytes += bytes;
+        }
+    }
+    LOGF(LogLevel::eINFO, "Transient targets: %.2f MB in %.2f MB of physical targets, %.2f MB saved by aliasing",
+         virtualBytes / (1024.0f * 1024.0f), physicalBytes / (1024.0f * 1024.0f),
+         (virtualBytes - physicalBytes) / (1024.0f * 1024.0f));
+}
+
+void InitRenderGraph(Renderer *pRenderer) {
+    pGraphRenderer = pRenderer;
+    gMemoryOwner = InternMemoryOwner("Render Graph");
+}
+
+void ExitRenderGraph() {
+    ReleaseRenderGraphTargets();
+    gPasses.clear();
+    gResources.clear();
+    pGraphRenderer = nullptr;
+}
+
+void ReleaseRenderGraphTargets() {
+    for (auto &pooled : gPool) {
+        RemoveTrackedRenderTarget(pGraphRenderer, pooled.pRenderTarget);
+    }
+    gPool.clear();
+}
+
+void BeginRenderGraph() {
+    gPasses.clear();
+    gResources.clear();
+}
+
+auto ImportRenderTarget(const char *pName, RenderTarget *pRenderTarget, ResourceState state, ResourceState finalState)
+    -> RGResource {
+    ResourceNode resource = {};
+    resource.pImported = pRenderTarget;
+    resource.mDesc.pName = pName;
+    resource.mState = state;
+    resource.mFinalState = finalState;
+    resource.mPhysical = NoPhysicalTarget;
+    gResources.push_back(resource);
+    return (RGResource)gResources.size() - 1;
+}
+
+auto CreateTransientTarget(const RGTargetDesc &desc) -> RGResource {
+    ResourceNode resource = {};
+    resource.mDesc = desc;
+    resource.mPhysical = NoPhysicalTarget;
+    gResources.push_back(resource);
+    return (RGResource)gResources.size() - 1;
+}
+
+auto RenderGraphTarget(RGResource resource) -> RenderTarget * { return PhysicalTarget(gResources[resource]); }
+
+auto AddRenderGraphPass(const char *pName, std::function<void(Cmd *cmd)> execute) -> RGPass {
+    PassNode pass = {};
+    pass.pName = pName;
+    pass.mExecute = std::move(execute);
+    gPasses.push_back(std::move(pass));
+    return (RGPass)gPasses.size() - 1;
+}
+
+void PassColorAttachment(RGPass pass, RGResource resource, LoadActionType loadAction) {
+    PassNode &node = gPasses[pass];
+    if (node.mColorCount == MAX_RENDER_TARGET_ATTACHMENTS) {
+        LOGF(LogLevel::eERROR, "Pass %s has more than %u colour attachments, %s is not bound", node.pName,
+             (uint32_t)MAX_RENDER_TARGET_ATTACHMENTS, gResources[resource].mDesc.pName);
+        return;
+    }
+
+    node.mColors[node.mColorCount] = resource;
+    node.mColorLoads[node.mColorCount] = loadAction;
+    node.mColorCount++;
+    AddUse(pass, resource, RESOURCE_STATE_RENDER_TARGET, loadAction == LOAD_ACTION_LOAD, true);
+}
+
+void PassDepthAttachment(RGPass pass, RGResource resource, LoadActionType loadAction) {
+    PassNode &node = gPasses[pass];
+    node.bHasDepth = true;
+    node.mDepth = resource;
+    node.mDepthLoad = loadAction;
+    AddUse(pass, resource, RESOURCE_STATE_DEPTH_WRITE, loadAction == LOAD_ACTION_LOAD, true);
+}
+
+void PassRead(RGPass pass, RGResource resource, ResourceState state) { AddUse(pass, resource, state, true, false); }
+
+void PassSideEffect(RGPass pass) { gPasses[pass].bSideEffect = true; }
+
+void CmdExecuteRenderGraph(Cmd *cmd) {
+    CullPasses();
+    AssignPhysicalTargets();
+    ComputeBarriers();
+
+    if (bDumpRequested) {
+        DumpRenderGraph();
+        bDumpRequested = false;
+    }
+
+    for (auto &pass : gPasses) {
+        if (pass.bCulled) {
+            continue;
+        }
+
+        if (!pass.mBarriers.empty()) {
+            cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, (uint32_t)pass.mBarriers.size(), pass.mBarriers.data());
+        }
+
+        cmdBeginGpuTimestampQuery(cmd, GpuProfileToken(), pass.pName);
+
+        const bool hasAttachments = pass.mColorCount > 0 || pass.bHasDepth;
+        if (hasAttachments) {
+            RenderTarget *ppColors[MAX_RENDER_TARGET_ATTACHMENTS] = {};
+            LoadActionsDesc loadActions = {};
+            for (uint32_t i = 0; i < pass.mColorCount; ++i) {
+                ppColors[i] = RenderGraphTarget(pass.mColors[i]);
+                loadActions.mLoadActionsColor[i] = pass.mColorLoads[i];
+                loadActions.mClearColorValues[i] = ppColors[i]->mClearValue;
+            }
+
+            RenderTarget *pDepth = pass.bHasDepth ? RenderGraphTarget(pass.mDepth) : nullptr;
+            if (pDepth != nullptr) {
+                loadActions.mLoadActionDepth = pass.mDepthLoad;
+                loadActions.mClearDepth = pDepth->mClearValue;
+            }
+
+            cmdBindRenderTargets(cmd, pass.mColorCount, ppColors, pDepth, &loadActions, nullptr, nullptr, -1, -1);
+
+            // Full target by default, the pass may narrow it.
+            RenderTarget *pFirst = pass.mColorCount > 0 ? ppColors[0] : pDepth;
+            cmdSetViewport(cmd, 0.0F, 0.0F, (float)pFirst->mWidth, (float)pFirst->mHeight, 0.0F, 1.0F);
+            cmdSetScissor(cmd, 0, 0, pFirst->mWidth, pFirst->mHeight);
+        }
+
+        pass.mExecute(cmd);
+
+        if (hasAttachments) {
+            cmdBindRenderTargets(cmd, 0, nullptr, nullptr, nullptr, nullptr, nullptr, -1, -1);
+        }
+
+        cmdEndGpuTimestampQuery(cmd, GpuProfileToken());
+    }
+
+    if (!gFinalBarriers.empty()) {
+        cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, (uint32_t)gFinalBarriers.size(), gFinalBarriers.data());
+    }
+}
+
+void RequestRenderGraphDump() { bDumpRequested = true; }
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+#include <functional>
+
+// Frame graph of the passes recorded into one command buffer.
+//
+// Every frame the passes are declared again, in execution order, together with the render targets
+// they read and write. Executing the graph first compiles it: passes whose results never reach an
+// imported target are culled, the state each target must be in for each pass is worked out and
+// all transitions a pass needs are issued as one batched barrier. Attachments are bound, with
+// their load actions, before a pass executes and unbound after it.
+//
+// Transient targets only live for the frame. Two transient targets whose lifetimes do not overlap
+// and whose size and format match are given the same physical render target. The first pass using
+// a transient target must clear it or overwrite it completely.
+
+typedef uint32_t RGResource;
+typedef uint32_t RGPass;
+
+struct RGTargetDesc {
+    uint32_t mWidth;
+    uint32_t mHeight;
+    TinyImageFormat mFormat;
+    ClearValue mClearValue;
+    const char *pName;
+};
+
+void InitRenderGraph(Renderer *pRenderer);
+void ExitRenderGraph();
+// Removes the physical targets behind transient targets, e.g. when the swap chain is resized.
+// The GPU must be done with them.
+void ReleaseRenderGraphTargets();
+
+void BeginRenderGraph();
+
+// pRenderTarget is in state when the graph starts and is left in finalState when it ends.
+auto ImportRenderTarget(const char *pName, RenderTarget *pRenderTarget, ResourceState state, ResourceState finalState)
+    -> RGResource;
+auto CreateTransientTarget(const RGTargetDesc &desc) -> RGResource;
+// The physical target, only valid inside the execute function of a pass using the resource.
+auto RenderGraphTarget(RGResource resource) -> RenderTarget *;
+
+// Each pass is wrapped in a GPU timestamp named pName, which must outlive the frame.
+auto AddRenderGraphPass(const char *pName, std::function<void(Cmd *cmd)> execute) -> RGPass;
+// LOAD_ACTION_LOAD also counts as a read of the previous contents.
+void PassColorAttachment(RGPass pass, RGResource resource, LoadActionType loadAction);
+void PassDepthAttachment(RGPass pass, RGResource resource, LoadActionType loadAction);
+// Used by the pass without being bound by the graph, e.g. sampled or bound by the pass itself.
+void PassRead(RGPass pass, RGResource resource, ResourceState state);
+// The pass has effects the graph cannot see, e.g. writing buffers, and is never culled.
+void PassSideEffect(RGPass pass);
+
+void CmdExecuteRenderGraph(Cmd *cmd);
+
+// The next execution writes the compiled graph, its barriers and the memory saved by aliasing to the log.
+void RequestRenderGraphDump();
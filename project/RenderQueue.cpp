@@ -0,0 +1,132 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+auto RenderQueueKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth) -> uint64_t {
+    // Non negative floats order like their bits, the top 24 of the 31 that are not the sign are kept.
+    uint32_t depthBits = 0;
+    depth = std::max(depth, 0.0f);
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    return (uint64_t)(pass & 0xff) << 56 | (uint64_t)(pipeline & 0xfff) << 44 | (uint64_t)(material & 0xfffff) << 24 |
+           (uint64_t)(depthBits >> 7);
+}
+
+void ResetRenderQueue(RenderQueue &queue) { queue.mPackets.clear(); }
+
+auto SubmitDraw(RenderQueue &queue, uint64_t sortKey) -> DrawPacket & {
+    DrawPacket packet = {};
+    packet.mSortKey = sortKey;
+    queue.mPackets.push_back(packet);
+    return queue.mPackets.back();
+}
+
+// Least significant byte first, each pass a stable counting sort of the packet order. Bytes every
+// key has in common are skipped, with few pipelines and materials most of the high bytes are.
+static void SortQueue(RenderQueue &queue) {
+    const uint32_t count = (uint32_t)queue.mPackets.size();
+    queue.mOrder.resize(count);
+    queue.mSortScratch.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        queue.mOrder[i] = i;
+    }
+
+    uint32_t *pFrom = queue.mOrder.data();
+    uint32_t *pTo = queue.mSortScratch.data();
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t offsets[256] = {};
+        for (uint32_t i = 0; i < count; ++i) {
+            offsets[(queue.mPackets[i].mSortKey >> shift) & 0xff]++;
+        }
+        if (offsets[(queue.mPackets[0].mSortKey >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        uint32_t sum = 0;
+        for (uint32_t &offset : offsets) {
+            const uint32_t bucket = offset;
+            offset = sum;
+            sum += bucket;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t packet = pFrom[i];
+            pTo[offsets[(queue.mPackets[packet].mSortKey >> shift) & 0xff]++] = packet;
+        }
+        std::swap(pFrom, pTo);
+    }
+
+    if (pFrom != queue.mOrder.data()) {
+        queue.mOrder.swap(queue.mSortScratch);
+    }
+}
+
+void CmdSubmitRenderQueue(Cmd *cmd, RenderQueue &queue) {
+    RenderQueueStats &stats = queue.mStats;
+    stats = {};
+    stats.mPackets = (uint32_t)queue.mPackets.size();
+    if (queue.mPackets.empty()) {
+        return;
+    }
+
+    SortQueue(queue);
+
+    const DrawPacket *pLast = nullptr;
+    for (uint32_t index : queue.mOrder) {
+        const DrawPacket &packet = queue.mPackets[index];
+
+        if (pLast == nullptr || pLast->pPipeline != packet.pPipeline) {
+            cmdBindPipeline(cmd, packet.pPipeline);
+            stats.mBinds++;
+        } else {
+            stats.mBindsSkipped++;
+        }
+
+        // Another root signature drops the bound sets.
+        if (pLast == nullptr || pLast->pRootSignature != packet.pRootSignature ||
+            pLast->mDescriptors.pSet != packet.mDescriptors.pSet ||
+            pLast->mDescriptors.mFirst + pLast->mDescriptorIndex !=
+                packet.mDescriptors.mFirst + packet.mDescriptorIndex) {
+            if (packet.mDescriptors.pSet != nullptr) {
+                CmdBindDescriptors(cmd, packet.mDescriptors, packet.mDescriptorIndex);
+                stats.mBinds++;
+            }
+        } else if (packet.mDescriptors.pSet != nullptr) {
+            stats.mBindsSkipped++;
+        }
+
+        if (pLast == nullptr || pLast->pVertexBuffer != packet.pVertexBuffer ||
+            pLast->mVertexStride != packet.mVertexStride) {
+            if (packet.pVertexBuffer != nullptr) {
+                Buffer *pBuffer = packet.pVertexBuffer;
+                cmdBindVertexBuffer(cmd, 1, &pBuffer, &packet.mVertexStride, NULL);
+                stats.mBinds++;
+            }
+        } else if (packet.pVertexBuffer != nullptr) {
+            stats.mBindsSkipped++;
+        }
+
+        if (pLast == nullptr || pLast->pIndexBuffer != packet.pIndexBuffer ||
+            pLast->mIndexType != packet.mIndexType) {
+            if (packet.pIndexBuffer != nullptr) {
+                cmdBindIndexBuffer(cmd, packet.pIndexBuffer, packet.mIndexType, 0);
+                stats.mBinds++;
+            }
+        } else if (packet.pIndexBuffer != nullptr) {
+            stats.mBindsSkipped++;
+        }
+
+        // Push constants are per draw, they are never skipped.
+        if (packet.mConstantWords > 0) {
+            cmdBindPushConstants(cmd, packet.pRootSignature, packet.mConstantsIndex, packet.mConstants);
+        }
+
+        if (packet.pIndexBuffer != nullptr) {
+            cmdDrawIndexed(cmd, packet.mCount, packet.mFirst, packet.mFirstVertex);
+        } else {
+            cmdDraw(cmd, packet.mCount, packet.mFirst);
+        }
+
+        pLast = &packet;
+    }
+}
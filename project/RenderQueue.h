@@ -0,0 +1,65 @@
+#pragma once
+
+#include "DescriptorCache.h"
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+#include <vector>
+
+// Draws submitted as packets with a sort key and issued in key order.
+//
+// A scene fills the queue in whatever order it walks its objects. Submitting radix sorts the
+// packets by key and issues them, binding the pipeline, descriptors, vertex and index buffer only
+// when they differ from what the previous packet left bound. Keys sort by pass first, then
+// pipeline and material so that packets sharing state end up next to each other, then by depth.
+// Packets are rebuilt every frame, see CommandStream for draws that do not change.
+
+constexpr uint32_t QueueMaxPushConstantWords = 4;
+
+// pass 8 bits, pipeline 12 bits, material 20 bits, depth 24 bits. pipeline and material are small
+// ids picked by the scene, depth is a view distance, nearest first.
+auto RenderQueueKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth) -> uint64_t;
+
+struct DrawPacket {
+    uint64_t mSortKey;
+    Pipeline *pPipeline;
+    RootSignature *pRootSignature;
+    DescriptorRange mDescriptors;
+    uint32_t mDescriptorIndex;
+    Buffer *pVertexBuffer;
+    uint32_t mVertexStride;
+    // nullptr for a non indexed draw.
+    Buffer *pIndexBuffer;
+    uint32_t mIndexType;
+    uint32_t mConstantsIndex;
+    uint32_t mConstantWords;
+    uint32_t mConstants[QueueMaxPushConstantWords];
+    // Vertices, or indices when indexed.
+    uint32_t mCount;
+    uint32_t mFirst;
+    uint32_t mFirstVertex;
+};
+
+struct RenderQueueStats {
+    uint32_t mPackets;
+    uint32_t mBinds;
+    // Binds a draw-by-draw submission would have made on top of mBinds.
+    uint32_t mBindsSkipped;
+};
+
+struct RenderQueue {
+    std::vector<DrawPacket> mPackets;
+    RenderQueueStats mStats = {};
+
+    // Scratch of the sort, kept to avoid allocating every frame.
+    std::vector<uint32_t> mOrder;
+    std::vector<uint32_t> mSortScratch;
+};
+
+void ResetRenderQueue(RenderQueue &queue);
+// The packet to fill, everything but the sort key starts out empty.
+auto SubmitDraw(RenderQueue &queue, uint64_t sortKey) -> DrawPacket &;
+
+// Sorts the queue and issues its draws, the queue keeps its packets until reset.
+void CmdSubmitRenderQueue(Cmd *cmd, RenderQueue &queue);
@@ -0,0 +1,339 @@
+#include "ResourceCache.h"
+
+#include "MemoryBudget.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+enum class ResourceType { Shader, Buffer, Texture };
+
+struct CacheEntry {
+    ResourceType mType;
+    void *pResource;
+    uint32_t mRefCount;
+    // GPU memory of the asset, shaders are not accounted for.
+    uint64_t mBytes;
+};
+
+Renderer *pCacheRenderer = nullptr;
+
+// Keyed by the identity string of the asset, e.g. "shader:2.1.colors.vert|2.1.colors.frag|", with any
+// specialization constants of a shader appended as "$index=bytes".
+std::unordered_map<std::string, CacheEntry> gEntries;
+std::unordered_map<void *, std::string> gKeys;
+
+uint64_t gUploadedBytes = 0;
+
+// Scenes load on the main thread, see Scene::Prepare, the lock keeps lookups from other threads safe.
+// It is not held while an asset loads, two threads missing on the same key both load it and the
+// second is dropped.
+std::mutex gCacheMutex;
+} // namespace
+
+static void RemoveEntry(const CacheEntry &entry) {
+    UntrackAllocation(entry.pResource);
+    switch (entry.mType) {
+    case ResourceType::Shader:
+        removeShader(pCacheRenderer, (Shader *)entry.pResource);
+        break;
+    case ResourceType::Buffer:
+        removeResource((Buffer *)entry.pResource);
+        break;
+    case ResourceType::Texture:
+        removeResource((Texture *)entry.pResource);
+        break;
+    }
+}
+
+static auto Acquire(const std::string &key) -> void * {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    auto found = gEntries.find(key);
+    if (found == gEntries.end()) {
+        return nullptr;
+    }
+    found->second.mRefCount++;
+    return found->second.pResource;
+}
+
+// Returns the resource to hand out, which is the cached one if another thread got there first.
+static auto Insert(const std::string &key, ResourceType type, void *pResource, uint64_t bytes) -> void * {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    auto found = gEntries.find(key);
+    if (found != gEntries.end()) {
+        RemoveEntry({type, pResource, 0, bytes});
+        found->second.mRefCount++;
+        return found->second.pResource;
+    }
+
+    gEntries[key] = {type, pResource, 1, bytes};
+    if (type != ResourceType::Shader) {
+        TrackGpuAllocation(pResource, bytes);
+    }
+    gKeys[pResource] = key;
+    gUploadedBytes += bytes;
+    return pResource;
+}
+
+static void Release(void *pResource) {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    auto key = gKeys.find(pResource);
+    if (key == gKeys.end()) {
+        LOGF(LogLevel::eERROR, "Releasing a resource that is not in the cache");
+        return;
+    }
+
+    CacheEntry &entry = gEntries[key->second];
+    if (entry.mRefCount == 0) {
+        LOGF(LogLevel::eERROR, "Releasing %s more times than it was acquired", key->second.c_str());
+        return;
+    }
+    entry.mRefCount--;
+}
+
+void InitResourceCache(Renderer *pRenderer) {
+    pCacheRenderer = pRenderer;
+    gUploadedBytes = 0;
+}
+
+void ExitResourceCache() {
+    for (auto &[key, entry] : gEntries) {
+        if (entry.mRefCount > 0) {
+            LOGF(LogLevel::eWARNING, "%s still referenced %u times on exit", key.c_str(), entry.mRefCount);
+        }
+        RemoveEntry(entry);
+    }
+    gEntries.clear();
+    gKeys.clear();
+    pCacheRenderer = nullptr;
+}
+
+auto AcquireShader(const ShaderLoadDesc &desc) -> Shader * {
+    std::string key = "shader:";
+    for (uint32_t i = 0; i < SHADER_STAGE_COUNT; ++i) {
+        const ShaderStageLoadDesc &stage = desc.mStages[i];
+        if (stage.pFileName == nullptr) {
+            continue;
+        }
+
+        key += stage.pFileName;
+        if (stage.pEntryPointName != nullptr) {
+            key += "@";
+            key += stage.pEntryPointName;
+        }
+        for (uint32_t m = 0; m < stage.mMacroCount; ++m) {
+            key += "#";
+            key += stage.pMacros[m].definition;
+            key += "=";
+            key += stage.pMacros[m].value;
+        }
+        key += "|";
+    }
+    // Specialization constants follow the stages, each as its index and value bytes in hex.
+    for (uint32_t c = 0; c < desc.mConstantCount; ++c) {
+        const ShaderConstant &constant = desc.pConstants[c];
+        key += "$" + std::to_string(constant.mIndex) + "=";
+        for (uint32_t b = 0; b < constant.mSize; ++b) {
+            const uint8_t byte = ((const uint8_t *)constant.pValue)[b];
+            key += "0123456789abcdef"[byte >> 4];
+            key += "0123456789abcdef"[byte & 0xf];
+        }
+    }
+
+    if (void *pCached = Acquire(key)) {
+        return (Shader *)pCached;
+    }
+
+    Shader *pShader = nullptr;
+    addShader(pCacheRenderer, &desc, &pShader);
+    return (Shader *)Insert(key, ResourceType::Shader, pShader, 0);
+}
+
+void ReleaseShader(Shader *pShader) { Release(pShader); }
+
+auto ShaderSource(Shader *pShader) -> std::string {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+    auto key = gKeys.find(pShader);
+    return key != gKeys.end() ? key->second : std::string();
+}
+
+auto AcquireShader(const std::string &source) -> Shader * {
+    if (void *pCached = Acquire(source)) {
+        return (Shader *)pCached;
+    }
+
+    // Parsed back into a load description, the stages are in the order AcquireShader wrote them.
+    struct Stage {
+        std::string mFileName;
+        std::string mEntryPoint;
+        std::vector<std::string> mMacros;
+        std::vector<ShaderMacro> mMacroDescs;
+    };
+
+    const std::string prefix = "shader:";
+    if (source.compare(0, prefix.size(), prefix) != 0) {
+        LOGF(LogLevel::eERROR, "%s does not name a shader", source.c_str());
+        return nullptr;
+    }
+
+    std::vector<Stage> stages;
+    size_t begin = prefix.size();
+    for (size_t end; (end = source.find('|', begin)) != std::string::npos; begin = end + 1) {
+        const std::string stageKey = source.substr(begin, end - begin);
+        Stage stage = {};
+
+        size_t macro = stageKey.find('#');
+        const std::string file = stageKey.substr(0, macro);
+        const size_t at = file.find('@');
+        stage.mFileName = file.substr(0, at);
+        stage.mEntryPoint = at != std::string::npos ? file.substr(at + 1) : std::string();
+
+        while (macro != std::string::npos) {
+            const size_t next = stageKey.find('#', macro + 1);
+            const std::string definition = stageKey.substr(macro + 1, next - macro - 1);
+            const size_t equals = definition.find('=');
+            stage.mMacros.push_back(definition.substr(0, equals));
+            stage.mMacros.push_back(equals != std::string::npos ? definition.substr(equals + 1) : std::string());
+            macro = next;
+        }
+        stages.push_back(std::move(stage));
+    }
+
+    // Whatever follows the last stage are the constants, "$index=bytes" each.
+    std::vector<std::vector<uint8_t>> constantValues;
+    std::vector<ShaderConstant> constants;
+    for (size_t dollar = source.find('$', begin); dollar != std::string::npos;) {
+        const size_t next = source.find('$', dollar + 1);
+        const std::string constantKey = source.substr(dollar + 1, next - dollar - 1);
+        const size_t equals = constantKey.find('=');
+        const std::string hex = equals != std::string::npos ? constantKey.substr(equals + 1) : std::string();
+        if (equals == std::string::npos || equals == 0 || hex.size() % 2 != 0) {
+            LOGF(LogLevel::eERROR, "%s does not name a shader", source.c_str());
+            return nullptr;
+        }
+
+        std::vector<uint8_t> value(hex.size() / 2);
+        for (size_t b = 0; b < value.size(); ++b) {
+            value[b] = (uint8_t)std::stoul(hex.substr(b * 2, 2), nullptr, 16);
+        }
+        constants.push_back({nullptr, (uint32_t)std::stoul(constantKey.substr(0, equals)), (uint32_t)value.size()});
+        constantValues.push_back(std::move(value));
+        dollar = next;
+    }
+
+    if (stages.empty() || stages.size() > SHADER_STAGE_COUNT) {
+        LOGF(LogLevel::eERROR, "%s does not name a shader", source.c_str());
+        return nullptr;
+    }
+
+    ShaderLoadDesc desc = {};
+    for (size_t i = 0; i < stages.size(); ++i) {
+        Stage &stage = stages[i];
+        for (size_t m = 0; m < stage.mMacros.size(); m += 2) {
+            stage.mMacroDescs.push_back({stage.mMacros[m].c_str(), stage.mMacros[m + 1].c_str()});
+        }
+
+        ShaderStageLoadDesc &stageDesc = desc.mStages[i];
+        stageDesc.pFileName = stage.mFileName.c_str();
+        stageDesc.pEntryPointName = stage.mEntryPoint.empty() ? nullptr : stage.mEntryPoint.c_str();
+        stageDesc.pMacros = stage.mMacroDescs.data();
+        stageDesc.mMacroCount = (uint32_t)stage.mMacroDescs.size();
+    }
+    for (size_t c = 0; c < constants.size(); ++c) {
+        constants[c].pValue = constantValues[c].data();
+    }
+    desc.pConstants = constants.data();
+    desc.mConstantCount = (uint32_t)constants.size();
+    return AcquireShader(desc);
+}
+
+void RetainShader(Shader *pShader) {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    auto key = gKeys.find(pShader);
+    if (key == gKeys.end()) {
+        LOGF(LogLevel::eERROR, "Retaining a shader that is not in the cache");
+        return;
+    }
+    gEntries[key->second].mRefCount++;
+}
+
+auto AcquireBuffer(const char *pSource, const std::function<void(Buffer **ppBuffer, SyncToken *pToken)> &load)
+    -> Buffer * {
+    const std::string key = std::string("buffer:") + pSource;
+    if (void *pCached = Acquire(key)) {
+        return (Buffer *)pCached;
+    }
+
+    Buffer *pBuffer = nullptr;
+    SyncToken token = {};
+    load(&pBuffer, &token);
+    waitForToken(&token);
+
+    return (Buffer *)Insert(key, ResourceType::Buffer, pBuffer, pBuffer->mSize);
+}
+
+void ReleaseBuffer(Buffer *pBuffer) { Release(pBuffer); }
+
+auto AcquireTexture(const char *pFileName) -> Texture * {
+    const std::string key = std::string("texture:") + pFileName;
+    if (void *pCached = Acquire(key)) {
+        return (Texture *)pCached;
+    }
+
+    Texture *pTexture = nullptr;
+
+    TextureLoadDesc desc = {};
+    desc.pFileName = pFileName;
+    desc.ppTexture = &pTexture;
+
+    SyncToken token = {};
+    addResource(&desc, &token);
+    waitForToken(&token);
+
+    return (Texture *)Insert(key, ResourceType::Texture, pTexture, TextureBytes(pTexture));
+}
+
+void ReleaseTexture(Texture *pTexture) { Release(pTexture); }
+
+void PurgeResourceCache() {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    for (auto it = gEntries.begin(); it != gEntries.end();) {
+        if (it->second.mRefCount > 0) {
+            ++it;
+            continue;
+        }
+
+        RemoveEntry(it->second);
+        gKeys.erase(it->second.pResource);
+        it = gEntries.erase(it);
+    }
+}
+
+auto GetResourceCacheStats() -> ResourceCacheStats {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    ResourceCacheStats stats = {};
+    for (auto &[key, entry] : gEntries) {
+        stats.mAssetCount++;
+        stats.mUnreferencedCount += entry.mRefCount == 0 ? 1 : 0;
+        stats.mBytes += entry.mBytes;
+    }
+    stats.mUploadedBytes = gUploadedBytes;
+    return stats;
+}
+
+void LogResourceCache() {
+    std::lock_guard<std::mutex> lock(gCacheMutex);
+
+    for (auto &[key, entry] : gEntries) {
+        LOGF(LogLevel::eINFO, "%s: %u refs, %llu bytes", key.c_str(), entry.mRefCount, (unsigned long long)entry.mBytes);
+    }
+}
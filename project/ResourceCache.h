@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Shaders, buffers and textures shared by every scene, owned by MainApp.
+//
+// Assets are identified by where they come from: the shader stage files, macros and constants,
+// the file name of a texture, or a name chosen by the caller for generated buffers. Acquiring an
+// asset that is already cached only bumps its reference count. Released assets stay resident until
+// PurgeResourceCache, so switching between scenes that share content does not upload anything.
+
+void InitResourceCache(Renderer *pRenderer);
+void ExitResourceCache();
+
+auto AcquireShader(const ShaderLoadDesc &desc) -> Shader *;
+void ReleaseShader(Shader *pShader);
+// An extra reference for a holder that did not acquire the shader itself, released with ReleaseShader.
+void RetainShader(Shader *pShader);
+// The identity string a shader is cached under, stable from run to run. Empty for a shader that
+// did not come from AcquireShader.
+auto ShaderSource(Shader *pShader) -> std::string;
+// Acquires the shader a ShaderSource string names, loading it like AcquireShader would.
+auto AcquireShader(const std::string &source) -> Shader *;
+
+// load is only called on a miss, it must create the buffer with addResource into *ppBuffer and
+// pass pToken along, only that upload is waited on.
+auto AcquireBuffer(const char *pSource, const std::function<void(Buffer **ppBuffer, SyncToken *pToken)> &load)
+    -> Buffer *;
+void ReleaseBuffer(Buffer *pBuffer);
+
+auto AcquireTexture(const char *pFileName) -> Texture *;
+void ReleaseTexture(Texture *pTexture);
+
+// Removes every asset that is no longer referenced. The GPU must be done with them.
+void PurgeResourceCache();
+
+struct ResourceCacheStats {
+    uint32_t mAssetCount;
+    uint32_t mUnreferencedCount;
+    uint64_t mBytes;
+    uint64_t mUploadedBytes;
+};
+
+auto GetResourceCacheStats() -> ResourceCacheStats;
+// Writes one line per asset, with its reference count and size, to the log.
+void LogResourceCache();
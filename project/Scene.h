@@ -1,18 +1,45 @@
 #pragma once
 
-#include <functional>
+#include "RenderGraph.h"
 
 struct Cmd;
 struct Renderer;
 struct SwapChain;
 struct RenderTarget;
+class ICameraController;
 
+// Base of every scene, holding the optional members.
+//
+// A scene is a class deriving from Scene that defines
+//
+//     void Init(Renderer *pRenderer);
+//     void Exit(Renderer *pRenderer);
+//     auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+//     void Unload(Renderer *pRenderer);
+//     auto Update(float deltaTime) -> bool;
+//     void Draw(Cmd *cmd, int imageIndex);
+//
+// and hides whichever of the members below it needs. Update returns whether anything the scene
+// draws changed, the frame may be skipped otherwise, see IdleFrames.h.
+//
+// A scene keeps its state in its members, any number of instances can exist side by side. Scenes
+// are listed in SceneRegistry.h and called through AnyScene on their own type, nothing here is
+// virtual.
 struct Scene {
-    std::function<bool(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer)> Load;
-    std::function<void(float)> Update;
-    std::function<void(Cmd *cmd, int imageIndex)> Draw;
-    std::function<void()> DrawUI;
-    std::function<void(Renderer *pRenderer)> Unload;
-    std::function<void(Renderer *pRenderer)> Init;
-    std::function<void(Renderer *pRenderer)> Exit;
+    // Declares passes that run before Draw. Returns true when they write depthBuffer, the main pass
+    // then loads the depth instead of clearing it. Also where the frame's writes through the upload
+    // batcher belong, Draw runs after they are flushed.
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool { return false; }
+
+    // Camera driven by MainApp's camera input, nullptr for none.
+    auto Camera() -> ICameraController * { return nullptr; }
+
+    // Runs on a worker thread before Init, while another scene is shown or the app starts up. Only
+    // for CPU work like reading files ahead, see PrefetchResourceFile, nothing may touch the renderer
+    // or the resource loader: the D3D11 context is not thread safe and is in use on the main thread.
+    void Prepare() {}
+
+    // Called on the main thread once the scene is loaded and about to be shown, where UI is created.
+    void Activate() {}
+    void Deactivate() {}
 };
@@ -0,0 +1,60 @@
+#include "SceneRegistry.h"
+
+template <typename... SceneTypes>
+static void EmplaceScene(std::variant<NoScene, SceneTypes...> &scene, uint32_t index) {
+    using Variant = std::variant<NoScene, SceneTypes...>;
+    static constexpr void (*Emplace[])(Variant &) = {
+        [](Variant &scene) { scene.template emplace<SceneTypes>(); }...};
+
+    Emplace[index](scene);
+}
+
+void AnyScene::Create(uint32_t index) { EmplaceScene(mScene, index); }
+
+void AnyScene::Reset() { mScene.emplace<NoScene>(); }
+
+auto AnyScene::Empty() const -> bool { return std::holds_alternative<NoScene>(mScene); }
+
+void AnyScene::Prepare() {
+    std::visit([](auto &scene) { scene.Prepare(); }, mScene);
+}
+
+void AnyScene::Init(Renderer *pRenderer) {
+    std::visit([&](auto &scene) { scene.Init(pRenderer); }, mScene);
+}
+
+void AnyScene::Exit(Renderer *pRenderer) {
+    std::visit([&](auto &scene) { scene.Exit(pRenderer); }, mScene);
+}
+
+auto AnyScene::Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool {
+    return std::visit([&](auto &scene) { return scene.Load(pRenderer, pSwapChain, pDepthBuffer); }, mScene);
+}
+
+void AnyScene::Unload(Renderer *pRenderer) {
+    std::visit([&](auto &scene) { scene.Unload(pRenderer); }, mScene);
+}
+
+auto AnyScene::Update(float deltaTime) -> bool {
+    return std::visit([&](auto &scene) { return scene.Update(deltaTime); }, mScene);
+}
+
+auto AnyScene::AddPasses(int imageIndex, RGResource depthBuffer) -> bool {
+    return std::visit([&](auto &scene) { return scene.AddPasses(imageIndex, depthBuffer); }, mScene);
+}
+
+void AnyScene::Draw(Cmd *cmd, int imageIndex) {
+    std::visit([&](auto &scene) { scene.Draw(cmd, imageIndex); }, mScene);
+}
+
+auto AnyScene::Camera() -> ICameraController * {
+    return std::visit([](auto &scene) { return scene.Camera(); }, mScene);
+}
+
+void AnyScene::Activate() {
+    std::visit([](auto &scene) { scene.Activate(); }, mScene);
+}
+
+void AnyScene::Deactivate() {
+    std::visit([](auto &scene) { scene.Deactivate(); }, mScene);
+}
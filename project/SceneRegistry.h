@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Scene.h"
+
+#include "2.Lighting/Scene01Colors.h"
+#include "2.Lighting/Scene02BasicLighting.h"
+#include "3.ModelLoading/Scene01ModelLod.h"
+#include "4.Compute/Scene01Particles.h"
+#include "5.Streaming/Scene01TextureStreaming.h"
+
+#include <cstdint>
+#include <variant>
+
+// Held where there is no scene, every call does nothing.
+struct NoScene : Scene {
+    void Init(Renderer *pRenderer) {}
+    void Exit(Renderer *pRenderer) {}
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool { return true; }
+    void Unload(Renderer *pRenderer) {}
+    auto Update(float deltaTime) -> bool { return false; }
+    void Draw(Cmd *cmd, int imageIndex) {}
+};
+
+template <typename... SceneTypes> struct SceneList {
+    using Variant = std::variant<NoScene, SceneTypes...>;
+
+    static constexpr uint32_t Count = sizeof...(SceneTypes);
+    static constexpr const char *Names[Count] = {SceneTypes::Name...};
+};
+
+// Every scene, in the order the scene selector lists them under their Name.
+using Scenes = SceneList<Ch2Lighings::Scene01Colors, Ch2Lighings::Scene02BasicLighting,
+                         Ch3ModelLoading::Scene01ModelLod, Ch4Compute::Scene01Particles,
+                         Ch5Streaming::Scene01TextureStreaming>;
+
+// An instance of one of the scenes, or none. Each call switches once on the type of the scene held
+// and calls it directly.
+class AnyScene {
+  public:
+    // index into Scenes. The scene held before must have been unloaded and exited.
+    void Create(uint32_t index);
+    void Reset();
+    auto Empty() const -> bool;
+
+    void Prepare();
+    void Init(Renderer *pRenderer);
+    void Exit(Renderer *pRenderer);
+    auto Load(Renderer *pRenderer, SwapChain *pSwapChain, RenderTarget *pDepthBuffer) -> bool;
+    void Unload(Renderer *pRenderer);
+    auto Update(float deltaTime) -> bool;
+    auto AddPasses(int imageIndex, RGResource depthBuffer) -> bool;
+    void Draw(Cmd *cmd, int imageIndex);
+    auto Camera() -> ICameraController *;
+    void Activate();
+    void Deactivate();
+
+  private:
+    Scenes::Variant mScene;
+};
@@ -17,8 +17,8 @@ ECHO compile shader files.
 %PythonExec% %CompileShaders% -d %OutputDir%Shaders -b %OutputDir%CompiledShaders -s %SolutionDir% -w %WindowsSdkVerBinPath% %SolutionDir%the-forge\Common_3\OS\Fonts\Shaders\FSL
 %PythonExec% %CompileShaders% -d %OutputDir%Shaders -b %OutputDir%CompiledShaders -s %SolutionDir% -w %WindowsSdkVerBinPath% %ProjectDir%Shaders
 
-ECHO Copying texture files.
-XCOPY %ProjectDir%Textures\ %OutputDir%Textures\ /Y /S
+ECHO Compiling texture files.
+%OutputDir%texture-compiler.exe %ProjectDir%Textures %OutputDir%Textures
 
 ECHO Copying meshes files
 XCOPY %ProjectDir%Meshes\ %OutputDir%Meshes\ /Y /S
@@ -30,4 +30,7 @@ ECHO Copying dll files.
 XCOPY %ProjectDir%DLLs\ %OutputDir% /Y /S
 
 ECHO Copying GPU config file
-XCOPY %ProjectDir%GPUCfg\ %OutputDir%GPUCfg\ /Y /S
\ No newline at end of file
+XCOPY %ProjectDir%GPUCfg\ %OutputDir%GPUCfg\ /Y /S
+
+ECHO Packing asset files.
+%OutputDir%asset-packer.exe --lz4 %OutputDir%Assets.pack %OutputDir% Shaders GPUCfg Textures Meshes Fonts
\ No newline at end of file
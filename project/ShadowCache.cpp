@@ -0,0 +1,182 @@
+#include "ShadowCache.h"
+
+#include "DescriptorCache.h"
+#include "MemoryBudget.h"
+#include "PipelineStateCache.h"
+#include "RenderGraph.h"
+#include "ResourceCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr TinyImageFormat Format = TinyImageFormat_D32_SFLOAT;
+} // namespace
+
+void InitShadowCache(ShadowCache &cache, Renderer *pRenderer) {
+    {
+        ShaderLoadDesc desc{};
+        desc.mStages[0] = {"upscale.vert", nullptr, 0};
+        desc.mStages[1] = {"shadow_copy.frag", nullptr, 0};
+        cache.pCopyShader = AcquireShader(desc);
+    }
+
+    cache.pRootSignature = AcquireRootSignature(&cache.pCopyShader, 1);
+}
+
+void ExitShadowCache(ShadowCache &cache, Renderer *pRenderer) {
+    ReleaseRootSignature(cache.pRootSignature);
+    ReleaseShader(cache.pCopyShader);
+}
+
+auto LoadShadowCache(ShadowCache &cache, Renderer *pRenderer) -> bool {
+    {
+        RenderTargetDesc desc = {};
+        desc.mArraySize = 1;
+        desc.mClearValue.depth = 0.0f;
+        desc.mClearValue.stencil = 0;
+        desc.mDepth = 1;
+        desc.mFormat = Format;
+        desc.mStartState = RESOURCE_STATE_SHADER_RESOURCE;
+        desc.mWidth = ShadowMapSize;
+        desc.mHeight = ShadowMapSize;
+        desc.mSampleCount = SAMPLE_COUNT_1;
+        desc.mSampleQuality = 0;
+        desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+
+        desc.pName = "Static Shadow Map";
+        AddTrackedRenderTarget(pRenderer, &desc, &cache.pStaticShadowMap);
+        desc.pName = "Shadow Map";
+        AddTrackedRenderTarget(pRenderer, &desc, &cache.pShadowMap);
+    }
+
+    if (cache.pStaticShadowMap == nullptr || cache.pShadowMap == nullptr) {
+        return false;
+    }
+
+    {
+        cache.mCopyDescriptors = AllocateDescriptors(cache.pRootSignature, DESCRIPTOR_UPDATE_FREQ_NONE, 1);
+
+        DescriptorData param = {};
+        param.pName = "staticShadowMap";
+        param.ppTextures = &cache.pStaticShadowMap->pTexture;
+        UpdateDescriptors(cache.mCopyDescriptors, 0, 1, &param);
+    }
+
+    {
+        RasterizerStateDesc rasterizerStateDesc = {};
+        rasterizerStateDesc.mCullMode = CULL_MODE_NONE;
+
+        // Every texel is overwritten.
+        DepthStateDesc depthStateDesc = {};
+        depthStateDesc.mDepthTest = true;
+        depthStateDesc.mDepthWrite = true;
+        depthStateDesc.mDepthFunc = CMP_ALWAYS;
+
+        PipelineDesc desc = {};
+        desc.mType = PIPELINE_TYPE_GRAPHICS;
+
+        GraphicsPipelineDesc &pipelineSettings = desc.mGraphicsDesc;
+        pipelineSettings.mPrimitiveTopo = PRIMITIVE_TOPO_TRI_LIST;
+        pipelineSettings.mRenderTargetCount = 0;
+        pipelineSettings.pDepthState = &depthStateDesc;
+        pipelineSettings.mSampleCount = SAMPLE_COUNT_1;
+        pipelineSettings.mSampleQuality = 0;
+        pipelineSettings.mDepthStencilFormat = Format;
+        pipelineSettings.pRootSignature = cache.pRootSignature;
+        pipelineSettings.pRasterizerState = &rasterizerStateDesc;
+        pipelineSettings.pShaderProgram = cache.pCopyShader;
+        cache.pCopyPipeline = AcquirePipeline(desc);
+    }
+
+    // The maps are new.
+    cache.bStaticValid = false;
+    cache.bShadowMapHasDynamic = false;
+    cache.mStats = {};
+
+    return true;
+}
+
+void UnloadShadowCache(ShadowCache &cache, Renderer *pRenderer) {
+    ReleasePipeline(cache.pCopyPipeline);
+    FreeDescriptors(cache.mCopyDescriptors);
+    RemoveTrackedRenderTarget(pRenderer, cache.pStaticShadowMap);
+    RemoveTrackedRenderTarget(pRenderer, cache.pShadowMap);
+}
+
+auto ShadowMapFormat() -> TinyImageFormat { return Format; }
+
+auto ShadowMapTexture(const ShadowCache &cache) -> Texture * { return cache.pShadowMap->pTexture; }
+
+static void CmdBeginShadowMap(Cmd *cmd, RenderTarget *pTarget, LoadActionType loadAction) {
+    RenderTargetBarrier barrier = {pTarget, RESOURCE_STATE_SHADER_RESOURCE, RESOURCE_STATE_DEPTH_WRITE};
+    cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    LoadActionsDesc loadActions = {};
+    loadActions.mLoadActionDepth = loadAction;
+    loadActions.mClearDepth = pTarget->mClearValue;
+    cmdBindRenderTargets(cmd, 0, nullptr, pTarget, &loadActions, nullptr, nullptr, -1, -1);
+    cmdSetViewport(cmd, 0.0F, 0.0F, (float)ShadowMapSize, (float)ShadowMapSize, 0.0F, 1.0F);
+    cmdSetScissor(cmd, 0, 0, ShadowMapSize, ShadowMapSize);
+}
+
+static void CmdEndShadowMap(Cmd *cmd, RenderTarget *pTarget) {
+    cmdBindRenderTargets(cmd, 0, nullptr, nullptr, nullptr, nullptr, nullptr, -1, -1);
+
+    RenderTargetBarrier barrier = {pTarget, RESOURCE_STATE_DEPTH_WRITE, RESOURCE_STATE_SHADER_RESOURCE};
+    cmdResourceBarrier(cmd, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void AddShadowCachePasses(ShadowCache &cache, const ShadowCacheParams &params,
+                          std::function<void(Cmd *cmd)> drawStaticCasters,
+                          std::function<void(Cmd *cmd)> drawDynamicCasters) {
+    const bool lightMoved = memcmp(&params.mLightViewProjection, &cache.mStaticLightViewProjection,
+                                   sizeof(cache.mStaticLightViewProjection)) != 0;
+    const bool renderStatic =
+        !params.mCacheEnabled || !cache.bStaticValid || lightMoved || params.mStaticVersion != cache.mStaticVersion;
+    const bool composite = renderStatic || params.mHasDynamicCasters || cache.bShadowMapHasDynamic;
+
+    (params.mCacheEnabled ? cache.mCachedFrameMs : cache.mUncachedFrameMs) = getGpuProfileAvgTime(GpuProfileToken());
+    if (cache.mCachedFrameMs > 0.0f && cache.mUncachedFrameMs > 0.0f) {
+        cache.mStats.mSavedMsPerFrame = std::max(cache.mUncachedFrameMs - cache.mCachedFrameMs, 0.0f);
+    }
+
+    if (renderStatic) {
+        cache.mStats.mRenderedFrames++;
+
+        cache.bStaticValid = params.mStaticReady;
+        cache.mStaticLightViewProjection = params.mLightViewProjection;
+        cache.mStaticVersion = params.mStaticVersion;
+
+        RGPass pass = AddRenderGraphPass("Static Shadows", [&cache, drawStaticCasters](Cmd *cmd) {
+            CmdBeginShadowMap(cmd, cache.pStaticShadowMap, LOAD_ACTION_CLEAR);
+            drawStaticCasters(cmd);
+            CmdEndShadowMap(cmd, cache.pStaticShadowMap);
+        });
+        PassSideEffect(pass);
+    } else {
+        cache.mStats.mReusedFrames++;
+        cache.mStats.mSavedMs += cache.mStats.mSavedMsPerFrame;
+    }
+
+    if (composite) {
+        const bool hasDynamic = params.mHasDynamicCasters;
+        cache.bShadowMapHasDynamic = hasDynamic;
+
+        RGPass pass = AddRenderGraphPass("Dynamic Shadows", [&cache, drawDynamicCasters, hasDynamic](Cmd *cmd) {
+            CmdBeginShadowMap(cmd, cache.pShadowMap, LOAD_ACTION_DONTCARE);
+
+            cmdBindPipeline(cmd, cache.pCopyPipeline);
+            CmdBindDescriptors(cmd, cache.mCopyDescriptors, 0);
+            cmdDraw(cmd, 3, 0);
+
+            if (hasDynamic) {
+                drawDynamicCasters(cmd);
+            }
+            CmdEndShadowMap(cmd, cache.pShadowMap);
+        });
+        PassSideEffect(pass);
+    }
+}
+
+auto GetShadowCacheStats(const ShadowCache &cache) -> ShadowCacheStats { return cache.mStats; }
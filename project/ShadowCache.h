@@ -0,0 +1,83 @@
+#pragma once
+
+#include "DescriptorCache.h"
+#include "MainApp.h"
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+#include <functional>
+
+// Shadow map of one light that only renders again what changed.
+//
+// Two depth maps are kept. The static map holds the casters that do not move and is rendered
+// again only when the light's view projection, the version of the static casters or the static
+// map itself changes. The shadow map the scene samples is the static map copied, with the casters
+// that move drawn on top. Without any moving casters the copy is skipped too, the shadow map of
+// the previous frame still holds. Depth is reverse-Z like the scene's.
+//
+// Both maps are in RESOURCE_STATE_SHADER_RESOURCE outside the passes, which bind the map they
+// draw to themselves. A ShadowCache holds the two maps of one light.
+
+constexpr uint32_t ShadowMapSize = 2048;
+
+struct ShadowCacheParams {
+    mat4 mLightViewProjection;
+    // Changes whenever a static caster is added, removed or moved.
+    uint32_t mStaticVersion;
+    // False while the static casters of this frame are incomplete, e.g. their transforms are still
+    // being uploaded. The map is rendered but not kept.
+    bool mStaticReady;
+    bool mHasDynamicCasters;
+    // Off renders the static map every frame, as a baseline.
+    bool mCacheEnabled;
+};
+
+// Frames count from Load, the time saved is estimated from the average GPU frame time with the
+// cache on and with it off, once both have been seen.
+struct ShadowCacheStats {
+    uint32_t mRenderedFrames;
+    uint32_t mReusedFrames;
+    float mSavedMsPerFrame;
+    float mSavedMs;
+};
+
+struct ShadowCache {
+    Shader *pCopyShader = nullptr;
+    RootSignature *pRootSignature = nullptr;
+    Pipeline *pCopyPipeline = nullptr;
+
+    RenderTarget *pStaticShadowMap = nullptr;
+    RenderTarget *pShadowMap = nullptr;
+    DescriptorRange mCopyDescriptors = {};
+
+    // What the static map was rendered for.
+    bool bStaticValid = false;
+    mat4 mStaticLightViewProjection = mat4::identity();
+    uint32_t mStaticVersion = 0;
+    // Whether the shadow map holds any dynamic casters, which have to be cleared once they are gone.
+    bool bShadowMapHasDynamic = false;
+
+    // Average GPU frame time, sampled with the cache on and off.
+    float mCachedFrameMs = 0.0f;
+    float mUncachedFrameMs = 0.0f;
+    ShadowCacheStats mStats = {};
+};
+
+void InitShadowCache(ShadowCache &cache, Renderer *pRenderer);
+void ExitShadowCache(ShadowCache &cache, Renderer *pRenderer);
+
+auto LoadShadowCache(ShadowCache &cache, Renderer *pRenderer) -> bool;
+void UnloadShadowCache(ShadowCache &cache, Renderer *pRenderer);
+
+auto ShadowMapFormat() -> TinyImageFormat;
+// The map to sample, stays the same from Load to Unload.
+auto ShadowMapTexture(const ShadowCache &cache) -> Texture *;
+
+// Call once per frame from the scene's AddPasses. The draw functions run inside the passes with
+// the map bound and must draw the casters with a depth only pipeline for ShadowMapFormat.
+void AddShadowCachePasses(ShadowCache &cache, const ShadowCacheParams &params,
+                          std::function<void(Cmd *cmd)> drawStaticCasters,
+                          std::function<void(Cmd *cmd)> drawDynamicCasters);
+
+auto GetShadowCacheStats(const ShadowCache &cache) -> ShadowCacheStats;
@@ -0,0 +1,105 @@
+#include "StartupTimeline.h"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+#include <Common_3/OS/Interfaces/ILog.h>
+
+namespace {
+struct StageRecord {
+    const char *pName;
+    int64_t mStartUSec;
+    int64_t mEndUSec;
+    // Index into gThreads, 0 is the thread that began the timeline.
+    uint32_t mThread;
+};
+
+std::chrono::steady_clock::time_point gTimelineStart;
+std::mutex gStagesMutex;
+std::vector<StageRecord> gStages;
+std::vector<std::thread::id> gThreads;
+
+bool bTimelineRunning = false;
+int64_t gFirstFrameUSec = 0;
+} // namespace
+
+static auto ElapsedUSec() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - gTimelineStart)
+        .count();
+}
+
+static void WriteTimeline() {
+    std::string json = "{\n  \"timeToFirstFrameMs\": ";
+    char line[256];
+    snprintf(line, sizeof(line), "%.3f,\n  \"stages\": [\n", gFirstFrameUSec / 1000.0);
+    json += line;
+
+    LOGF(LogLevel::eINFO, "Startup timeline, first frame after %.3f ms", gFirstFrameUSec / 1000.0);
+    for (size_t i = 0; i < gStages.size(); ++i) {
+        const StageRecord &stage = gStages[i];
+        const double startMs = stage.mStartUSec / 1000.0;
+        const double durationMs = (stage.mEndUSec - stage.mStartUSec) / 1000.0;
+        LOGF(LogLevel::eINFO, "  %-24s thread %u, start %9.3f ms, took %9.3f ms", stage.pName, stage.mThread, startMs,
+             durationMs);
+
+        snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"startMs\": %.3f, \"durationMs\": %.3f, \"thread\": %u}%s\n",
+                 stage.pName, startMs, durationMs, stage.mThread, i + 1 < gStages.size() ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_LOG, "startup_timeline.json", FM_WRITE, nullptr, &file)) {
+        LOGF(LogLevel::eWARNING, "Could not write startup_timeline.json");
+        return;
+    }
+    fsWriteToStream(&file, json.data(), json.size());
+    fsCloseStream(&file);
+}
+
+void BeginStartupTimeline() {
+    gTimelineStart = std::chrono::steady_clock::now();
+    gStages.clear();
+    gThreads.assign(1, std::this_thread::get_id());
+    gFirstFrameUSec = 0;
+    bTimelineRunning = true;
+}
+
+StartupStage::StartupStage(const char *pName) : pName(pName), mStartUSec(ElapsedUSec()) {}
+
+StartupStage::~StartupStage() {
+    if (!bTimelineRunning) {
+        return;
+    }
+
+    const int64_t endUSec = ElapsedUSec();
+
+    std::lock_guard<std::mutex> lock(gStagesMutex);
+    uint32_t thread = 0;
+    while (thread < gThreads.size() && gThreads[thread] != std::this_thread::get_id()) {
+        ++thread;
+    }
+    if (thread == gThreads.size()) {
+        gThreads.push_back(std::this_thread::get_id());
+    }
+    gStages.push_back({pName, mStartUSec, endUSec, thread});
+}
+
+void MarkFirstFrame() {
+    if (!bTimelineRunning) {
+        return;
+    }
+
+    gFirstFrameUSec = ElapsedUSec();
+    bTimelineRunning = false;
+
+    std::lock_guard<std::mutex> lock(gStagesMutex);
+    WriteTimeline();
+}
+
+auto TimeToFirstFrameMs() -> float { return gFirstFrameUSec / 1000.0f; }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Wall time of each startup stage, from the start of Init to the first presented frame.
+//
+// Stages may run on worker threads and overlap. Once the first frame is presented the timeline is
+// written to the log and to startup_timeline.json in the log directory.
+
+void BeginStartupTimeline();
+
+// Records the wall time from construction to destruction as one stage.
+class StartupStage {
+  public:
+    explicit StartupStage(const char *pName);
+    ~StartupStage();
+
+    StartupStage(const StartupStage &) = delete;
+    auto operator=(const StartupStage &) -> StartupStage & = delete;
+
+  private:
+    const char *pName;
+    int64_t mStartUSec;
+};
+
+// Only the first call after BeginStartupTimeline has any effect.
+void MarkFirstFrame();
+
+// Zero until the first frame has been presented.
+auto TimeToFirstFrameMs() -> float;
@@ -0,0 +1,647 @@
+#include "TextureStreamer.h"
+
+#include "MainApp.h"
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <Common_3/OS/Interfaces/IFileSystem.h>
+#include <Common_3/OS/Interfaces/ILog.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+constexpr uint32_t MaxMips = 16;
+// Loads in flight, swaps and evictions alike. Keeps the loader's staging memory for everything else.
+constexpr uint32_t MaxPendingLoads = 2;
+// Frames without a size request before a texture only wants its tail.
+constexpr uint64_t IdleFrames = 120;
+
+constexpr uint32_t DdsMagic = 0x20534444; // "DDS "
+constexpr uint32_t DdsHeaderSize = 124;
+constexpr uint32_t DdsDx10HeaderSize = 20;
+constexpr uint32_t DdsdMipMapCount = 0x20000;
+constexpr uint32_t DdpfFourCc = 0x4;
+constexpr uint32_t DdsResourceMiscTextureCube = 0x4;
+constexpr uint32_t ResourceDimensionTexture2D = 3;
+
+constexpr auto FourCc(char a, char b, char c, char d) -> uint32_t {
+    return (uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24;
+}
+
+struct DdsFormat {
+    uint32_t mDxgiFormat;
+    uint32_t mFourCc;
+    TinyImageFormat mFormat;
+    // Bytes per 4x4 block, or per texel for uncompressed formats.
+    uint32_t mBlockBytes;
+    uint32_t mBlockSize;
+};
+
+// What the texture compiler writes and what usually comes out of other DDS tools.
+const DdsFormat gDdsFormats[] = {
+    {28, 0, TinyImageFormat_R8G8B8A8_UNORM, 4, 1},
+    {29, 0, TinyImageFormat_R8G8B8A8_SRGB, 4, 1},
+    {71, FourCc('D', 'X', 'T', '1'), TinyImageFormat_DXBC1_RGBA_UNORM, 8, 4},
+    {72, 0, TinyImageFormat_DXBC1_RGBA_SRGB, 8, 4},
+    {77, FourCc('D', 'X', 'T', '5'), TinyImageFormat_DXBC3_UNORM, 16, 4},
+    {78, 0, TinyImageFormat_DXBC3_SRGB, 16, 4},
+    {80, FourCc('A', 'T', 'I', '1'), TinyImageFormat_DXBC4_UNORM, 8, 4},
+    {83, FourCc('A', 'T', 'I', '2'), TinyImageFormat_DXBC5_UNORM, 16, 4},
+    {98, 0, TinyImageFormat_DXBC7_UNORM, 16, 4},
+    {99, 0, TinyImageFormat_DXBC7_SRGB, 16, 4},
+};
+
+// Where each level of a DDS file is, levels are stored largest first.
+struct DdsLayout {
+    TinyImageFormat mFormat;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mMipCount;
+    std::array<uint64_t, MaxMips> mLevelOffsets;
+    std::array<uint64_t, MaxMips> mLevelBytes;
+};
+
+struct StreamedEntry {
+    std::string mFileName;
+    DdsLayout mLayout;
+    uint32_t mRefCount;
+    // Bumped whenever the slot is freed, so loads finishing for a released texture are dropped.
+    uint32_t mGeneration;
+    Texture *pTexture;
+    // Largest mip of pTexture.
+    uint32_t mResidentMip;
+    // Smallest mip ever resident, everything below it is the tail.
+    uint32_t mTailMip;
+    uint32_t mPendingMip;
+    bool bLoading;
+    bool bFailed;
+    float mRequestedPixels;
+    uint64_t mLastRequestFrame;
+};
+
+struct StreamJob {
+    uint32_t mTexture;
+    uint32_t mGeneration;
+    uint32_t mFirstMip;
+    std::string mFileName;
+    DdsLayout mLayout;
+    // The levels read by the streamer's thread, freed once they are handed to the resource loader.
+    std::vector<uint8_t> mData;
+    Texture *pTexture;
+    SyncToken mToken;
+    bool bFailed;
+};
+
+struct RetiredTexture {
+    Texture *pTexture;
+    uint64_t mFrame;
+};
+
+Texture *pPlaceholderTexture = nullptr;
+
+std::vector<StreamedEntry> gTextures;
+std::unordered_map<std::string, uint32_t> gTextureIndices;
+std::vector<uint32_t> gFreeTextures;
+std::vector<RetiredTexture> gRetiredTextures;
+
+MemoryOwner gMemoryOwner = 0;
+uint64_t gBudgetBytes = 0;
+uint64_t gFrame = 0;
+uint32_t gPendingLoads = 0;
+uint32_t gEvictions = 0;
+std::atomic<uint64_t> gStreamedBytes{0};
+
+// Jobs are only read from disk on this thread, the renderer is not used off the main thread.
+std::thread gStreamerThread;
+std::mutex gJobMutex;
+std::condition_variable gJobCondition;
+std::deque<StreamJob> gQueuedJobs;
+std::vector<StreamJob> gFinishedJobs;
+bool bStopping = false;
+// Read jobs taken over by the main thread, uploading until their token completes.
+std::vector<StreamJob> gUploadingJobs;
+} // namespace
+
+static auto LevelBytes(const DdsFormat &format, uint32_t width, uint32_t height) -> uint64_t {
+    const uint32_t blocksWide = std::max(1u, (width + format.mBlockSize - 1) / format.mBlockSize);
+    const uint32_t blocksHigh = std::max(1u, (height + format.mBlockSize - 1) / format.mBlockSize);
+    return (uint64_t)blocksWide * blocksHigh * format.mBlockBytes;
+}
+
+static auto ReadDdsLayout(const char *pFileName, DdsLayout *pLayout) -> bool {
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_TEXTURES, pFileName, FM_READ_BINARY, nullptr, &file)) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s not found", pFileName);
+        return false;
+    }
+
+    uint32_t magic = 0;
+    uint32_t header[DdsHeaderSize / 4] = {};
+    uint32_t dx10[DdsDx10HeaderSize / 4] = {};
+    bool read = fsReadFromStream(&file, &magic, sizeof(magic)) == sizeof(magic) && magic == DdsMagic &&
+                fsReadFromStream(&file, header, sizeof(header)) == sizeof(header);
+
+    // DDS_HEADER as dwords: flags at 1, height 2, width 3, mip count 6, pixel format flags 19 and
+    // FourCC 20.
+    const bool hasDx10 = read && (header[19] & DdpfFourCc) && header[20] == FourCc('D', 'X', '1', '0');
+    if (hasDx10) {
+        read = fsReadFromStream(&file, dx10, sizeof(dx10)) == sizeof(dx10);
+    }
+    const ssize_t fileSize = fsGetStreamFileSize(&file);
+    fsCloseStream(&file);
+
+    if (!read) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s is not a DDS file", pFileName);
+        return false;
+    }
+    if (hasDx10 && (dx10[1] != ResourceDimensionTexture2D || dx10[3] > 1 || (dx10[2] & DdsResourceMiscTextureCube))) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s is not a single 2D texture", pFileName);
+        return false;
+    }
+
+    const DdsFormat *pFormat = nullptr;
+    for (const DdsFormat &format : gDdsFormats) {
+        if (hasDx10 ? format.mDxgiFormat == dx10[0] : format.mFourCc != 0 && format.mFourCc == header[20]) {
+            pFormat = &format;
+        }
+    }
+    if (pFormat == nullptr) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s has an unsupported format", pFileName);
+        return false;
+    }
+
+    pLayout->mFormat = pFormat->mFormat;
+    pLayout->mHeight = header[2];
+    pLayout->mWidth = header[3];
+    pLayout->mMipCount = std::min(MaxMips, (header[1] & DdsdMipMapCount) ? std::max(1u, header[6]) : 1u);
+
+    uint64_t offset = sizeof(magic) + DdsHeaderSize + (hasDx10 ? DdsDx10HeaderSize : 0);
+    for (uint32_t mip = 0; mip < pLayout->mMipCount; ++mip) {
+        pLayout->mLevelOffsets[mip] = offset;
+        pLayout->mLevelBytes[mip] = LevelBytes(*pFormat, std::max(1u, pLayout->mWidth >> mip),
+                                               std::max(1u, pLayout->mHeight >> mip));
+        offset += pLayout->mLevelBytes[mip];
+    }
+    if (offset > (uint64_t)fileSize) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s is truncated", pFileName);
+        return false;
+    }
+    return true;
+}
+
+// Bytes of a texture holding firstMip and every smaller level.
+static auto MipChainBytes(const DdsLayout &layout, uint32_t firstMip) -> uint64_t {
+    uint64_t bytes = 0;
+    for (uint32_t mip = firstMip; mip < layout.mMipCount; ++mip) {
+        bytes += layout.mLevelBytes[mip];
+    }
+    return bytes;
+}
+
+// Reads the levels from firstMip down, as they are stored. Safe on any thread.
+static auto ReadMipChain(const std::string &fileName, const DdsLayout &layout, uint32_t firstMip,
+                         std::vector<uint8_t> *pData) -> bool {
+    pData->resize(MipChainBytes(layout, firstMip));
+
+    FileStream file = {};
+    if (!fsOpenStreamFromPath(RD_TEXTURES, fileName.c_str(), FM_READ_BINARY, nullptr, &file)) {
+        return false;
+    }
+    const bool read = fsSeekStream(&file, SBO_START_OF_FILE, (ssize_t)layout.mLevelOffsets[firstMip]) &&
+                      fsReadFromStream(&file, pData->data(), pData->size()) == pData->size();
+    fsCloseStream(&file);
+    if (!read) {
+        return false;
+    }
+    gStreamedBytes += pData->size();
+    return true;
+}
+
+// Creates a texture of the levels read by ReadMipChain and queues their upload. Main thread only.
+static void CreateMipChain(const std::string &fileName, const DdsLayout &layout, uint32_t firstMip,
+                           const std::vector<uint8_t> &data, Texture **ppTexture, SyncToken *pToken) {
+    TextureDesc desc = {};
+    desc.mWidth = std::max(1u, layout.mWidth >> firstMip);
+    desc.mHeight = std::max(1u, layout.mHeight >> firstMip);
+    desc.mDepth = 1;
+    desc.mArraySize = 1;
+    desc.mMipLevels = layout.mMipCount - firstMip;
+    desc.mSampleCount = SAMPLE_COUNT_1;
+    desc.mFormat = layout.mFormat;
+    desc.mStartState = RESOURCE_STATE_COPY_DEST;
+    desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    desc.pName = fileName.c_str();
+
+    TextureLoadDesc loadDesc = {};
+    loadDesc.pDesc = &desc;
+    loadDesc.ppTexture = ppTexture;
+    addResource(&loadDesc, nullptr);
+
+    const uint8_t *pSource = data.data();
+    for (uint32_t mip = firstMip; mip < layout.mMipCount; ++mip) {
+        TextureUpdateDesc update = {};
+        update.pTexture = *ppTexture;
+        update.mMipLevel = mip - firstMip;
+        beginUpdateResource(&update);
+        for (uint32_t row = 0; row < update.mRowCount; ++row) {
+            memcpy(update.pMappedData + (size_t)row * update.mDstRowStride, pSource + (size_t)row * update.mSrcRowStride,
+                   update.mSrcRowStride);
+        }
+        endUpdateResource(&update, pToken);
+        pSource += layout.mLevelBytes[mip];
+    }
+}
+
+static void StreamerThread() {
+    for (;;) {
+        StreamJob job;
+        {
+            std::unique_lock<std::mutex> lock(gJobMutex);
+            gJobCondition.wait(lock, [] { return bStopping || !gQueuedJobs.empty(); });
+            if (bStopping) {
+                return;
+            }
+            job = std::move(gQueuedJobs.front());
+            gQueuedJobs.pop_front();
+        }
+
+        job.bFailed = !ReadMipChain(job.mFileName, job.mLayout, job.mFirstMip, &job.mData);
+
+        std::lock_guard<std::mutex> lock(gJobMutex);
+        gFinishedJobs.push_back(std::move(job));
+    }
+}
+
+static void RetireTexture(Texture *pTexture) {
+    if (pTexture != nullptr) {
+        gRetiredTextures.push_back({pTexture, gFrame});
+    }
+}
+
+static void StartLoad(uint32_t index, uint32_t firstMip) {
+    StreamedEntry &entry = gTextures[index];
+    entry.bLoading = true;
+    entry.mPendingMip = firstMip;
+    gPendingLoads++;
+
+    std::lock_guard<std::mutex> lock(gJobMutex);
+    gQueuedJobs.push_back({index, entry.mGeneration, firstMip, entry.mFileName, entry.mLayout, {}, nullptr, {}, false});
+    gJobCondition.notify_one();
+}
+
+void InitTextureStreamer(Renderer *pRenderer, uint64_t budgetBytes) {
+    gMemoryOwner = InternMemoryOwner("Texture Streaming");
+    gBudgetBytes = budgetBytes;
+    gFrame = 0;
+    gPendingLoads = 0;
+    gEvictions = 0;
+    gStreamedBytes = 0;
+
+    TextureDesc desc = {};
+    desc.mWidth = 1;
+    desc.mHeight = 1;
+    desc.mDepth = 1;
+    desc.mArraySize = 1;
+    desc.mMipLevels = 1;
+    desc.mSampleCount = SAMPLE_COUNT_1;
+    desc.mFormat = TinyImageFormat_R8G8B8A8_UNORM;
+    desc.mStartState = RESOURCE_STATE_COPY_DEST;
+    desc.mDescriptors = DESCRIPTOR_TYPE_TEXTURE;
+    desc.pName = "Streaming Placeholder";
+
+    TextureLoadDesc loadDesc = {};
+    loadDesc.pDesc = &desc;
+    loadDesc.ppTexture = &pPlaceholderTexture;
+    AddTrackedResource(&loadDesc, NULL);
+
+    TextureUpdateDesc update = {};
+    update.pTexture = pPlaceholderTexture;
+    beginUpdateResource(&update);
+    memset(update.pMappedData, 0xff, 4);
+    endUpdateResource(&update, NULL);
+    waitForAllResourceLoads();
+
+    bStopping = false;
+    gStreamerThread = std::thread(StreamerThread);
+}
+
+void ExitTextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(gJobMutex);
+        bStopping = true;
+        gQueuedJobs.clear();
+    }
+    gJobCondition.notify_one();
+    gStreamerThread.join();
+    waitForAllResourceLoads();
+
+    gFinishedJobs.clear();
+    for (StreamJob &job : gUploadingJobs) {
+        if (job.pTexture != nullptr) {
+            removeResource(job.pTexture);
+        }
+    }
+    gUploadingJobs.clear();
+
+    for (RetiredTexture &retired : gRetiredTextures) {
+        UntrackAllocation(retired.pTexture);
+        removeResource(retired.pTexture);
+    }
+    gRetiredTextures.clear();
+
+    for (StreamedEntry &entry : gTextures) {
+        if (entry.mRefCount == 0) {
+            continue;
+        }
+        LOGF(LogLevel::eWARNING, "Streamed texture %s still referenced %u times on exit", entry.mFileName.c_str(),
+             entry.mRefCount);
+        UntrackAllocation(entry.pTexture);
+        removeResource(entry.pTexture);
+    }
+    gTextures.clear();
+    gTextureIndices.clear();
+    gFreeTextures.clear();
+
+    RemoveTrackedResource(pPlaceholderTexture);
+    pPlaceholderTexture = nullptr;
+}
+
+auto AcquireStreamedTexture(const char *pFileName) -> StreamedTexture {
+    auto found = gTextureIndices.find(pFileName);
+    if (found != gTextureIndices.end()) {
+        gTextures[found->second].mRefCount++;
+        return found->second;
+    }
+
+    // The header and the tail are read and uploaded right away, as the scene loads.
+    StreamedEntry entry = {};
+    entry.mFileName = pFileName;
+    if (!ReadDdsLayout(pFileName, &entry.mLayout)) {
+        return InvalidStreamedTexture;
+    }
+    const DdsLayout &layout = entry.mLayout;
+    entry.mTailMip = 0;
+    while (entry.mTailMip + 1 < layout.mMipCount &&
+           std::max(layout.mWidth, layout.mHeight) >> entry.mTailMip > StreamingTailSize) {
+        entry.mTailMip++;
+    }
+    entry.mResidentMip = entry.mTailMip;
+    entry.mRefCount = 1;
+
+    std::vector<uint8_t> data;
+    if (!ReadMipChain(entry.mFileName, layout, entry.mTailMip, &data)) {
+        LOGF(LogLevel::eERROR, "Streamed texture %s could not be read", pFileName);
+        return InvalidStreamedTexture;
+    }
+    SyncToken token = {};
+    CreateMipChain(entry.mFileName, layout, entry.mTailMip, data, &entry.pTexture, &token);
+    waitForToken(&token);
+
+    {
+        MemoryScope memory(gMemoryOwner);
+        TrackGpuAllocation(entry.pTexture, MipChainBytes(layout, entry.mResidentMip));
+    }
+
+    uint32_t index = (uint32_t)gTextures.size();
+    if (!gFreeTextures.empty()) {
+        index = gFreeTextures.back();
+        gFreeTextures.pop_back();
+        entry.mGeneration = gTextures[index].mGeneration;
+        gTextures[index] = std::move(entry);
+    } else {
+        gTextures.push_back(std::move(entry));
+    }
+    gTextureIndices[pFileName] = index;
+    return index;
+}
+
+void ReleaseStreamedTexture(StreamedTexture texture) {
+    if (texture == InvalidStreamedTexture) {
+        return;
+    }
+
+    StreamedEntry &entry = gTextures[texture];
+    if (entry.mRefCount == 0) {
+        LOGF(LogLevel::eERROR, "Releasing streamed texture %u more times than it was acquired", texture);
+        return;
+    }
+    if (--entry.mRefCount > 0) {
+        return;
+    }
+
+    // A load still in flight is dropped when it finishes.
+    RetireTexture(entry.pTexture);
+    gTextureIndices.erase(entry.mFileName);
+    const uint32_t generation = entry.mGeneration + 1;
+    entry = {};
+    entry.mGeneration = generation;
+    gFreeTextures.push_back(texture);
+}
+
+auto StreamedTextureResource(StreamedTexture texture) -> Texture * {
+    if (texture == InvalidStreamedTexture) {
+        return pPlaceholderTexture;
+    }
+
+    return gTextures[texture].pTexture;
+}
+
+void RequestStreamedTextureSize(StreamedTexture texture, float screenPixels) {
+    if (texture == InvalidStreamedTexture) {
+        return;
+    }
+
+    StreamedEntry &entry = gTextures[texture];
+    if (entry.mLastRequestFrame != gFrame) {
+        entry.mLastRequestFrame = gFrame;
+        entry.mRequestedPixels = 0.0f;
+    }
+    entry.mRequestedPixels = std::max(entry.mRequestedPixels, screenPixels);
+}
+
+static auto IsIdle(const StreamedEntry &entry) -> bool {
+    return entry.mLastRequestFrame + IdleFrames < gFrame || entry.mRequestedPixels <= 0.0f;
+}
+
+// The largest mip worth having, one texel per pixel along the longer side.
+static auto WantedMip(const StreamedEntry &entry) -> uint32_t {
+    if (IsIdle(entry)) {
+        return entry.mTailMip;
+    }
+    const float texelsPerPixel = std::max(entry.mLayout.mWidth, entry.mLayout.mHeight) / entry.mRequestedPixels;
+    const uint32_t mip = texelsPerPixel <= 1.0f ? 0 : (uint32_t)std::floor(std::log2(texelsPerPixel));
+    return std::min(mip, entry.mTailMip);
+}
+
+// Screen pixels per resident texel, above 1 the texture is magnified and looks blurry.
+static auto Blurriness(const StreamedEntry &entry) -> float {
+    if (IsIdle(entry)) {
+        return 0.0f;
+    }
+    const uint32_t texels = std::max(1u, std::max(entry.mLayout.mWidth, entry.mLayout.mHeight) >> entry.mResidentMip);
+    return entry.mRequestedPixels / texels;
+}
+
+// The sharpest texture, relative to its screen size, that can give up a mip without becoming
+// blurrier than the one asking for room.
+static auto FindEvictionVictim(uint32_t requester, float requesterBlurriness) -> uint32_t {
+    uint32_t victim = InvalidStreamedTexture;
+    float victimBlurriness = requesterBlurriness;
+    for (uint32_t i = 0; i < (uint32_t)gTextures.size(); ++i) {
+        const StreamedEntry &entry = gTextures[i];
+        if (i == requester || entry.mRefCount == 0 || entry.bLoading || entry.mResidentMip >= entry.mTailMip) {
+            continue;
+        }
+        // Dropping a mip doubles its blurriness.
+        const float blurriness = Blurriness(entry) * 2.0f;
+        if (blurriness < victimBlurriness) {
+            victim = i;
+            victimBlurriness = blurriness;
+        }
+    }
+    return victim;
+}
+
+static void PlanLoads() {
+    // Loads in flight are counted at their target size.
+    uint64_t committedBytes = 0;
+    std::vector<uint32_t> wanting;
+    for (uint32_t i = 0; i < (uint32_t)gTextures.size(); ++i) {
+        const StreamedEntry &entry = gTextures[i];
+        if (entry.mRefCount == 0) {
+            continue;
+        }
+        committedBytes += MipChainBytes(entry.mLayout, entry.bLoading ? entry.mPendingMip : entry.mResidentMip);
+        if (!entry.bLoading && !entry.bFailed && WantedMip(entry) < entry.mResidentMip) {
+            wanting.push_back(i);
+        }
+    }
+
+    // Makes room for extraBytes, false when nothing sharp enough is left to evict.
+    auto evict = [&committedBytes](uint32_t requester, float blurriness, uint64_t extraBytes) {
+        while (committedBytes + extraBytes > gBudgetBytes) {
+            const uint32_t victim = gPendingLoads < MaxPendingLoads ? FindEvictionVictim(requester, blurriness)
+                                                                     : InvalidStreamedTexture;
+            if (victim == InvalidStreamedTexture) {
+                return false;
+            }
+            const StreamedEntry &entry = gTextures[victim];
+            committedBytes -= entry.mLayout.mLevelBytes[entry.mResidentMip];
+            StartLoad(victim, entry.mResidentMip + 1);
+            gEvictions++;
+        }
+        return true;
+    };
+
+    // The budget may have been lowered below what is resident.
+    if (!evict(InvalidStreamedTexture, INFINITY, 0)) {
+        return;
+    }
+
+    // Blurriest first, each gets one more mip per load so the budget is shared out evenly.
+    std::sort(wanting.begin(), wanting.end(),
+              [](uint32_t a, uint32_t b) { return Blurriness(gTextures[a]) > Blurriness(gTextures[b]); });
+    for (uint32_t i : wanting) {
+        if (gPendingLoads >= MaxPendingLoads) {
+            return;
+        }
+        const StreamedEntry &entry = gTextures[i];
+        if (entry.bLoading) {
+            // Picked to make room for a blurrier texture.
+            continue;
+        }
+        const uint64_t extraBytes = entry.mLayout.mLevelBytes[entry.mResidentMip - 1];
+        if (!evict(i, Blurriness(entry), extraBytes) || gPendingLoads >= MaxPendingLoads) {
+            return;
+        }
+        committedBytes += extraBytes;
+        StartLoad(i, entry.mResidentMip - 1);
+    }
+}
+
+void UpdateTextureStreaming() {
+    MemoryScope memory(gMemoryOwner);
+    gFrame++;
+
+    // Replaced while frames that could still sample them were in flight.
+    auto retired = std::partition(gRetiredTextures.begin(), gRetiredTextures.end(),
+                                  [](const RetiredTexture &texture) { return texture.mFrame + ImageCount >= gFrame; });
+    for (auto it = retired; it != gRetiredTextures.end(); ++it) {
+        UntrackAllocation(it->pTexture);
+        removeResource(it->pTexture);
+    }
+    gRetiredTextures.erase(retired, gRetiredTextures.end());
+
+    {
+        std::lock_guard<std::mutex> jobLock(gJobMutex);
+        std::move(gFinishedJobs.begin(), gFinishedJobs.end(), std::back_inserter(gUploadingJobs));
+        gFinishedJobs.clear();
+    }
+
+    for (auto it = gUploadingJobs.begin(); it != gUploadingJobs.end();) {
+        StreamedEntry &entry = gTextures[it->mTexture];
+        const bool released = entry.mGeneration != it->mGeneration;
+        if (!released && !it->bFailed && it->pTexture == nullptr) {
+            CreateMipChain(it->mFileName, it->mLayout, it->mFirstMip, it->mData, &it->pTexture, &it->mToken);
+            it->mData = {};
+        }
+        if (it->pTexture != nullptr && !isTokenCompleted(&it->mToken)) {
+            ++it;
+            continue;
+        }
+
+        gPendingLoads--;
+        if (released) {
+            // Released while loading.
+            if (it->pTexture != nullptr) {
+                TrackGpuAllocation(it->pTexture, MipChainBytes(it->mLayout, it->mFirstMip));
+                RetireTexture(it->pTexture);
+            }
+        } else if (it->bFailed) {
+            LOGF(LogLevel::eERROR, "Streaming mip %u of %s failed, it stays at mip %u", it->mFirstMip,
+                 entry.mFileName.c_str(), entry.mResidentMip);
+            entry.bLoading = false;
+            entry.bFailed = true;
+        } else {
+            TrackGpuAllocation(it->pTexture, MipChainBytes(entry.mLayout, it->mFirstMip));
+            RetireTexture(entry.pTexture);
+            entry.pTexture = it->pTexture;
+            entry.mResidentMip = it->mFirstMip;
+            entry.bLoading = false;
+        }
+        it = gUploadingJobs.erase(it);
+    }
+
+    PlanLoads();
+}
+
+void SetTextureStreamingBudget(uint64_t budgetBytes) {
+    gBudgetBytes = budgetBytes;
+}
+
+auto GetTextureStreamingStats() -> TextureStreamingStats {
+    TextureStreamingStats stats = {};
+    for (const StreamedEntry &entry : gTextures) {
+        if (entry.mRefCount > 0) {
+            stats.mTextureCount++;
+            stats.mResidentBytes += MipChainBytes(entry.mLayout, entry.mResidentMip);
+        }
+    }
+    stats.mPendingLoads = gPendingLoads;
+    stats.mBudgetBytes = gBudgetBytes;
+    stats.mStreamedBytes = gStreamedBytes;
+    stats.mEvictions = gEvictions;
+    return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+
+// Mipmapped DDS textures kept resident only down to the mip their on-screen size needs, owned by
+// MainApp.
+//
+// Acquiring a texture reads its header and uploads the smallest mips, the tail, which stay resident
+// until the texture is released. Scenes report how large each texture appears on screen every frame
+// and larger mips are loaded one level at a time, as long as the resident mips of every texture fit
+// the budget. Once the budget is reached, textures that are sharper than their screen size needs,
+// or no longer drawn, give up their largest mip to make room.
+//
+// Only the file reads happen on the streamer's thread. The textures are created and uploaded through
+// the resource loader in UpdateTextureStreaming, so everything here is called from the main thread.
+//
+// Mips are added and dropped by loading a new texture and swapping it in once its upload finished,
+// so the Texture behind a handle changes while it streams. Descriptors must be updated whenever
+// StreamedTextureResource returns something else than what they hold. Replaced textures stay alive
+// until every frame that may still sample them has finished.
+
+using StreamedTexture = uint32_t;
+constexpr StreamedTexture InvalidStreamedTexture = ~0u;
+
+// Mips up to this size are loaded when the texture is acquired and never evicted.
+constexpr uint32_t StreamingTailSize = 64;
+
+void InitTextureStreamer(Renderer *pRenderer, uint64_t budgetBytes);
+void ExitTextureStreamer();
+
+// Reference counted by file name, relative to RD_TEXTURES. Returns InvalidStreamedTexture when the
+// file cannot be read or its format is not supported.
+auto AcquireStreamedTexture(const char *pFileName) -> StreamedTexture;
+void ReleaseStreamedTexture(StreamedTexture texture);
+
+// The resident texture, or a 1x1 white placeholder for InvalidStreamedTexture.
+auto StreamedTextureResource(StreamedTexture texture) -> Texture *;
+
+// The largest size in pixels the texture covers on screen this frame, reported for every draw or
+// once with the maximum. Textures not reported for a while fall back to their tail.
+void RequestStreamedTextureSize(StreamedTexture texture, float screenPixels);
+
+// Uploads finished reads, swaps in finished uploads, frees replaced textures and starts new loads. Call once per frame,
+// after waiting for the fence of the frame.
+void UpdateTextureStreaming();
+
+void SetTextureStreamingBudget(uint64_t budgetBytes);
+
+struct TextureStreamingStats {
+    uint32_t mTextureCount;
+    uint32_t mPendingLoads;
+    uint64_t mResidentBytes;
+    uint64_t mBudgetBytes;
+    // Everything read from disk since Init, tails included.
+    uint64_t mStreamedBytes;
+    uint32_t mEvictions;
+};
+
+auto GetTextureStreamingStats() -> TextureStreamingStats;
@@ -0,0 +1,150 @@
+#include "UploadBatcher.h"
+
+#include "MainApp.h"
+#include "MemoryBudget.h"
+
+#include <vector>
+
+#include <Common_3/OS/Interfaces/ILog.h>
+#include <Common_3/Renderer/IResourceLoader.h>
+
+namespace {
+constexpr uint64_t UploadAlignment = 16;
+
+struct UploadCopy {
+    Buffer *pBuffer;
+    ResourceState mState;
+    uint64_t mDstOffset;
+    uint64_t mSrcOffset;
+    uint64_t mSize;
+};
+
+Renderer *pUploadRenderer = nullptr;
+// ImageCount regions of UploadBudget bytes, the frame writes only its own.
+Buffer *pStaging = nullptr;
+uint64_t gRegionOffset = 0;
+uint64_t gStagingOffset = 0;
+// The frame's region while it is mapped, nullptr once the uploads are flushed.
+uint8_t *pMappedRegion = nullptr;
+
+std::vector<UploadCopy> gCopies;
+std::vector<BufferBarrier> gBarriers;
+uint32_t gWrites = 0;
+bool bOverBudgetLogged = false;
+
+UploadStats gStats = {};
+} // namespace
+
+void InitUploadBatcher(Renderer *pRenderer) {
+    pUploadRenderer = pRenderer;
+
+    BufferLoadDesc desc = {};
+    desc.mDesc.mDescriptors = DESCRIPTOR_TYPE_UNDEFINED;
+    desc.mDesc.mMemoryUsage = RESOURCE_MEMORY_USAGE_CPU_TO_GPU;
+    desc.mDesc.mSize = UploadBudget * ImageCount;
+    desc.mDesc.mStartState = RESOURCE_STATE_COPY_SOURCE;
+    desc.mDesc.pName = "Upload Staging";
+    desc.pData = NULL;
+    desc.ppBuffer = &pStaging;
+    AddTrackedResource(&desc, NULL);
+    waitForAllResourceLoads();
+}
+
+void ExitUploadBatcher() {
+    if (pMappedRegion != nullptr) {
+        unmapBuffer(pUploadRenderer, pStaging);
+        pMappedRegion = nullptr;
+    }
+    RemoveTrackedResource(pStaging);
+    pStaging = nullptr;
+    pUploadRenderer = nullptr;
+}
+
+void BeginUploadFrame(uint32_t imageIndex) {
+    // Still mapped when the last frame was not drawn.
+    if (pMappedRegion != nullptr) {
+        unmapBuffer(pUploadRenderer, pStaging);
+    }
+
+    // The whole buffer is mapped, the regions of the frames still in flight are not written.
+    gRegionOffset = imageIndex * UploadBudget;
+    mapBuffer(pUploadRenderer, pStaging, NULL);
+    pMappedRegion = (uint8_t *)pStaging->pCpuMappedAddress + gRegionOffset;
+
+    gStagingOffset = 0;
+    gCopies.clear();
+    gWrites = 0;
+}
+
+auto AllocateUpload(Buffer *pBuffer, uint64_t offset, uint64_t size, ResourceState state) -> void * {
+    if (pMappedRegion == nullptr) {
+        LOGF(LogLevel::eERROR, "Upload written after the flush or before BeginUploadFrame, it is dropped");
+        return nullptr;
+    }
+
+    const uint64_t srcOffset = (gStagingOffset + UploadAlignment - 1) & ~(UploadAlignment - 1);
+    if (srcOffset + size > UploadBudget) {
+        if (!bOverBudgetLogged) {
+            LOGF(LogLevel::eERROR, "Uploads of the frame exceed %llu bytes, writes are dropped",
+                 (unsigned long long)UploadBudget);
+            bOverBudgetLogged = true;
+        }
+        return nullptr;
+    }
+    gStagingOffset = srcOffset + size;
+    gWrites++;
+
+    // Continues the last write on both sides, one copy covers both.
+    if (!gCopies.empty()) {
+        UploadCopy &last = gCopies.back();
+        if (last.pBuffer == pBuffer && last.mDstOffset + last.mSize == offset &&
+            last.mSrcOffset + last.mSize == srcOffset) {
+            last.mSize += size;
+            return pMappedRegion + srcOffset;
+        }
+    }
+
+    gCopies.push_back({pBuffer, state, offset, srcOffset, size});
+    return pMappedRegion + srcOffset;
+}
+
+void CmdFlushUploads(Cmd *cmd) {
+    if (pMappedRegion != nullptr) {
+        unmapBuffer(pUploadRenderer, pStaging);
+        pMappedRegion = nullptr;
+    }
+
+    gStats = {gWrites, (uint32_t)gCopies.size(), 0};
+    if (gCopies.empty()) {
+        return;
+    }
+
+    // A destination written more than once still needs one transition.
+    gBarriers.clear();
+    for (const UploadCopy &copy : gCopies) {
+        bool seen = false;
+        for (const BufferBarrier &barrier : gBarriers) {
+            seen = seen || barrier.pBuffer == copy.pBuffer;
+        }
+        if (!seen) {
+            gBarriers.push_back({copy.pBuffer, copy.mState, RESOURCE_STATE_COPY_DEST});
+        }
+    }
+    cmdResourceBarrier(cmd, (uint32_t)gBarriers.size(), gBarriers.data(), 0, nullptr, 0, nullptr);
+
+    for (const UploadCopy &copy : gCopies) {
+        cmdUpdateBuffer(cmd, copy.pBuffer, copy.mDstOffset, pStaging, gRegionOffset + copy.mSrcOffset, copy.mSize);
+        gStats.mBytes += copy.mSize;
+    }
+
+    for (BufferBarrier &barrier : gBarriers) {
+        barrier.mNewState = barrier.mCurrentState;
+        barrier.mCurrentState = RESOURCE_STATE_COPY_DEST;
+    }
+    cmdResourceBarrier(cmd, (uint32_t)gBarriers.size(), gBarriers.data(), 0, nullptr, 0, nullptr);
+
+    CountUploadBytes(gStats.mBytes);
+    gCopies.clear();
+}
+
+auto GetUploadStats() -> UploadStats { return gStats; }
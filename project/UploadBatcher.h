@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Common_3/Renderer/IRenderer.h>
+
+#include <cstdint>
+
+// Per-frame dynamic data gathered into one staging buffer and copied to GPU only buffers in one
+// place, owned by MainApp.
+//
+// The staging buffer is a ring with one region per frame in flight. The region of the frame is
+// mapped when the frame begins, writers get a pointer into it and fill their data in place, and it
+// is unmapped again right before the copies into the destination buffers are recorded, when the
+// uploads are flushed before the first pass of the frame. D3D11 does not copy from a mapped
+// buffer. Writes that continue the previous one in the same destination are merged into one copy,
+// and all destinations are transitioned with one barrier before and one after the copies.
+
+// Staging bytes available to the writes of one frame.
+constexpr uint64_t UploadBudget = 1ull << 20;
+
+void InitUploadBatcher(Renderer *pRenderer);
+void ExitUploadBatcher();
+
+// Starts the writes of imageIndex, whose previous submission the GPU must be done with.
+void BeginUploadFrame(uint32_t imageIndex);
+
+// size bytes written to pBuffer at offset when the uploads are flushed. pBuffer is kept in state
+// between frames. The returned memory is 16 byte aligned and only valid until the flush, nullptr
+// when the budget of the frame is used up.
+auto AllocateUpload(Buffer *pBuffer, uint64_t offset, uint64_t size, ResourceState state) -> void *;
+
+// Records the copies of every write since BeginUploadFrame, outside of any render pass.
+void CmdFlushUploads(Cmd *cmd);
+
+struct UploadStats {
+    uint32_t mWrites;
+    uint32_t mCopies;
+    uint64_t mBytes;
+};
+
+// Of the last flushed frame.
+auto GetUploadStats() -> UploadStats;
@@ -0,0 +1,305 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BC_SSE2 1
+#endif
+
+namespace {
+// Texels as floats, one array per channel so that four texels load as one SSE register.
+struct BlockColors {
+    alignas(16) float mR[BlockTexels];
+    alignas(16) float mG[BlockTexels];
+    alignas(16) float mB[BlockTexels];
+};
+
+struct Color {
+    float r, g, b;
+};
+} // namespace
+
+static auto Pack565(const Color &c) -> uint16_t {
+    const uint32_t r = (uint32_t)std::lround(std::clamp(c.r, 0.0f, 255.0f) * 31.0f / 255.0f);
+    const uint32_t g = (uint32_t)std::lround(std::clamp(c.g, 0.0f, 255.0f) * 63.0f / 255.0f);
+    const uint32_t b = (uint32_t)std::lround(std::clamp(c.b, 0.0f, 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static auto Unpack565(uint16_t packed) -> Color {
+    const uint32_t r = packed >> 11 & 31;
+    const uint32_t g = packed >> 5 & 63;
+    const uint32_t b = packed & 31;
+    return {(float)(r << 3 | r >> 2), (float)(g << 2 | g >> 4), (float)(b << 3 | b >> 2)};
+}
+
+static auto Lerp(const Color &a, const Color &b, float t) -> Color {
+    return {a.r + (b.r - a.r) * t, a.g + (b.g - a.g) * t, a.b + (b.b - a.b) * t};
+}
+
+// Index of the nearest of the four palette entries for every texel, returns the summed squared error.
+static auto PickIndices(const BlockColors &block, const Color palette[4], uint8_t indices[BlockTexels]) -> float {
+#if defined(BC_SSE2)
+    __m128 totalError = _mm_setzero_ps();
+    for (uint32_t i = 0; i < BlockTexels; i += 4) {
+        const __m128 r = _mm_load_ps(&block.mR[i]);
+        const __m128 g = _mm_load_ps(&block.mG[i]);
+        const __m128 b = _mm_load_ps(&block.mB[i]);
+
+        __m128 bestError = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (int p = 0; p < 4; ++p) {
+            const __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p].r));
+            const __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p].g));
+            const __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p].b));
+            const __m128 error =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+            const __m128 closer = _mm_cmplt_ps(error, bestError);
+            bestError = _mm_min_ps(error, bestError);
+            const __m128i closerMask = _mm_castps_si128(closer);
+            bestIndex = _mm_or_si128(_mm_and_si128(closerMask, _mm_set1_epi32(p)), _mm_andnot_si128(closerMask, bestIndex));
+        }
+
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128((__m128i *)lanes, bestIndex);
+        for (int lane = 0; lane < 4; ++lane) {
+            indices[i + lane] = (uint8_t)lanes[lane];
+        }
+        totalError = _mm_add_ps(totalError, bestError);
+    }
+
+    alignas(16) float errors[4];
+    _mm_store_ps(errors, totalError);
+    return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+    float totalError = 0.0f;
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        float bestError = FLT_MAX;
+        for (int p = 0; p < 4; ++p) {
+            const float dr = block.mR[i] - palette[p].r;
+            const float dg = block.mG[i] - palette[p].g;
+            const float db = block.mB[i] - palette[p].b;
+            const float error = dr * dr + dg * dg + db * db;
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = (uint8_t)p;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+#endif
+}
+
+// Four colour mode only, which needs color0 > color1. Palette entries in encoding order.
+static void MakePalette(uint16_t color0, uint16_t color1, Color palette[4]) {
+    palette[0] = Unpack565(color0);
+    palette[1] = Unpack565(color1);
+    palette[2] = Lerp(palette[0], palette[1], 1.0f / 3.0f);
+    palette[3] = Lerp(palette[0], palette[1], 2.0f / 3.0f);
+}
+
+// Endpoints along the principal axis of the texels, pulled in a little so that the extremes land on
+// the palette rather than past it.
+static void FitPrincipalAxis(const BlockColors &block, Color *pMin, Color *pMax) {
+    Color mean = {0.0f, 0.0f, 0.0f};
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        mean.r += block.mR[i];
+        mean.g += block.mG[i];
+        mean.b += block.mB[i];
+    }
+    mean = {mean.r / BlockTexels, mean.g / BlockTexels, mean.b / BlockTexels};
+
+    float covariance[6] = {};
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        const float r = block.mR[i] - mean.r;
+        const float g = block.mG[i] - mean.g;
+        const float b = block.mB[i] - mean.b;
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // Power iteration, a handful of steps is plenty for a 3x3 matrix.
+    Color axis = {1.0f, 1.0f, 1.0f};
+    for (int step = 0; step < 8; ++step) {
+        const Color next = {
+            covariance[0] * axis.r + covariance[1] * axis.g + covariance[2] * axis.b,
+            covariance[1] * axis.r + covariance[3] * axis.g + covariance[4] * axis.b,
+            covariance[2] * axis.r + covariance[4] * axis.g + covariance[5] * axis.b,
+        };
+        const float length = std::max({std::fabs(next.r), std::fabs(next.g), std::fabs(next.b)});
+        if (length < 1e-6f) {
+            break;
+        }
+        axis = {next.r / length, next.g / length, next.b / length};
+    }
+
+    float minT = FLT_MAX;
+    float maxT = -FLT_MAX;
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        const float t =
+            (block.mR[i] - mean.r) * axis.r + (block.mG[i] - mean.g) * axis.g + (block.mB[i] - mean.b) * axis.b;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    const float axisLengthSq = axis.r * axis.r + axis.g * axis.g + axis.b * axis.b;
+    const float inset = (maxT - minT) / 16.0f;
+    minT = (minT + inset) / std::max(axisLengthSq, 1e-6f);
+    maxT = (maxT - inset) / std::max(axisLengthSq, 1e-6f);
+    *pMin = {mean.r + axis.r * minT, mean.g + axis.g * minT, mean.b + axis.b * minT};
+    *pMax = {mean.r + axis.r * maxT, mean.g + axis.g * maxT, mean.b + axis.b * maxT};
+}
+
+// Least squares endpoints for fixed indices, the weight of endpoint 0 for index i is weights[i].
+static auto RefineEndpoints(const BlockColors &block, const uint8_t indices[BlockTexels], Color *pColor0,
+                            Color *pColor1) -> bool {
+    static const float Weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    Color ax = {0.0f, 0.0f, 0.0f};
+    Color bx = {0.0f, 0.0f, 0.0f};
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        const float a = Weights[indices[i]];
+        const float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        ax = {ax.r + a * block.mR[i], ax.g + a * block.mG[i], ax.b + a * block.mB[i]};
+        bx = {bx.r + b * block.mR[i], bx.g + b * block.mG[i], bx.b + b * block.mB[i]};
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+        return false;
+    }
+    const float scale = 1.0f / determinant;
+    *pColor0 = {(ax.r * bb - bx.r * ab) * scale, (ax.g * bb - bx.g * ab) * scale, (ax.b * bb - bx.b * ab) * scale};
+    *pColor1 = {(bx.r * aa - ax.r * ab) * scale, (bx.g * aa - ax.g * ab) * scale, (bx.b * aa - ax.b * ab) * scale};
+    return true;
+}
+
+// Packs both endpoints, ordered for four colour mode, and picks the indices. False when both
+// endpoints quantise to the same colour, which only the single colour encoding can represent.
+static auto TryEndpoints(const BlockColors &block, const Color &a, const Color &b, uint16_t *pColor0,
+                         uint16_t *pColor1, uint8_t indices[BlockTexels], float *pError) -> bool {
+    uint16_t color0 = Pack565(a);
+    uint16_t color1 = Pack565(b);
+    if (color0 == color1) {
+        return false;
+    }
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    Color palette[4];
+    MakePalette(color0, color1, palette);
+    *pError = PickIndices(block, palette, indices);
+    *pColor0 = color0;
+    *pColor1 = color1;
+    return true;
+}
+
+static void WriteBc1(uint16_t color0, uint16_t color1, const uint8_t indices[BlockTexels], uint8_t *pOut) {
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        bits |= (uint32_t)indices[i] << (2 * i);
+    }
+    memcpy(pOut, &color0, 2);
+    memcpy(pOut + 2, &color1, 2);
+    memcpy(pOut + 4, &bits, 4);
+}
+
+void EncodeBc1Block(const uint8_t *pRgba, uint8_t *pOut) {
+    BlockColors block;
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        block.mR[i] = pRgba[4 * i + 0];
+        block.mG[i] = pRgba[4 * i + 1];
+        block.mB[i] = pRgba[4 * i + 2];
+    }
+
+    Color minColor, maxColor;
+    FitPrincipalAxis(block, &minColor, &maxColor);
+
+    uint16_t color0 = 0, color1 = 0;
+    uint8_t indices[BlockTexels] = {};
+    float error = FLT_MAX;
+    if (!TryEndpoints(block, maxColor, minColor, &color0, &color1, indices, &error)) {
+        // A flat block, every texel takes the first endpoint.
+        color0 = color1 = Pack565(maxColor);
+        WriteBc1(color0, color1, indices, pOut);
+        return;
+    }
+
+    Color refined0, refined1;
+    if (RefineEndpoints(block, indices, &refined0, &refined1)) {
+        uint16_t candidate0 = 0, candidate1 = 0;
+        uint8_t candidateIndices[BlockTexels] = {};
+        float candidateError = FLT_MAX;
+        if (TryEndpoints(block, refined0, refined1, &candidate0, &candidate1, candidateIndices, &candidateError) &&
+            candidateError < error) {
+            color0 = candidate0;
+            color1 = candidate1;
+            memcpy(indices, candidateIndices, sizeof(indices));
+        }
+    }
+
+    WriteBc1(color0, color1, indices, pOut);
+}
+
+// Eight value mode: endpoint 0 is the larger, indices 2 to 7 interpolate between them.
+static void EncodeAlphaBlock(const uint8_t *pRgba, uint32_t channel, uint8_t *pOut) {
+    uint8_t minValue = 255;
+    uint8_t maxValue = 0;
+    for (uint32_t i = 0; i < BlockTexels; ++i) {
+        minValue = std::min(minValue, pRgba[4 * i + channel]);
+        maxValue = std::max(maxValue, pRgba[4 * i + channel]);
+    }
+
+    pOut[0] = maxValue;
+    pOut[1] = minValue;
+
+    uint64_t bits = 0;
+    if (maxValue > minValue) {
+        float palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * maxValue + i * minValue) / 7.0f;
+        }
+
+        for (uint32_t i = 0; i < BlockTexels; ++i) {
+            const float value = pRgba[4 * i + channel];
+            uint64_t best = 0;
+            float bestError = FLT_MAX;
+            for (uint64_t p = 0; p < 8; ++p) {
+                const float error = std::fabs(value - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            bits |= best << (3 * i);
+        }
+    }
+    memcpy(pOut + 2, &bits, 6);
+}
+
+void EncodeBc3Block(const uint8_t *pRgba, uint8_t *pOut) {
+    EncodeAlphaBlock(pRgba, 3, pOut);
+    EncodeBc1Block(pRgba, pOut + 8);
+}
+
+void EncodeBc5Block(const uint8_t *pRgba, uint8_t *pOut) {
+    EncodeAlphaBlock(pRgba, 0, pOut);
+    EncodeAlphaBlock(pRgba, 1, pOut + 8);
+}
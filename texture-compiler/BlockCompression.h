@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// BC1, BC3 and BC5 encoders for one 4x4 block of RGBA8 texels, row major.
+//
+// Endpoints are fitted along the principal axis of the block's colours and refined once by least
+// squares over the chosen indices. Picking the nearest palette entry for all 16 texels, the hot
+// loop, runs four texels at a time with SSE2 where it is available.
+
+constexpr uint32_t BlockTexels = 16;
+
+// 8 bytes, colour only, alpha is ignored.
+void EncodeBc1Block(const uint8_t *pRgba, uint8_t *pOut);
+// 16 bytes, the alpha block followed by a BC1 colour block.
+void EncodeBc3Block(const uint8_t *pRgba, uint8_t *pOut);
+// 16 bytes, red and green as two alpha style blocks, for tangent space normal maps.
+void EncodeBc5Block(const uint8_t *pRgba, uint8_t *pOut);
@@ -0,0 +1,197 @@
+#include "Dds.h"
+
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+// DXGI_FORMAT values.
+constexpr uint32_t DxgiBc1Unorm = 71;
+constexpr uint32_t DxgiBc1UnormSrgb = 72;
+constexpr uint32_t DxgiBc3Unorm = 77;
+constexpr uint32_t DxgiBc3UnormSrgb = 78;
+constexpr uint32_t DxgiBc5Unorm = 83;
+
+constexpr uint32_t DdsMagic = 0x20534444; // "DDS "
+constexpr uint32_t FourCcDx10 = 0x30315844;
+
+constexpr uint32_t DdsdCaps = 0x1;
+constexpr uint32_t DdsdHeight = 0x2;
+constexpr uint32_t DdsdWidth = 0x4;
+constexpr uint32_t DdsdPixelFormat = 0x1000;
+constexpr uint32_t DdsdMipMapCount = 0x20000;
+constexpr uint32_t DdsdLinearSize = 0x80000;
+constexpr uint32_t DdpfFourCc = 0x4;
+constexpr uint32_t DdsCapsComplex = 0x8;
+constexpr uint32_t DdsCapsTexture = 0x1000;
+constexpr uint32_t DdsCapsMipMap = 0x400000;
+constexpr uint32_t ResourceDimensionTexture2D = 3;
+
+struct DdsPixelFormat {
+    uint32_t mSize;
+    uint32_t mFlags;
+    uint32_t mFourCc;
+    uint32_t mRgbBitCount;
+    uint32_t mBitMasks[4];
+};
+
+struct DdsHeader {
+    uint32_t mSize;
+    uint32_t mFlags;
+    uint32_t mHeight;
+    uint32_t mWidth;
+    uint32_t mPitchOrLinearSize;
+    uint32_t mDepth;
+    uint32_t mMipMapCount;
+    uint32_t mReserved1[11];
+    DdsPixelFormat mPixelFormat;
+    uint32_t mCaps[4];
+    uint32_t mReserved2;
+};
+
+struct DdsHeaderDx10 {
+    uint32_t mDxgiFormat;
+    uint32_t mResourceDimension;
+    uint32_t mMiscFlag;
+    uint32_t mArraySize;
+    uint32_t mMiscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS_HEADER is 124 bytes");
+} // namespace
+
+auto BlockBytes(BlockFormat format) -> uint32_t { return format == BlockFormat::Bc1 ? 8 : 16; }
+
+auto FormatName(BlockFormat format) -> const char * {
+    switch (format) {
+    case BlockFormat::Bc1:
+        return "BC1";
+    case BlockFormat::Bc3:
+        return "BC3";
+    case BlockFormat::Bc5:
+        return "BC5";
+    }
+    return "?";
+}
+
+static auto DxgiFormat(BlockFormat format, bool srgb) -> uint32_t {
+    switch (format) {
+    case BlockFormat::Bc1:
+        return srgb ? DxgiBc1UnormSrgb : DxgiBc1Unorm;
+    case BlockFormat::Bc3:
+        return srgb ? DxgiBc3UnormSrgb : DxgiBc3Unorm;
+    case BlockFormat::Bc5:
+        return DxgiBc5Unorm;
+    }
+    return 0;
+}
+
+static void CompressRows(const Image &level, BlockFormat format, uint32_t firstRow, uint32_t rowCount,
+                         std::vector<uint8_t> &out) {
+    const uint32_t blocksWide = (level.mWidth + 3) / 4;
+    const uint32_t blockBytes = BlockBytes(format);
+
+    uint8_t block[BlockTexels * 4];
+    for (uint32_t by = firstRow; by < firstRow + rowCount; ++by) {
+        for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+            // Blocks past the edge of small levels repeat the last texel.
+            for (uint32_t y = 0; y < 4; ++y) {
+                const uint32_t sy = std::min(by * 4 + y, level.mHeight - 1);
+                for (uint32_t x = 0; x < 4; ++x) {
+                    const uint32_t sx = std::min(bx * 4 + x, level.mWidth - 1);
+                    memcpy(&block[(y * 4 + x) * 4], &level.mTexels[((size_t)sy * level.mWidth + sx) * 4], 4);
+                }
+            }
+
+            uint8_t *pOut = &out[((size_t)by * blocksWide + bx) * blockBytes];
+            switch (format) {
+            case BlockFormat::Bc1:
+                EncodeBc1Block(block, pOut);
+                break;
+            case BlockFormat::Bc3:
+                EncodeBc3Block(block, pOut);
+                break;
+            case BlockFormat::Bc5:
+                EncodeBc5Block(block, pOut);
+                break;
+            }
+        }
+    }
+}
+
+void CompressMipChain(const std::vector<Image> &levels, BlockFormat format, bool srgb, uint32_t threadCount,
+                      CompressedTexture *pOut) {
+    pOut->mFormat = format;
+    pOut->bSrgb = srgb;
+    pOut->mWidth = levels[0].mWidth;
+    pOut->mHeight = levels[0].mHeight;
+    pOut->mLevels.resize(levels.size());
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        const Image &level = levels[i];
+        const uint32_t blocksWide = (level.mWidth + 3) / 4;
+        const uint32_t blocksHigh = (level.mHeight + 3) / 4;
+        std::vector<uint8_t> &out = pOut->mLevels[i];
+        out.resize((size_t)blocksWide * blocksHigh * BlockBytes(format));
+
+        // Small levels are not worth a thread.
+        const uint32_t workers = std::max(1u, std::min(threadCount, blocksHigh / 4));
+        const uint32_t rowsPerWorker = (blocksHigh + workers - 1) / workers;
+        std::vector<std::thread> threads;
+        for (uint32_t w = 1; w < workers; ++w) {
+            const uint32_t first = w * rowsPerWorker;
+            if (first < blocksHigh) {
+                threads.emplace_back(CompressRows, std::cref(level), format, first,
+                                     std::min(rowsPerWorker, blocksHigh - first), std::ref(out));
+            }
+        }
+        CompressRows(level, format, 0, std::min(rowsPerWorker, blocksHigh), out);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+auto CompressedBytes(const CompressedTexture &texture) -> uint64_t {
+    uint64_t bytes = 0;
+    for (const auto &level : texture.mLevels) {
+        bytes += level.size();
+    }
+    return bytes;
+}
+
+auto WriteDds(const std::string &path, const CompressedTexture &texture) -> bool {
+    DdsHeader header = {};
+    header.mSize = sizeof(DdsHeader);
+    header.mFlags = DdsdCaps | DdsdHeight | DdsdWidth | DdsdPixelFormat | DdsdMipMapCount | DdsdLinearSize;
+    header.mHeight = texture.mHeight;
+    header.mWidth = texture.mWidth;
+    header.mPitchOrLinearSize = (uint32_t)texture.mLevels[0].size();
+    header.mMipMapCount = (uint32_t)texture.mLevels.size();
+    header.mPixelFormat.mSize = sizeof(DdsPixelFormat);
+    header.mPixelFormat.mFlags = DdpfFourCc;
+    header.mPixelFormat.mFourCc = FourCcDx10;
+    header.mCaps[0] = DdsCapsTexture | (texture.mLevels.size() > 1 ? DdsCapsComplex | DdsCapsMipMap : 0);
+
+    DdsHeaderDx10 dx10 = {};
+    dx10.mDxgiFormat = DxgiFormat(texture.mFormat, texture.bSrgb);
+    dx10.mResourceDimension = ResourceDimensionTexture2D;
+    dx10.mArraySize = 1;
+
+    FILE *pFile = fopen(path.c_str(), "wb");
+    if (pFile == nullptr) {
+        return false;
+    }
+
+    bool written = fwrite(&DdsMagic, sizeof(DdsMagic), 1, pFile) == 1;
+    written = written && fwrite(&header, sizeof(header), 1, pFile) == 1;
+    written = written && fwrite(&dx10, sizeof(dx10), 1, pFile) == 1;
+    for (const auto &level : texture.mLevels) {
+        written = written && fwrite(level.data(), level.size(), 1, pFile) == 1;
+    }
+    written = fclose(pFile) == 0 && written;
+    return written;
+}
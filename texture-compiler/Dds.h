@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Mipmaps.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class BlockFormat {
+    Bc1,
+    Bc3,
+    Bc5,
+};
+
+struct CompressedTexture {
+    BlockFormat mFormat;
+    bool bSrgb;
+    uint32_t mWidth;
+    uint32_t mHeight;
+    // One entry per mip level, largest first.
+    std::vector<std::vector<uint8_t>> mLevels;
+};
+
+auto BlockBytes(BlockFormat format) -> uint32_t;
+auto FormatName(BlockFormat format) -> const char *;
+
+// Encodes every level, splitting the block rows of each level across threadCount threads.
+void CompressMipChain(const std::vector<Image> &levels, BlockFormat format, bool srgb, uint32_t threadCount,
+                      CompressedTexture *pOut);
+
+auto CompressedBytes(const CompressedTexture &texture) -> uint64_t;
+
+// DDS with the DX10 header, which is the only way to tell sRGB block formats apart.
+auto WriteDds(const std::string &path, const CompressedTexture &texture) -> bool;
@@ -0,0 +1,95 @@
+#include "Mipmaps.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+struct FloatImage {
+    uint32_t mWidth;
+    uint32_t mHeight;
+    std::vector<float> mTexels;
+};
+} // namespace
+
+static auto SrgbToLinear(float value) -> float {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static auto LinearToSrgb(float value) -> float {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static auto ToFloat(const Image &image, ImageKind kind) -> FloatImage {
+    float srgbTable[256];
+    for (int i = 0; i < 256; ++i) {
+        srgbTable[i] = kind == ImageKind::Color ? SrgbToLinear(i / 255.0f) : i / 255.0f;
+    }
+
+    FloatImage out = {image.mWidth, image.mHeight, std::vector<float>(image.mTexels.size())};
+    for (size_t i = 0; i < image.mTexels.size(); ++i) {
+        // Alpha is linear in every kind.
+        out.mTexels[i] = i % 4 == 3 ? image.mTexels[i] / 255.0f : srgbTable[image.mTexels[i]];
+    }
+    return out;
+}
+
+static auto ToImage(const FloatImage &image, ImageKind kind) -> Image {
+    Image out = {image.mWidth, image.mHeight, std::vector<uint8_t>(image.mTexels.size())};
+    for (size_t i = 0; i < image.mTexels.size(); ++i) {
+        float value = std::clamp(image.mTexels[i], 0.0f, 1.0f);
+        if (kind == ImageKind::Color && i % 4 != 3) {
+            value = LinearToSrgb(value);
+        }
+        out.mTexels[i] = (uint8_t)std::lround(value * 255.0f);
+    }
+    return out;
+}
+
+static auto Downsample(const FloatImage &source, ImageKind kind) -> FloatImage {
+    FloatImage out;
+    out.mWidth = std::max(1u, source.mWidth / 2);
+    out.mHeight = std::max(1u, source.mHeight / 2);
+    out.mTexels.resize((size_t)out.mWidth * out.mHeight * 4);
+
+    for (uint32_t y = 0; y < out.mHeight; ++y) {
+        const uint32_t y0 = std::min(2 * y, source.mHeight - 1);
+        const uint32_t y1 = std::min(2 * y + 1, source.mHeight - 1);
+        for (uint32_t x = 0; x < out.mWidth; ++x) {
+            const uint32_t x0 = std::min(2 * x, source.mWidth - 1);
+            const uint32_t x1 = std::min(2 * x + 1, source.mWidth - 1);
+
+            float *pOut = &out.mTexels[((size_t)y * out.mWidth + x) * 4];
+            for (int c = 0; c < 4; ++c) {
+                pOut[c] = 0.25f * (source.mTexels[((size_t)y0 * source.mWidth + x0) * 4 + c] +
+                                   source.mTexels[((size_t)y0 * source.mWidth + x1) * 4 + c] +
+                                   source.mTexels[((size_t)y1 * source.mWidth + x0) * 4 + c] +
+                                   source.mTexels[((size_t)y1 * source.mWidth + x1) * 4 + c]);
+            }
+
+            if (kind == ImageKind::Normal) {
+                // Averaging shortens the normals, scale them back to unit length.
+                const float nx = pOut[0] * 2.0f - 1.0f;
+                const float ny = pOut[1] * 2.0f - 1.0f;
+                const float nz = pOut[2] * 2.0f - 1.0f;
+                const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                if (length > 1e-6f) {
+                    pOut[0] = nx / length * 0.5f + 0.5f;
+                    pOut[1] = ny / length * 0.5f + 0.5f;
+                    pOut[2] = nz / length * 0.5f + 0.5f;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+void GenerateMipChain(const Image &source, ImageKind kind, std::vector<Image> *pLevels) {
+    pLevels->clear();
+    pLevels->push_back(source);
+
+    FloatImage level = ToFloat(source, kind);
+    while (level.mWidth > 1 || level.mHeight > 1) {
+        level = Downsample(level, kind);
+        pLevels->push_back(ToImage(level, kind));
+    }
+}
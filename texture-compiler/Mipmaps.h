@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct Image {
+    uint32_t mWidth;
+    uint32_t mHeight;
+    // RGBA8, row major.
+    std::vector<uint8_t> mTexels;
+};
+
+enum class ImageKind {
+    // sRGB colour, filtered in linear space.
+    Color,
+    // Linear data, filtered as is.
+    Linear,
+    // Tangent space normals in red and green, renormalised after filtering.
+    Normal,
+};
+
+// The full chain down to 1x1, level 0 being the source. Each level is a 2x2 box filter of the
+// unquantised level above, odd sizes repeat the last row or column.
+void GenerateMipChain(const Image &source, ImageKind kind, std::vector<Image> *pLevels);
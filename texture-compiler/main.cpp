@@ -0,0 +1,256 @@
+// Turns the source images of a directory into block compressed, fully mipmapped DDS files.
+//
+//   texture-compiler [--force] <source directory> <output directory>
+//
+// PNG, TGA, JPEG and BMP sources are compiled, images whose name ends in _n or _normal as BC5
+// normal maps, the rest as sRGB BC1, or BC3 when any texel is not opaque. Every other file is
+// copied as is, except a prebuilt DDS next to a source image of the same name, which the compiled
+// one replaces. Outputs whose source, settings and tool version hash the same as on the last run
+// are skipped, --force rebuilds everything.
+
+#include "Dds.h"
+#include "Mipmaps.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_BMP
+#include <Common_3/ThirdParty/OpenSource/Nothings/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+// Bump whenever the encoders or the mip filter change, so every output is rebuilt.
+constexpr const char *ToolVersion = "texture-compiler 1";
+constexpr const char *CacheFileName = "texture-cache.txt";
+
+constexpr uint64_t FnvOffset = 14695981039346656037ull;
+constexpr uint64_t FnvPrime = 1099511628211ull;
+
+struct Totals {
+    uint32_t mCompiled = 0;
+    uint32_t mCopied = 0;
+    uint32_t mUpToDate = 0;
+    uint32_t mFailed = 0;
+    uint64_t mCompressedBytes = 0;
+    uint64_t mUncompressedBytes = 0;
+};
+} // namespace
+
+static auto Fnv1a(const void *pData, size_t size, uint64_t hash) -> uint64_t {
+    const uint8_t *pBytes = (const uint8_t *)pData;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ pBytes[i]) * FnvPrime;
+    }
+    return hash;
+}
+
+static auto ReadFile(const fs::path &path, std::vector<uint8_t> *pOut) -> bool {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    pOut->assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static auto IsSourceImage(const fs::path &path) -> bool {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+    return extension == ".png" || extension == ".tga" || extension == ".jpg" || extension == ".jpeg" ||
+           extension == ".bmp";
+}
+
+static auto IsNormalMap(const fs::path &path) -> bool {
+    const std::string stem = path.stem().string();
+    auto endsWith = [&stem](const char *pSuffix) {
+        const size_t length = strlen(pSuffix);
+        return stem.size() > length && stem.compare(stem.size() - length, length, pSuffix) == 0;
+    };
+    return endsWith("_n") || endsWith("_normal");
+}
+
+// "<hash> <relative path>" per line.
+static auto LoadCache(const fs::path &path) -> std::map<std::string, uint64_t> {
+    std::map<std::string, uint64_t> cache;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t space = line.find(' ');
+        if (space != std::string::npos) {
+            cache[line.substr(space + 1)] = std::stoull(line.substr(0, space), nullptr, 16);
+        }
+    }
+    return cache;
+}
+
+static void SaveCache(const fs::path &path, const std::map<std::string, uint64_t> &cache) {
+    std::ofstream file(path, std::ios::trunc);
+    for (const auto &[name, hash] : cache) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+        file << hex << ' ' << name << '\n';
+    }
+}
+
+static auto CompileImage(const fs::path &source, const std::vector<uint8_t> &bytes, const fs::path &output,
+                         uint32_t threadCount, Totals &totals) -> bool {
+    int width = 0, height = 0, channels = 0;
+    stbi_uc *pTexels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 4);
+    if (pTexels == nullptr) {
+        fprintf(stderr, "%s: %s\n", source.string().c_str(), stbi_failure_reason());
+        return false;
+    }
+
+    Image image = {(uint32_t)width, (uint32_t)height, std::vector<uint8_t>(pTexels, pTexels + (size_t)width * height * 4)};
+    stbi_image_free(pTexels);
+
+    bool opaque = true;
+    for (size_t i = 3; i < image.mTexels.size() && opaque; i += 4) {
+        opaque = image.mTexels[i] == 255;
+    }
+
+    const bool normalMap = IsNormalMap(source);
+    const ImageKind kind = normalMap ? ImageKind::Normal : ImageKind::Color;
+    const BlockFormat format = normalMap ? BlockFormat::Bc5 : opaque ? BlockFormat::Bc1 : BlockFormat::Bc3;
+
+    std::vector<Image> levels;
+    GenerateMipChain(image, kind, &levels);
+
+    CompressedTexture texture;
+    CompressMipChain(levels, format, kind == ImageKind::Color, threadCount, &texture);
+    if (!WriteDds(output.string(), texture)) {
+        fprintf(stderr, "%s: could not write %s\n", source.string().c_str(), output.string().c_str());
+        return false;
+    }
+
+    // What loading the source as RGBA8 with the same mips would take.
+    uint64_t uncompressedBytes = 0;
+    for (const Image &level : levels) {
+        uncompressedBytes += level.mTexels.size();
+    }
+    const uint64_t compressedBytes = CompressedBytes(texture);
+    totals.mCompressedBytes += compressedBytes;
+    totals.mUncompressedBytes += uncompressedBytes;
+
+    printf("%s -> %s: %s%s %ux%u, %zu levels, %.1f KB (%.1f KB as RGBA8)\n", source.filename().string().c_str(),
+           output.filename().string().c_str(), FormatName(format), texture.bSrgb ? " sRGB" : "", image.mWidth,
+           image.mHeight, levels.size(), compressedBytes / 1024.0f, uncompressedBytes / 1024.0f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    bool force = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        fprintf(stderr, "usage: texture-compiler [--force] <source directory> <output directory>\n");
+        return 2;
+    }
+
+    const fs::path sourceDir = paths[0];
+    const fs::path outputDir = paths[1];
+    std::error_code error;
+    fs::create_directories(outputDir, error);
+
+    const fs::path cachePath = outputDir / CacheFileName;
+    std::map<std::string, uint64_t> cache = force ? std::map<std::string, uint64_t>() : LoadCache(cachePath);
+    std::map<std::string, uint64_t> nextCache;
+
+    std::vector<fs::path> files;
+    std::set<fs::path> sourceStems;
+    for (const auto &entry : fs::recursive_directory_iterator(sourceDir)) {
+        if (entry.is_regular_file()) {
+            files.push_back(entry.path());
+            if (IsSourceImage(entry.path())) {
+                sourceStems.insert(fs::path(entry.path()).replace_extension());
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    const auto start = std::chrono::steady_clock::now();
+    Totals totals;
+
+    for (const fs::path &file : files) {
+        const bool compile = IsSourceImage(file);
+        if (!compile && file.extension() == ".dds" && sourceStems.count(fs::path(file).replace_extension()) > 0) {
+            printf("%s: skipped, compiled from its source image\n", file.filename().string().c_str());
+            continue;
+        }
+
+        const fs::path relative = fs::relative(file, sourceDir);
+        fs::path output = outputDir / relative;
+        if (compile) {
+            output.replace_extension(".dds");
+        }
+        fs::create_directories(output.parent_path(), error);
+
+        std::vector<uint8_t> bytes;
+        if (!ReadFile(file, &bytes)) {
+            fprintf(stderr, "%s: could not read\n", file.string().c_str());
+            totals.mFailed++;
+            continue;
+        }
+
+        // Everything that decides the output: tool version, settings derived from the name, content.
+        uint64_t hash = Fnv1a(ToolVersion, strlen(ToolVersion), FnvOffset);
+        const std::string name = relative.generic_string();
+        hash = Fnv1a(name.data(), name.size(), hash);
+        hash = Fnv1a(bytes.data(), bytes.size(), hash);
+
+        auto cached = cache.find(name);
+        if (cached != cache.end() && cached->second == hash && fs::exists(output)) {
+            nextCache[name] = hash;
+            totals.mUpToDate++;
+            continue;
+        }
+
+        bool done = false;
+        if (compile) {
+            done = CompileImage(file, bytes, output, threadCount, totals);
+            totals.mCompiled += done ? 1 : 0;
+        } else {
+            done = fs::copy_file(file, output, fs::copy_options::overwrite_existing, error);
+            totals.mCopied += done ? 1 : 0;
+        }
+
+        if (done) {
+            nextCache[name] = hash;
+        } else {
+            totals.mFailed++;
+        }
+    }
+
+    SaveCache(cachePath, nextCache);
+
+    const float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%u compiled, %u copied, %u up to date, %u failed in %.0f ms", totals.mCompiled, totals.mCopied,
+           totals.mUpToDate, totals.mFailed, elapsedMs);
+    if (totals.mUncompressedBytes > 0) {
+        printf(", %.1f KB instead of %.1f KB", totals.mCompressedBytes / 1024.0f, totals.mUncompressedBytes / 1024.0f);
+    }
+    printf("\n");
+
+    return totals.mFailed > 0 ? 1 : 0;
+}